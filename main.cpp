@@ -6,8 +6,10 @@
 #include <QTimer>
 #include <iostream>
 
+#include "src/cli/batchrunner.h"
 #include "src/cli/clioptions.h"
 #include "src/cli/clirunner.h"
+#include "src/cli/cosimrunner.h"
 #include "src/mainwindow.h"
 
 using namespace std;
@@ -76,6 +78,10 @@ int CLIMode(QCommandLineParser &parser, Ripes::CLIModeOptions &options) {
     parser.showHelp();
     return 0;
   }
+  if (!options.batch.isEmpty())
+    return Ripes::BatchRunner(options).run();
+  if (options.cosim)
+    return Ripes::CosimRunner(options).run();
   return Ripes::CLIRunner(options).run();
 }
 
@@ -0,0 +1,135 @@
+#include "cacheaccesslog.h"
+
+#include <QtGlobal>
+
+#include <algorithm>
+
+namespace Ripes {
+
+void CacheAccessLog::count(Counters &counters, uint8_t entry, int sign) {
+  if (entry & s_hitBit) {
+    counters.hits += sign;
+  } else {
+    counters.misses += sign;
+  }
+  if (entry & s_writeBit) {
+    counters.writes += sign;
+  } else {
+    counters.reads += sign;
+  }
+  if (entry & s_writebackBit) {
+    counters.writebacks += sign;
+  }
+}
+
+void CacheAccessLog::push(uint64_t cycle, MemoryAccess::Type type, bool isHit,
+                          bool isWriteback) {
+  Q_ASSERT(type != MemoryAccess::None);
+  Q_ASSERT(empty() || cycle >= lastCycle());
+
+  if (m_chunks.empty() || m_chunks.back().entries.size() == s_chunkSize) {
+    Chunk chunk;
+    chunk.firstCycle = cycle;
+    chunk.lastCycle = cycle;
+    chunk.base = m_counters;
+    chunk.entries.reserve(s_chunkSize);
+    m_chunks.push_back(std::move(chunk));
+  }
+
+  Chunk &chunk = m_chunks.back();
+  const uint64_t delta = cycle - chunk.lastCycle;
+  uint8_t entry = (isHit ? s_hitBit : 0) | (isWriteback ? s_writebackBit : 0) |
+                  (type == MemoryAccess::Write ? s_writeBit : 0);
+  if (delta < s_longDelta) {
+    entry |= delta << s_deltaShift;
+  } else {
+    entry |= s_longDelta << s_deltaShift;
+    chunk.longDeltas.push_back(delta);
+  }
+  chunk.entries.push_back(entry);
+  chunk.lastCycle = cycle;
+
+  count(m_counters, entry, 1);
+  m_size++;
+}
+
+void CacheAccessLog::pop() {
+  Q_ASSERT(!empty());
+  Chunk &chunk = m_chunks.back();
+  const uint8_t entry = chunk.entries.back();
+  uint64_t delta = entry >> s_deltaShift;
+  if (delta == s_longDelta) {
+    delta = chunk.longDeltas.back();
+    chunk.longDeltas.pop_back();
+  }
+  chunk.entries.pop_back();
+  chunk.lastCycle -= delta;
+  if (chunk.entries.empty()) {
+    m_chunks.pop_back();
+  }
+
+  count(m_counters, entry, -1);
+  m_size--;
+}
+
+void CacheAccessLog::clear() {
+  m_chunks.clear();
+  m_counters = Counters();
+  m_size = 0;
+}
+
+CacheAccessLog::Reader CacheAccessLog::readAfter(uint64_t cycle) const {
+  // Locate the first chunk containing accesses after the cycle, and skip the
+  // accesses of the chunk up until the cycle.
+  const auto it = std::partition_point(
+      m_chunks.begin(), m_chunks.end(),
+      [=](const Chunk &c) { return c.lastCycle <= cycle; });
+  Reader reader(*this, it - m_chunks.begin());
+  if (it != m_chunks.end() && it->firstCycle <= cycle) {
+    Entry entry;
+    for (Reader peek = reader; peek.next(entry) && entry.cycle <= cycle;) {
+      reader = peek;
+    }
+  }
+  return reader;
+}
+
+CacheAccessLog::Reader::Reader(const CacheAccessLog &log, size_t chunkIdx)
+    : m_log(&log), m_chunkIdx(chunkIdx) {
+  if (m_chunkIdx < m_log->m_chunks.size()) {
+    const Chunk &chunk = m_log->m_chunks[m_chunkIdx];
+    m_cycle = chunk.firstCycle;
+    m_counters = chunk.base;
+  }
+}
+
+bool CacheAccessLog::Reader::next(Entry &entry) {
+  const auto &chunks = m_log->m_chunks;
+  if (m_chunkIdx >= chunks.size()) {
+    return false;
+  }
+
+  const Chunk &chunk = chunks[m_chunkIdx];
+  const uint8_t encoded = chunk.entries[m_entryIdx];
+  uint64_t delta = encoded >> s_deltaShift;
+  if (delta == s_longDelta) {
+    delta = chunk.longDeltas[m_longDeltaIdx++];
+  }
+  m_cycle += delta;
+  count(m_counters, encoded, 1);
+
+  entry.cycle = m_cycle;
+  entry.counters = m_counters;
+  entry.type =
+      (encoded & s_writeBit) ? MemoryAccess::Write : MemoryAccess::Read;
+  entry.isHit = encoded & s_hitBit;
+  entry.isWriteback = encoded & s_writebackBit;
+
+  if (++m_entryIdx == chunk.entries.size()) {
+    // Continue at the start of the next chunk.
+    *this = Reader(*m_log, m_chunkIdx + 1);
+  }
+  return true;
+}
+
+} // namespace Ripes
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "processors/interface/ripesprocessor.h"
+
+namespace Ripes {
+
+/**
+ * @brief The CacheAccessLog class
+ * Compact, append-only log of the accesses performed on a cache, ordered by
+ * cycle. Accesses are stored in fixed-size chunks, with each access encoded in
+ * a single byte holding its access flags and the cycle delta to the preceding
+ * access (deltas which do not fit are stored out-of-line). Each chunk holds a
+ * checkpoint of the cumulative access counters at the start of the chunk. The
+ * totals are available in O(1), and reading from an arbitrary cycle requires
+ * O(log n) + O(chunk size) time.
+ */
+class CacheAccessLog {
+public:
+  struct Counters {
+    unsigned hits = 0;
+    unsigned misses = 0;
+    unsigned reads = 0;
+    unsigned writes = 0;
+    unsigned writebacks = 0;
+    unsigned accesses() const { return hits + misses; }
+  };
+
+  struct Entry {
+    uint64_t cycle = 0;
+    // Cumulative counters, including this access.
+    Counters counters;
+    MemoryAccess::Type type = MemoryAccess::None;
+    bool isHit = false;
+    bool isWriteback = false;
+  };
+
+  /**
+   * @brief The Reader class
+   * Forward reader over the entries of a log. A reader is invalidated by any
+   * modification of the log.
+   */
+  class Reader {
+  public:
+    /// Decodes the next entry into @p entry. Returns false at the end of the
+    /// log.
+    bool next(Entry &entry);
+
+  private:
+    friend class CacheAccessLog;
+    Reader(const CacheAccessLog &log, size_t chunkIdx);
+
+    const CacheAccessLog *m_log;
+    size_t m_chunkIdx;
+    size_t m_entryIdx = 0;
+    size_t m_longDeltaIdx = 0;
+    uint64_t m_cycle = 0;
+    Counters m_counters;
+  };
+
+  void push(uint64_t cycle, MemoryAccess::Type type, bool isHit,
+            bool isWriteback);
+  /// Removes the most recently pushed access.
+  void pop();
+  void clear();
+
+  bool empty() const { return m_chunks.empty(); }
+  size_t size() const { return m_size; }
+  uint64_t lastCycle() const { return m_chunks.back().lastCycle; }
+  const Counters &counters() const { return m_counters; }
+
+  /// Returns a reader over the accesses which occurred after @p cycle.
+  Reader readAfter(uint64_t cycle) const;
+
+private:
+  static constexpr size_t s_chunkSize = 4096;
+
+  // Entry encoding: [7:3] cycle delta, [2] write, [1] writeback, [0] hit.
+  static constexpr uint8_t s_hitBit = 0b001;
+  static constexpr uint8_t s_writebackBit = 0b010;
+  static constexpr uint8_t s_writeBit = 0b100;
+  static constexpr unsigned s_deltaShift = 3;
+  // Delta value indicating that the delta is stored in Chunk::longDeltas.
+  static constexpr unsigned s_longDelta = 0b11111;
+
+  struct Chunk {
+    uint64_t firstCycle = 0;
+    uint64_t lastCycle = 0;
+    // Cumulative counters prior to the first access of the chunk.
+    Counters base;
+    std::vector<uint8_t> entries;
+    std::vector<uint64_t> longDeltas;
+  };
+
+  static void count(Counters &counters, uint8_t entry, int sign);
+
+  std::vector<Chunk> m_chunks;
+  Counters m_counters;
+  size_t m_size = 0;
+};
+
+} // namespace Ripes
@@ -91,9 +91,9 @@ CacheGraphic::CacheGraphic(CacheSim &cache)
 }
 
 void CacheGraphic::updateLineReplFields(unsigned lineIdx) {
-  auto *cacheLine = m_cache.getLine(lineIdx);
+  const auto cacheLine = m_cache.getLine(lineIdx);
 
-  if (cacheLine == nullptr) {
+  if (!cacheLine) {
     // Nothing to do
     return;
   }
@@ -139,7 +139,7 @@ void CacheGraphic::updateWay(unsigned lineIdx, unsigned wayIdx) {
 
   CacheSim::CacheWay simWay = CacheSim::CacheWay();
 
-  if (auto *cacheLine = m_cache.getLine(lineIdx)) {
+  if (const auto cacheLine = m_cache.getLine(lineIdx)) {
     simWay = cacheLine->at(wayIdx);
   };
 
@@ -519,9 +519,9 @@ void CacheGraphic::cacheInvalidated() {
 
   // Update all entries in the cache
   for (int lineIdx = 0; lineIdx < m_cache.getLines(); lineIdx++) {
-    if (const auto *line = m_cache.getLine(lineIdx)) {
-      for (const auto &way : *line) {
-        updateWay(lineIdx, way.first);
+    if (const auto line = m_cache.getLine(lineIdx)) {
+      for (unsigned wayIdx = 0; wayIdx < line->size(); ++wayIdx) {
+        updateWay(lineIdx, wayIdx);
       }
       updateLineReplFields(lineIdx);
     }
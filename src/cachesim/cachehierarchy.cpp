@@ -0,0 +1,200 @@
+#include "cachehierarchy.h"
+#include "l1cacheshim.h"
+
+#include <algorithm>
+
+namespace Ripes {
+
+/**
+ * @brief The DemandCounter class
+ * Sits in front of a level of the hierarchy (or main memory), and counts the
+ * demand accesses into it: accesses of the processor, when placed at the entry
+ * of an access path, or else block fetches made on behalf of such an access.
+ * Accesses are propagated synchronously through the hierarchy, such that the
+ * counters of a hierarchy share whether the access currently being propagated
+ * descends from an access of the processor.
+ */
+class DemandCounter : public CacheInterface {
+public:
+  DemandCounter(unsigned latency, bool entry, std::shared_ptr<bool> demand)
+      : CacheInterface(nullptr), m_latency(latency), m_entry(entry),
+        m_demand(std::move(demand)) {}
+
+  void access(AInt address, MemoryAccess::Type type) override {
+    const bool wasDemand = *m_demand;
+    *m_demand = m_entry || (wasDemand && type == MemoryAccess::Read);
+    if (*m_demand) {
+      m_accesses++;
+    }
+    if (m_nextLevelCache) {
+      m_nextLevelCache->access(address, type);
+    }
+    *m_demand = wasDemand;
+  }
+
+  void evict(AInt address, bool dirty) override {
+    // Writebacks, and any fetches they cause, are not on the demand path.
+    const bool wasDemand = *m_demand;
+    *m_demand = false;
+    if (m_nextLevelCache) {
+      m_nextLevelCache->evict(address, dirty);
+    }
+    *m_demand = wasDemand;
+  }
+
+  void reset() override {
+    m_accesses = 0;
+    CacheInterface::reset();
+  }
+
+  uint64_t accesses() const { return m_accesses; }
+  uint64_t cycles() const { return m_accesses * m_latency; }
+
+private:
+  unsigned m_latency;
+  bool m_entry;
+  std::shared_ptr<bool> m_demand;
+  uint64_t m_accesses = 0;
+};
+
+bool CacheHierarchy::Config::empty() const {
+  return std::none_of(levels.begin(), levels.end(),
+                      [](const auto &level) { return level.has_value(); });
+}
+
+CacheHierarchy::CacheHierarchy(const Config &config, unsigned wordBytes,
+                               QObject *parent)
+    : QObject(parent), m_config(config) {
+  auto demand = std::make_shared<bool>(false);
+  for (unsigned level = 0; level < NumLevels; ++level) {
+    if (const auto &levelConfig = m_config.levels[level]) {
+      auto cache = std::make_shared<CacheSim>(wordBytes, nullptr);
+      cache->setPreset(levelConfig->preset);
+      cache->setInclusionPolicy(levelConfig->inclusion);
+      m_caches[level] = cache;
+      m_demand[level] =
+          std::make_shared<DemandCounter>(levelConfig->latency, false, demand);
+      m_demand[level]->setNextLevelCache(cache);
+    }
+  }
+  m_demand[NumLevels] =
+      std::make_shared<DemandCounter>(m_config.memoryLatency, false, demand);
+
+  // Connect each level to the next present level on its path, or to main
+  // memory. Shared levels are visited by both paths, in which case
+  // reconnecting them has no effect.
+  for (bool instr : {true, false}) {
+    const auto levels = path(instr);
+    for (unsigned i = 0; i < levels.size(); ++i) {
+      m_caches[levels[i]]->setNextLevelCache(
+          m_demand[i + 1 < levels.size() ? levels[i + 1] : NumLevels]);
+    }
+    if (!levels.empty()) {
+      const auto &first = m_config.levels[levels.front()];
+      // Each access of the processor is assumed to take at least the single
+      // cycle of an ideal memory.
+      Q_ASSERT(first->latency > 0);
+      auto &entry = m_entry[instr ? 0 : 1];
+      entry = std::make_shared<DemandCounter>(first->latency, true, demand);
+      entry->setNextLevelCache(m_caches[levels.front()]);
+    }
+  }
+}
+
+CacheHierarchy::~CacheHierarchy() {}
+
+std::vector<CacheHierarchy::Level> CacheHierarchy::path(bool instr) const {
+  std::vector<Level> levels;
+  for (Level level : {instr ? L1I : L1D, L2, L3}) {
+    if (m_caches[level]) {
+      levels.push_back(level);
+    }
+  }
+  return levels;
+}
+
+void CacheHierarchy::access(const TraceAccess &access) {
+  if (DemandCounter *entry = m_entry[access.instr ? 0 : 1].get()) {
+    entry->access(access.address, access.type);
+  }
+}
+
+void CacheHierarchy::attachToProcessor() {
+  // Shims are only created for paths with at least one present level; a shim
+  // must always have a next level cache to forward accesses to.
+  if (m_entry[0]) {
+    m_l1iShim = std::make_unique<L1CacheShim>(
+        L1CacheShim::CacheType::InstrCache, nullptr);
+    m_l1iShim->setNextLevelCache(m_entry[0]);
+  }
+  if (m_entry[1]) {
+    m_l1dShim = std::make_unique<L1CacheShim>(
+        L1CacheShim::CacheType::DataCache, nullptr);
+    m_l1dShim->setNextLevelCache(m_entry[1]);
+  }
+}
+
+double CacheHierarchy::amat(bool instr) const {
+  // AMAT = t_L1 + m_L1 * (t_L2 + m_L2 * (... + m_Ln * t_memory))
+  const auto levels = path(instr);
+  double time = m_config.memoryLatency;
+  for (auto it = levels.rbegin(); it != levels.rend(); ++it) {
+    const CacheSim &cache = *m_caches[*it];
+    const double missRate =
+        cache.getHits() + cache.getMisses() == 0 ? 1.0
+                                                 : 1.0 - cache.getHitRate();
+    time = m_config.levels[*it]->latency + missRate * time;
+  }
+  return time;
+}
+
+unsigned CacheHierarchy::pathAccesses(bool instr) const {
+  // Only the L1 levels are exclusive to a single access path.
+  const auto &l1 = m_caches[instr ? L1I : L1D];
+  return l1 ? l1->getHits() + l1->getMisses() : 0;
+}
+
+double CacheHierarchy::amat() const {
+  const unsigned instrAccesses = pathAccesses(true);
+  const unsigned dataAccesses = pathAccesses(false);
+  if (instrAccesses + dataAccesses == 0) {
+    return amat(false);
+  }
+  return (amat(true) * instrAccesses + amat(false) * dataAccesses) /
+         (instrAccesses + dataAccesses);
+}
+
+uint64_t CacheHierarchy::estimatedStallCycles() const {
+  uint64_t cycles = 0;
+  uint64_t accesses = 0;
+  for (const auto &entry : m_entry) {
+    if (entry) {
+      cycles += entry->cycles();
+      accesses += entry->accesses();
+    }
+  }
+  for (const auto &counter : m_demand) {
+    if (counter) {
+      cycles += counter->cycles();
+    }
+  }
+  return cycles - accesses;
+}
+
+QString CacheHierarchy::levelName(Level level) {
+  switch (level) {
+  case L1I:
+    return "L1I";
+  case L1D:
+    return "L1D";
+  case L2:
+    return "L2";
+  case L3:
+    return "L3";
+  case NumLevels:
+    break;
+  }
+  Q_UNREACHABLE();
+}
+
+} // namespace Ripes
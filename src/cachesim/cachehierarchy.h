@@ -0,0 +1,127 @@
+#pragma once
+
+#include <QObject>
+
+#include <array>
+#include <memory>
+#include <optional>
+
+#include "cachesim.h"
+#include "cachetracereader.h"
+
+namespace Ripes {
+
+class DemandCounter;
+class L1CacheShim;
+
+/**
+ * @brief The CacheHierarchy class
+ * A multi-level hierarchy of detached caches: split L1 instruction and data
+ * caches, backed by an optional shared L2 and L3 cache. Misses and evictions
+ * of each level propagate to the next present level, as per the inclusion
+ * policy of that level. Any level may be omitted; accesses are routed to the
+ * first present level on their path.
+ */
+class CacheHierarchy : public QObject {
+  Q_OBJECT
+public:
+  enum Level { L1I, L1D, L2, L3, NumLevels };
+
+  struct LevelConfig {
+    CachePreset preset;
+    InclusionPolicy inclusion = InclusionPolicy::NINE;
+    // Access latency of the level, in cycles.
+    unsigned latency = 1;
+  };
+
+  struct Config {
+    std::array<std::optional<LevelConfig>, NumLevels> levels;
+    // Access latency of main memory, in cycles.
+    unsigned memoryLatency = 100;
+
+    bool empty() const;
+  };
+
+  /**
+   * @brief CacheHierarchy
+   * Constructs the hierarchy described by @p config, modelling a memory system
+   * of @p wordBytes bytes per word.
+   */
+  CacheHierarchy(const Config &config, unsigned wordBytes,
+                 QObject *parent = nullptr);
+  ~CacheHierarchy();
+
+  void access(const TraceAccess &access);
+
+  /**
+   * @brief attachToProcessor
+   * Feeds the instruction and data accesses of the current processor into the
+   * hierarchy through a pair of L1CacheShims.
+   */
+  void attachToProcessor();
+
+  /// Returns the cache of @p level, or nullptr if the level is not present.
+  const std::shared_ptr<CacheSim> &cache(Level level) const {
+    return m_caches[level];
+  }
+  const Config &config() const { return m_config; }
+
+  /**
+   * @brief amat
+   * Average memory access time (in cycles) of instruction fetches (@p instr)
+   * or data accesses, based on the latency and observed local miss rate of
+   * each level on the access path.
+   */
+  double amat(bool instr) const;
+
+  /// Average memory access time (in cycles) across all accesses.
+  double amat() const;
+
+  /**
+   * @brief estimatedStallCycles
+   * An analytical estimate of the number of cycles which the accesses so far
+   * have stalled the processor, beyond the single cycle per access that a
+   * processor with an ideal memory would spend. Only the demand path is
+   * charged: each access of the processor costs the latency of the first level
+   * of its path, each block fetched by a miss caused by such an access costs
+   * the latency of the level it is fetched from, and fetches which miss in the
+   * last level of a path cost the memory latency. Writebacks, write-through
+   * writes and back-invalidations are assumed to be absorbed by write buffers,
+   * and are not charged. Accesses are not overlapped.
+   * The caches of the hierarchy are detached, and as such are not reversed
+   * along with the processor; the estimate is not updated when the processor
+   * is reversed.
+   */
+  uint64_t estimatedStallCycles() const;
+
+  static QString levelName(Level level);
+
+private:
+  /// Returns the levels that instruction fetches or data accesses traverse.
+  std::vector<Level> path(bool instr) const;
+  unsigned pathAccesses(bool instr) const;
+
+  Config m_config;
+  std::array<std::shared_ptr<CacheSim>, NumLevels> m_caches;
+
+  /**
+   * @brief m_entry
+   * The entry points of the instruction (index 0) and data (index 1) access
+   * paths, counting the accesses of the processor into the first present level
+   * of each path.
+   */
+  std::array<std::shared_ptr<DemandCounter>, 2> m_entry;
+
+  /**
+   * @brief m_demand
+   * Counters of the block fetches into each level from the level above it, of
+   * which the last entry counts the fetches from main memory. Each present
+   * level is connected to the next level of its path through these counters.
+   */
+  std::array<std::shared_ptr<DemandCounter>, NumLevels + 1> m_demand;
+
+  std::unique_ptr<L1CacheShim> m_l1iShim;
+  std::unique_ptr<L1CacheShim> m_l1dShim;
+};
+
+} // namespace Ripes
@@ -309,11 +309,7 @@ void CachePlotWidget::variablesChanged() {
 std::map<CachePlotWidget::Variable, QList<QPoint>>
 CachePlotWidget::gatherData(unsigned fromCycle) const {
   std::map<Variable, QList<QPoint>> cacheData;
-  const auto &trace = m_cache->getAccessTrace();
-
-  for (int i = 0; i < N_TraceVars; ++i) {
-    cacheData[static_cast<Variable>(i)].reserve(trace.size());
-  }
+  const auto &log = m_cache->getAccessLog();
 
   // Gather data up until the end of the trace or the maximum plotted cycles
   const unsigned maxCycles =
@@ -322,21 +318,25 @@ CachePlotWidget::gatherData(unsigned fromCycle) const {
     return {};
   }
 
-  for (auto it = trace.upper_bound(fromCycle);
-       it != trace.lower_bound(maxCycles); it++) {
-    const auto &entry = it->second;
-    Q_ASSERT(it->first <= maxCycles);
-    cacheData[Variable::Writes].append(QPoint(it->first, entry.writes));
-    cacheData[Variable::Reads].append(QPoint(it->first, entry.reads));
-    cacheData[Variable::Hits].append(QPoint(it->first, entry.hits));
-    cacheData[Variable::Misses].append(QPoint(it->first, entry.misses));
-    cacheData[Variable::Writebacks].append(QPoint(it->first, entry.writebacks));
-    cacheData[Variable::Accesses].append(
-        QPoint(it->first, entry.hits + entry.misses));
-    cacheData[Variable::WasHit].append(
-        QPoint(it->first, entry.lastTransaction.isHit));
-    cacheData[Variable::WasMiss].append(
-        QPoint(it->first, !entry.lastTransaction.isHit));
+  const qsizetype maxEntries =
+      std::min<uint64_t>(log.size(), maxCycles - fromCycle);
+  for (int i = 0; i < N_TraceVars; ++i) {
+    cacheData[static_cast<Variable>(i)].reserve(maxEntries);
+  }
+
+  CacheAccessLog::Entry entry;
+  for (auto reader = log.readAfter(fromCycle);
+       reader.next(entry) && entry.cycle < maxCycles;) {
+    const int cycle = entry.cycle;
+    const auto &counters = entry.counters;
+    cacheData[Variable::Writes].append(QPoint(cycle, counters.writes));
+    cacheData[Variable::Reads].append(QPoint(cycle, counters.reads));
+    cacheData[Variable::Hits].append(QPoint(cycle, counters.hits));
+    cacheData[Variable::Misses].append(QPoint(cycle, counters.misses));
+    cacheData[Variable::Writebacks].append(QPoint(cycle, counters.writebacks));
+    cacheData[Variable::Accesses].append(QPoint(cycle, counters.accesses()));
+    cacheData[Variable::WasHit].append(QPoint(cycle, entry.isHit));
+    cacheData[Variable::WasMiss].append(QPoint(cycle, !entry.isHit));
   }
 
   return cacheData;
@@ -0,0 +1,236 @@
+#include "cachereplacement.h"
+#include "binutils.h"
+
+#include <algorithm>
+#include <random>
+
+namespace Ripes {
+
+// ============================== Random ================================
+
+void RandomEngine::reset(unsigned, unsigned ways) { setWays(ways); }
+
+unsigned RandomEngine::victim(unsigned) { return std::rand() % m_ways; }
+
+// ================================ LRU =================================
+
+void LRUEngine::reset(unsigned lines, unsigned ways) {
+  setWays(ways);
+  m_prev.resize(lines * ways);
+  m_next.resize(lines * ways);
+  m_head.assign(lines, ways - 1);
+  m_tail.assign(lines, 0);
+
+  // Ways are initially ordered such that way 0 is the least recently used. Given
+  // that invalid ways are filled in ascending order, and that a filled way is
+  // moved to the front of the list, invalid ways will always be located at the
+  // tail of the list.
+  for (unsigned line = 0; line < lines; ++line) {
+    const unsigned base = line * ways;
+    for (unsigned way = 0; way < ways; ++way) {
+      m_next[base + way] = way == 0 ? s_none : way - 1;
+      m_prev[base + way] = way == ways - 1 ? s_none : way + 1;
+    }
+  }
+}
+
+void LRUEngine::unlink(unsigned lineIdx, unsigned wayIdx) {
+  const unsigned base = lineIdx * m_ways;
+  const uint32_t prev = m_prev[base + wayIdx];
+  const uint32_t next = m_next[base + wayIdx];
+  if (prev != s_none) {
+    m_next[base + prev] = next;
+  } else {
+    m_head[lineIdx] = next;
+  }
+  if (next != s_none) {
+    m_prev[base + next] = prev;
+  } else {
+    m_tail[lineIdx] = prev;
+  }
+}
+
+void LRUEngine::insertAfter(unsigned lineIdx, unsigned wayIdx,
+                            uint32_t prevIdx) {
+  const unsigned base = lineIdx * m_ways;
+  const uint32_t next =
+      prevIdx == s_none ? m_head[lineIdx] : m_next[base + prevIdx];
+  m_prev[base + wayIdx] = prevIdx;
+  m_next[base + wayIdx] = next;
+  if (prevIdx != s_none) {
+    m_next[base + prevIdx] = wayIdx;
+  } else {
+    m_head[lineIdx] = wayIdx;
+  }
+  if (next != s_none) {
+    m_prev[base + next] = wayIdx;
+  } else {
+    m_tail[lineIdx] = wayIdx;
+  }
+}
+
+ReplacementEngine::UndoToken LRUEngine::touch(unsigned lineIdx, unsigned wayIdx,
+                                              bool) {
+  // The undo token is the predecessor of the way prior to it being moved to
+  // the front of the recency list.
+  const uint32_t prev = m_prev[lineIdx * m_ways + wayIdx];
+  if (prev != s_none) {
+    unlink(lineIdx, wayIdx);
+    insertAfter(lineIdx, wayIdx, s_none);
+  }
+  return prev;
+}
+
+void LRUEngine::revert(unsigned lineIdx, unsigned wayIdx, bool,
+                       UndoToken token) {
+  const uint32_t prev = static_cast<uint32_t>(token);
+  if (prev != s_none) {
+    unlink(lineIdx, wayIdx);
+    insertAfter(lineIdx, wayIdx, prev);
+  }
+}
+
+unsigned LRUEngine::rank(unsigned lineIdx, unsigned wayIdx) const {
+  const unsigned base = lineIdx * m_ways;
+  unsigned rank = 0;
+  for (uint32_t way = m_head[lineIdx]; way != s_none;
+       way = m_next[base + way]) {
+    if (way == wayIdx) {
+      return rank;
+    }
+    rank++;
+  }
+  return -1;
+}
+
+// ================================ PLRU ================================
+
+void PLRUEngine::reset(unsigned lines, unsigned ways) {
+  setWays(ways);
+  m_nodes.assign(lines * ways, 0);
+}
+
+ReplacementEngine::UndoToken PLRUEngine::touch(unsigned lineIdx,
+                                               unsigned wayIdx, bool) {
+  // Walk from the root towards the accessed way, pointing each node on the path
+  // away from it. The prior value of each node is recorded in the undo token.
+  uint8_t *nodes = &m_nodes[lineIdx * m_ways];
+  UndoToken token = 0;
+  unsigned node = 1;
+  for (int level = m_wayBits - 1; level >= 0; --level) {
+    const unsigned dir = (wayIdx >> level) & 0b1;
+    token = (token << 1) | nodes[node];
+    nodes[node] = !dir;
+    node = 2 * node + dir;
+  }
+  return token;
+}
+
+void PLRUEngine::revert(unsigned lineIdx, unsigned wayIdx, bool,
+                        UndoToken token) {
+  uint8_t *nodes = &m_nodes[lineIdx * m_ways];
+  unsigned node = 1;
+  for (int level = m_wayBits - 1; level >= 0; --level) {
+    const unsigned dir = (wayIdx >> level) & 0b1;
+    nodes[node] = (token >> level) & 0b1;
+    node = 2 * node + dir;
+  }
+}
+
+unsigned PLRUEngine::victim(unsigned lineIdx) {
+  const uint8_t *nodes = &m_nodes[lineIdx * m_ways];
+  unsigned node = 1;
+  for (unsigned level = 0; level < m_wayBits; ++level) {
+    node = 2 * node + nodes[node];
+  }
+  return node - m_ways;
+}
+
+// ================================ FIFO ================================
+
+void FIFOEngine::reset(unsigned lines, unsigned ways) {
+  setWays(ways);
+  m_nextWay.assign(lines, 0);
+}
+
+ReplacementEngine::UndoToken FIFOEngine::touch(unsigned lineIdx,
+                                               unsigned wayIdx, bool fill) {
+  const uint32_t prevNext = m_nextWay[lineIdx];
+  if (fill) {
+    m_nextWay[lineIdx] = (wayIdx + 1) % m_ways;
+  }
+  return prevNext;
+}
+
+void FIFOEngine::revert(unsigned lineIdx, unsigned, bool fill,
+                        UndoToken token) {
+  if (fill) {
+    m_nextWay[lineIdx] = static_cast<uint32_t>(token);
+  }
+}
+
+// ================================ NRU =================================
+
+void NRUEngine::reset(unsigned lines, unsigned ways) {
+  setWays(ways);
+  m_words = (ways + 63) / 64;
+  m_refBits.assign(lines * m_words, 0);
+}
+
+uint64_t NRUEngine::wordMask(unsigned word) const {
+  const unsigned bitsInWord = std::min(64u, m_ways - word * 64);
+  return bitsInWord == 64 ? ~UINT64_C(0) : (UINT64_C(1) << bitsInWord) - 1;
+}
+
+ReplacementEngine::UndoToken NRUEngine::touch(unsigned lineIdx,
+                                              unsigned wayIdx, bool) {
+  // The undo token holds the prior reference bit of the way (bit 0), and
+  // whether the access caused the reference bits of the line to be cleared
+  // (bit 1).
+  uint64_t *bits = refBits(lineIdx);
+  const uint64_t wayBit = UINT64_C(1) << (wayIdx % 64);
+  UndoToken token = (bits[wayIdx / 64] & wayBit) ? 0b01 : 0b00;
+  bits[wayIdx / 64] |= wayBit;
+
+  bool allSet = true;
+  for (unsigned word = 0; word < m_words && allSet; ++word) {
+    allSet &= bits[word] == wordMask(word);
+  }
+  if (allSet) {
+    std::fill(bits, bits + m_words, 0);
+    bits[wayIdx / 64] = wayBit;
+    token |= 0b10;
+  }
+  return token;
+}
+
+void NRUEngine::revert(unsigned lineIdx, unsigned wayIdx, bool,
+                       UndoToken token) {
+  uint64_t *bits = refBits(lineIdx);
+  if (token & 0b10) {
+    // Prior to clearing, all reference bits (except possibly for the accessed
+    // way) were set.
+    for (unsigned word = 0; word < m_words; ++word) {
+      bits[word] = wordMask(word);
+    }
+  }
+  const uint64_t wayBit = UINT64_C(1) << (wayIdx % 64);
+  if (token & 0b01) {
+    bits[wayIdx / 64] |= wayBit;
+  } else {
+    bits[wayIdx / 64] &= ~wayBit;
+  }
+}
+
+unsigned NRUEngine::victim(unsigned lineIdx) {
+  const uint64_t *bits = refBits(lineIdx);
+  for (unsigned word = 0; word < m_words; ++word) {
+    const uint64_t unreferenced = ~bits[word] & wordMask(word);
+    if (unreferenced != 0) {
+      return word * 64 + firstSetBitIdx(unreferenced);
+    }
+  }
+  return 0;
+}
+
+} // namespace Ripes
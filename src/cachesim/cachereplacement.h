@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Ripes {
+
+/**
+ * @brief The ReplacementEngine class
+ * Interface for the replacement policy of a CacheSim. An engine owns the
+ * replacement state of every line in the cache. All updates are reversible:
+ * touch() returns an undo token which, when passed to revert() in LIFO order,
+ * restores the replacement state to what it was prior to the update.
+ *
+ * Engines assume that the cache fills invalid ways in ascending way order (see
+ * fillsInvalidFirst()), and thus only need to select victims within fully
+ * valid lines.
+ */
+class ReplacementEngine {
+public:
+  using UndoToken = uint64_t;
+  virtual ~ReplacementEngine() {}
+
+  /**
+   * @brief reset
+   * Resets the replacement state for a cache of @p lines lines, each having
+   * @p ways ways.
+   */
+  virtual void reset(unsigned lines, unsigned ways) = 0;
+
+  /**
+   * @brief touch
+   * Registers an access to way @p wayIdx of line @p lineIdx. @p fill is true if
+   * the access loaded a new block into the way. Returns a token which reverts
+   * the update when passed to revert().
+   */
+  virtual UndoToken touch(unsigned lineIdx, unsigned wayIdx, bool fill) = 0;
+  virtual void revert(unsigned lineIdx, unsigned wayIdx, bool fill,
+                      UndoToken token) = 0;
+
+  /**
+   * @brief victim
+   * Returns the way to evict within line @p lineIdx.
+   */
+  virtual unsigned victim(unsigned lineIdx) = 0;
+
+  /**
+   * @brief rank
+   * Returns the recency rank (0 = most recently used) of a valid way, for
+   * policies which track it. Returns -1 otherwise.
+   */
+  virtual unsigned rank(unsigned /*lineIdx*/, unsigned /*wayIdx*/) const {
+    return -1;
+  }
+
+  /**
+   * @brief bitsPerLine
+   * Number of replacement state bits required per cache line in hardware.
+   */
+  virtual unsigned bitsPerLine() const = 0;
+
+  /**
+   * @brief fillsInvalidFirst
+   * Returns true if invalid ways should be filled before consulting victim().
+   */
+  virtual bool fillsInvalidFirst() const { return true; }
+
+protected:
+  void setWays(unsigned ways) {
+    m_ways = ways;
+    m_wayBits = 0;
+    while ((1u << m_wayBits) < ways) {
+      m_wayBits++;
+    }
+  }
+
+  unsigned m_ways = 1;
+  unsigned m_wayBits = 0;
+};
+
+/**
+ * @brief The RandomEngine class
+ * Random replacement. Stateless; may evict a valid way even though invalid ways
+ * are present in the line.
+ */
+class RandomEngine : public ReplacementEngine {
+public:
+  void reset(unsigned lines, unsigned ways) override;
+  UndoToken touch(unsigned, unsigned, bool) override { return 0; }
+  void revert(unsigned, unsigned, bool, UndoToken) override {}
+  unsigned victim(unsigned lineIdx) override;
+  unsigned bitsPerLine() const override { return 0; }
+  bool fillsInvalidFirst() const override { return false; }
+};
+
+/**
+ * @brief The LRUEngine class
+ * True LRU replacement. Each line keeps an intrusive doubly-linked recency list
+ * over its ways, ordered from most- to least recently used. Both updates and
+ * victim selection are O(1).
+ */
+class LRUEngine : public ReplacementEngine {
+public:
+  void reset(unsigned lines, unsigned ways) override;
+  UndoToken touch(unsigned lineIdx, unsigned wayIdx, bool fill) override;
+  void revert(unsigned lineIdx, unsigned wayIdx, bool fill,
+              UndoToken token) override;
+  unsigned victim(unsigned lineIdx) override { return m_tail[lineIdx]; }
+  unsigned rank(unsigned lineIdx, unsigned wayIdx) const override;
+  unsigned bitsPerLine() const override { return m_ways * m_wayBits; }
+
+private:
+  static constexpr uint32_t s_none = static_cast<uint32_t>(-1);
+
+  void unlink(unsigned lineIdx, unsigned wayIdx);
+  void insertAfter(unsigned lineIdx, unsigned wayIdx, uint32_t prevIdx);
+
+  std::vector<uint32_t> m_prev;
+  std::vector<uint32_t> m_next;
+  std::vector<uint32_t> m_head;
+  std::vector<uint32_t> m_tail;
+};
+
+/**
+ * @brief The PLRUEngine class
+ * Tree pseudo-LRU replacement. Each line keeps (ways - 1) tree bits, each
+ * pointing towards the less recently used half of its subtree. Updates and
+ * victim selection are O(log ways).
+ */
+class PLRUEngine : public ReplacementEngine {
+public:
+  void reset(unsigned lines, unsigned ways) override;
+  UndoToken touch(unsigned lineIdx, unsigned wayIdx, bool fill) override;
+  void revert(unsigned lineIdx, unsigned wayIdx, bool fill,
+              UndoToken token) override;
+  unsigned victim(unsigned lineIdx) override;
+  unsigned bitsPerLine() const override { return m_ways - 1; }
+
+private:
+  /**
+   * @brief m_nodes
+   * Tree bits of each line, stored as a heap with the root at index 1. Entry 0
+   * of each line is unused.
+   */
+  std::vector<uint8_t> m_nodes;
+};
+
+/**
+ * @brief The FIFOEngine class
+ * First-in, first-out replacement. Each line keeps a round-robin pointer to the
+ * next way to be replaced; hits do not modify the replacement state.
+ */
+class FIFOEngine : public ReplacementEngine {
+public:
+  void reset(unsigned lines, unsigned ways) override;
+  UndoToken touch(unsigned lineIdx, unsigned wayIdx, bool fill) override;
+  void revert(unsigned lineIdx, unsigned wayIdx, bool fill,
+              UndoToken token) override;
+  unsigned victim(unsigned lineIdx) override { return m_nextWay[lineIdx]; }
+  unsigned bitsPerLine() const override { return m_wayBits; }
+
+private:
+  std::vector<uint32_t> m_nextWay;
+};
+
+/**
+ * @brief The NRUEngine class
+ * Not-recently-used replacement. Each way has a reference bit which is set upon
+ * access. Once all reference bits of a line are set, all but the accessed
+ * way's bit are cleared. The victim is the lowest way with a cleared bit.
+ */
+class NRUEngine : public ReplacementEngine {
+public:
+  void reset(unsigned lines, unsigned ways) override;
+  UndoToken touch(unsigned lineIdx, unsigned wayIdx, bool fill) override;
+  void revert(unsigned lineIdx, unsigned wayIdx, bool fill,
+              UndoToken token) override;
+  unsigned victim(unsigned lineIdx) override;
+  unsigned bitsPerLine() const override { return m_ways; }
+
+private:
+  uint64_t wordMask(unsigned word) const;
+  uint64_t *refBits(unsigned lineIdx) { return &m_refBits[lineIdx * m_words]; }
+
+  unsigned m_words = 1;
+  std::vector<uint64_t> m_refBits;
+};
+
+} // namespace Ripes
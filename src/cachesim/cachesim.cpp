@@ -5,6 +5,7 @@
 
 #include <QApplication>
 #include <QThread>
+#include <algorithm>
 #include <random>
 #include <utility>
 
@@ -12,16 +13,49 @@ namespace Ripes {
 
 void CacheInterface::reset() {
   if (m_nextLevelCache) {
-    static_cast<CacheInterface *>(m_nextLevelCache.get())->reset();
+    m_nextLevelCache->reset();
   }
 }
 
 void CacheInterface::reverse() {
   if (m_nextLevelCache) {
-    static_cast<CacheInterface *>(m_nextLevelCache.get())->reverse();
+    m_nextLevelCache->reverse();
   }
 }
 
+CacheInterface::~CacheInterface() { setNextLevelCache(nullptr); }
+
+void CacheInterface::setNextLevelCache(
+    const std::shared_ptr<CacheInterface> &cache) {
+  if (m_nextLevelCache) {
+    auto &siblings = m_nextLevelCache->m_previousLevelCaches;
+    siblings.erase(std::remove(siblings.begin(), siblings.end(), this),
+                   siblings.end());
+  }
+  m_nextLevelCache = cache;
+  if (m_nextLevelCache) {
+    m_nextLevelCache->m_previousLevelCaches.push_back(this);
+  }
+}
+
+void CacheInterface::evict(AInt address, bool dirty) {
+  if (dirty) {
+    access(address, MemoryAccess::Write);
+  }
+}
+
+bool CacheInterface::invalidate(AInt address, unsigned bytes) {
+  return invalidatePreviousLevels(address, bytes);
+}
+
+bool CacheInterface::invalidatePreviousLevels(AInt address, unsigned bytes) {
+  bool dirty = false;
+  for (auto *cache : m_previousLevelCaches) {
+    dirty |= cache->invalidate(address, bytes);
+  }
+  return dirty;
+}
+
 CacheSim::CacheSim(QObject *parent) : CacheInterface(parent) {
   m_byteOffset = log2Ceil(ProcessorHandler::currentISA()->bytes());
   m_wordBits = ProcessorHandler::currentISA()->bits();
@@ -36,39 +70,32 @@ CacheSim::CacheSim(QObject *parent) : CacheInterface(parent) {
   updateConfiguration();
 }
 
-void CacheSim::updateCacheLineReplFields(CacheLine &line, unsigned wayIdx) {
-  if (getReplacementPolicy() == ReplPolicy::LRU) {
-    // Find previous LRU value for the updated index
-    const unsigned preLRU = line[wayIdx].lru;
-
-    // All indicies which are curently more recent than preLRU shall be
-    // incremented
-    for (auto &set : line) {
-      if (set.second.valid && set.second.lru < preLRU) {
-        set.second.lru++;
-      }
-    }
-
-    // Upgrade @p lruIdx to the most recently used
-    line[wayIdx].lru = 0;
-  }
+CacheSim::CacheSim(unsigned wordBytes, QObject *parent)
+    : CacheInterface(parent), m_detached(true) {
+  m_byteOffset = log2Ceil(wordBytes);
+  m_wordBits = wordBytes * CHAR_BIT;
+  updateConfiguration();
 }
 
-void CacheSim::revertCacheLineReplFields(CacheLine &line,
-                                         const CacheWay &oldWay,
-                                         unsigned wayIdx) {
-  if (getReplacementPolicy() == ReplPolicy::LRU) {
-    // All indicies which are curently less than or equal to the old LRU shall
-    // be decremented
-    for (auto &set : line) {
-      if (set.second.valid && set.second.lru <= oldWay.lru) {
-        set.second.lru--;
-      }
-    }
+bool CacheSim::isInteractive() const {
+  return !m_detached && !ProcessorHandler::isRunning();
+}
 
-    // Revert the oldWay LRU
-    line[wayIdx].lru = oldWay.lru;
+static std::unique_ptr<ReplacementEngine>
+createReplacementEngine(ReplPolicy policy) {
+  switch (policy) {
+  case ReplPolicy::Random:
+    return std::make_unique<RandomEngine>();
+  case ReplPolicy::LRU:
+    return std::make_unique<LRUEngine>();
+  case ReplPolicy::PLRU:
+    return std::make_unique<PLRUEngine>();
+  case ReplPolicy::FIFO:
+    return std::make_unique<FIFOEngine>();
+  case ReplPolicy::NRU:
+    return std::make_unique<NRUEngine>();
   }
+  Q_UNREACHABLE();
 }
 
 CacheSim::CacheSize CacheSim::getCacheSize() const {
@@ -88,10 +115,11 @@ CacheSim::CacheSize CacheSim::getCacheSize() const {
     size.bits += componentBits;
   }
 
-  if (m_replPolicy == ReplPolicy::LRU) {
-    // LRU bits
-    componentBits = getWaysBits() * entries;
-    size.components.push_back("LRU bits: " + QString::number(componentBits));
+  if (m_replPolicy != ReplPolicy::Random) {
+    // Replacement policy bits
+    componentBits = m_replEngine->bitsPerLine() * getLines();
+    size.components.push_back(s_cacheReplPolicyStrings.at(m_replPolicy) +
+                              " bits: " + QString::number(componentBits));
     size.bits += componentBits;
   }
 
@@ -108,66 +136,48 @@ CacheSim::CacheSize CacheSim::getCacheSize() const {
   return size;
 }
 
-std::pair<unsigned, CacheSim::CacheWay *>
-CacheSim::locateEvictionWay(const CacheTransaction &transaction) {
-  auto &cacheLine = m_cacheLines[transaction.index.line];
-
-  std::pair<unsigned, CacheSim::CacheWay *> ew;
-  ew.first = s_invalidIndex;
-  ew.second = nullptr;
-
-  // Locate a new way based on replacement policy.
-  if (m_replPolicy == ReplPolicy::Random) {
-    // Select a random way
-    ew.first = std::rand() % getWays();
-    ew.second = &cacheLine[ew.first];
-  } else if (m_replPolicy == ReplPolicy::LRU) {
-    if (getWays() == 1) {
-      // Nothing to do if we are in LRU and only have 1 set.
-      ew.first = 0;
-      ew.second = &cacheLine[ew.first];
-    } else {
-      // Lazily initialize all ways in the cacheline before starting to iterate.
-      for (int i = 0; i < getWays(); ++i)
-        cacheLine[i];
-
-      // If there is an invalid cache line, select that.
-      auto it =
-          std::find_if(cacheLine.begin(), cacheLine.end(),
-                       [=](const auto &way) { return !way.second.valid; });
-      if (it != cacheLine.end()) {
-        ew.first = it->first;
-        ew.second = &it->second;
-      }
-      if (ew.second == nullptr) {
-        // Else, Find LRU way.
-        for (auto &way : cacheLine) {
-          if (static_cast<long>(way.second.lru) == getWays() - 1) {
-            ew.first = way.first;
-            ew.second = &way.second;
-            break;
-          }
-        }
+unsigned CacheSim::locateEvictionWay(const CacheTransaction &transaction) {
+  const unsigned lineIdx = transaction.index.line;
+
+  // If there is an invalid way in the cache line, select that. Unless ways
+  // have been invalidated, the first invalid way is located right after the
+  // valid ways.
+  if (m_replEngine->fillsInvalidFirst() &&
+      m_validWays[lineIdx] < static_cast<unsigned>(getWays())) {
+    const WayState *line = &wayState(lineIdx, 0);
+    unsigned wayIdx = m_validWays[lineIdx];
+    if (line[wayIdx].valid) {
+      wayIdx = 0;
+      while (line[wayIdx].valid) {
+        wayIdx++;
       }
     }
+    return wayIdx;
   }
 
-  Q_ASSERT(ew.first != s_invalidIndex && "Unable to locate way for eviction");
-  Q_ASSERT(ew.second != nullptr && "Unable to locate way for eviction");
-  return ew;
+  // Else, locate a way based on the replacement policy.
+  const unsigned wayIdx = m_replEngine->victim(lineIdx);
+  Q_ASSERT(wayIdx < static_cast<unsigned>(getWays()) &&
+           "Unable to locate way for eviction");
+  return wayIdx;
 }
 
-CacheSim::CacheWay CacheSim::evictAndUpdate(CacheTransaction &transaction) {
-  const auto [wayIdx, wayPtr] = locateEvictionWay(transaction);
+CacheSim::WayState CacheSim::evictAndUpdate(CacheTransaction &transaction) {
+  const unsigned wayIdx = locateEvictionWay(transaction);
+  WayState &way = wayState(transaction.index.line, wayIdx);
+  uint64_t *mask = dirtyMask(transaction.index.line, wayIdx);
 
-  CacheWay eviction;
+  WayState eviction;
+  std::fill(m_oldDirtyMask.begin(), m_oldDirtyMask.end(), 0);
 
-  if (!wayPtr->valid) {
+  if (!way.valid) {
     // Record that this was an invalid->valid transition
     transaction.transToValid = true;
+    m_validWays[transaction.index.line]++;
   } else {
     // Store the old way info in our eviction trace, in case of rollbacks
-    eviction = *wayPtr;
+    eviction = way;
+    std::copy(mask, mask + m_dirtyMaskWords, m_oldDirtyMask.begin());
 
     if (eviction.dirty) {
       // The eviction will result in a writeback
@@ -176,52 +186,33 @@ CacheSim::CacheWay CacheSim::evictAndUpdate(CacheTransaction &transaction) {
   }
 
   // Invalidate the target way
-  *wayPtr = CacheWay();
+  way = WayState();
+  std::fill(mask, mask + m_dirtyMaskWords, 0);
 
   // Set required values in way, reflecting the newly loaded address
-  wayPtr->valid = true;
-  wayPtr->dirty = false;
-  wayPtr->tag = getTag(transaction.address);
+  way.valid = true;
+  way.dirty = false;
+  way.tag = getTag(transaction.address);
   transaction.tagChanged = true;
   transaction.index.way = wayIdx;
 
   return eviction;
 }
 
-unsigned CacheSim::getHits() const {
-  if (m_accessTrace.size() == 0) {
-    return 0;
-  } else {
-    auto &trace = m_accessTrace.rbegin()->second;
-    return trace.hits;
-  }
-}
+unsigned CacheSim::getHits() const { return m_accessLog.counters().hits; }
 
-unsigned CacheSim::getMisses() const {
-  if (m_accessTrace.size() == 0) {
-    return 0;
-  } else {
-    auto &trace = m_accessTrace.rbegin()->second;
-    return trace.misses;
-  }
-}
+unsigned CacheSim::getMisses() const { return m_accessLog.counters().misses; }
 
 unsigned CacheSim::getWritebacks() const {
-  if (m_accessTrace.size() == 0) {
-    return 0;
-  } else {
-    auto &trace = m_accessTrace.rbegin()->second;
-    return trace.writebacks;
-  }
+  return m_accessLog.counters().writebacks;
 }
 
 double CacheSim::getHitRate() const {
-  if (m_accessTrace.size() == 0) {
+  const auto &counters = m_accessLog.counters();
+  if (counters.accesses() == 0) {
     return 0;
-  } else {
-    auto &trace = m_accessTrace.rbegin()->second;
-    return static_cast<double>(trace.hits) / (trace.hits + trace.misses);
   }
+  return static_cast<double>(counters.hits) / counters.accesses();
 }
 
 void CacheSim::analyzeCacheAccess(CacheTransaction &transaction) const {
@@ -229,85 +220,94 @@ void CacheSim::analyzeCacheAccess(CacheTransaction &transaction) const {
   transaction.index.block = getBlockIdx(transaction.address);
 
   transaction.isHit = false;
-  if (m_cacheLines.count(transaction.index.line) != 0) {
-    for (const auto &way : m_cacheLines.at(transaction.index.line)) {
-      if ((way.second.tag == getTag(transaction.address)) && way.second.valid) {
-        transaction.index.way = way.first;
-        transaction.isHit = true;
-        break;
-      }
+  const VInt tag = getTag(transaction.address);
+  const WayState *line = &wayState(transaction.index.line, 0);
+  for (int i = 0; i < getWays(); ++i) {
+    if (line[i].valid && line[i].tag == tag) {
+      transaction.index.way = i;
+      transaction.isHit = true;
+      break;
     }
   }
 }
 
-void CacheSim::pushAccessTrace(const CacheTransaction &transaction) {
-  // Access traces are pushed in sorted order into the access trace map; indexed
-  // by a key corresponding to the cycle of the acces.
-  const unsigned currentCycle =
-      ProcessorHandler::getProcessor()->getCycleCount();
-
-  const CacheAccessTrace &mostRecentTrace =
-      m_accessTrace.size() == 0 ? CacheAccessTrace()
-                                : m_accessTrace.rbegin()->second;
-
-  m_accessTrace[currentCycle] = CacheAccessTrace(mostRecentTrace, transaction);
+void CacheSim::pushAccessTrace(const CacheTransaction &transaction,
+                               unsigned currentCycle) {
+  m_accessLog.push(currentCycle, transaction.type, transaction.isHit,
+                   transaction.isWriteback);
 
-  if (!ProcessorHandler::isRunning()) {
+  if (isInteractive()) {
     emit hitrateChanged();
   }
 }
 
 void CacheSim::popAccessTrace() {
-  Q_ASSERT(m_accessTrace.size() > 0);
-  // The access trace should have an entry
-  m_accessTrace.erase(m_accessTrace.rbegin()->first);
+  Q_ASSERT(!m_accessLog.empty());
+  m_accessLog.pop();
   emit hitrateChanged();
 }
 
 void CacheSim::access(AInt address, MemoryAccess::Type type) {
+  access(address, type, currentCycle());
+}
+
+unsigned CacheSim::currentCycle() const {
+  // Detached caches have no notion of processor cycles; each access is recorded
+  // as a separate step.
+  return m_detached ? m_accessLog.size()
+                    : ProcessorHandler::getProcessor()->getCycleCount();
+}
+
+void CacheSim::access(AInt address, MemoryAccess::Type type, unsigned cycle) {
   address = address & ~0b11; // Disregard unaligned accesses
   CacheTrace trace;
-  CacheWay oldWay;
+  trace.cycle = cycle;
+  WayState oldWay;
   CacheTransaction transaction;
   transaction.address = address;
   transaction.type = type;
 
   analyzeCacheAccess(transaction);
 
+  // Exclusive caches only allocate blocks upon eviction from an upper level.
+  const bool allocate =
+      m_inclusionPolicy != InclusionPolicy::Exclusive &&
+      (type == MemoryAccess::Read ||
+       (type == MemoryAccess::Write &&
+        getWriteAllocPolicy() == WriteAllocPolicy::WriteAllocate));
+
   if (!transaction.isHit) {
-    if (type == MemoryAccess::Read ||
-        (type == MemoryAccess::Write &&
-         getWriteAllocPolicy() == WriteAllocPolicy::WriteAllocate)) {
+    if (allocate) {
       oldWay = evictAndUpdate(transaction);
+    } else {
+      std::fill(m_oldDirtyMask.begin(), m_oldDirtyMask.end(), 0);
     }
   } else {
-    oldWay = m_cacheLines[transaction.index.line][transaction.index.way];
+    oldWay = wayState(transaction.index.line, transaction.index.way);
+    const uint64_t *mask =
+        dirtyMask(transaction.index.line, transaction.index.way);
+    std::copy(mask, mask + m_dirtyMaskWords, m_oldDirtyMask.begin());
   }
 
   // === Update dirty and LRU bits ===
 
-  // Initially, we need a check for the case of "write + miss + noWriteAlloc".
-  // In this case, we should not update replacement/dirty fields. In all other
-  // cases, this is a valid action.
-  const bool writeMissNoAlloc =
-      !transaction.isHit && type == MemoryAccess::Write &&
-      getWriteAllocPolicy() == WriteAllocPolicy::NoWriteAllocate;
-
-  if (!writeMissNoAlloc) {
-    // Lazily ensure that the located way has been initialized
-    m_cacheLines[transaction.index.line][transaction.index.way];
+  // Initially, we need a check for the case of a miss without allocation (ie.
+  // "write + miss + noWriteAlloc"). In this case, we should not update
+  // replacement/dirty fields. In all other cases, this is a valid action.
+  const bool missNoAlloc = !transaction.isHit && !allocate;
 
+  if (!missNoAlloc) {
     if (type == MemoryAccess::Write &&
         getWritePolicy() == WritePolicy::WriteBack) {
-      CacheWay &way =
-          m_cacheLines[transaction.index.line][transaction.index.way];
-      way.dirty = true;
-      way.dirtyBlocks.insert(transaction.index.block);
+      wayState(transaction.index.line, transaction.index.way).dirty = true;
+      dirtyMask(transaction.index.line,
+                transaction.index.way)[transaction.index.block / 64] |=
+          UINT64_C(1) << (transaction.index.block % 64);
     }
 
-    updateCacheLineReplFields(m_cacheLines[transaction.index.line],
-                              transaction.index.way);
-  } else {
+    trace.replToken = m_replEngine->touch(
+        transaction.index.line, transaction.index.way, transaction.tagChanged);
+  } else if (type == MemoryAccess::Write) {
     // In case of a write miss with no write allocate, the value is always
     // written through to memory (a writeback)
     transaction.isWriteback = true;
@@ -322,57 +322,211 @@ void CacheSim::access(AInt address, MemoryAccess::Type type) {
 
   // ===========================
 
-  // At this point, no further changes shall be made to the transaction.
-  // We record the transaction as well as a possible eviction
+  // At this point, no further changes shall be made to the cache state by this
+  // access. We record the transaction as well as a possible eviction. The
+  // trace must be recorded prior to propagating the access through the
+  // hierarchy, given that other levels may invalidate ways within this cache.
   trace.oldWay = oldWay;
   trace.transaction = transaction;
-  pushTrace(trace);
-  pushAccessTrace(transaction);
+  if (!m_detached) {
+    pushTrace(trace);
+  }
 
-  // === Some sanity checking ===
-  // It should never be possible that a read returns an invalid way index
-  if (type == MemoryAccess::Read) {
-    transaction.index.assertValid();
+  // === Propagate the access through the cache hierarchy ===
+  const AInt blockAddress = address & ~static_cast<AInt>(blockBytes() - 1);
+  if (m_nextLevelCache) {
+    if (!transaction.isHit && (allocate || type == MemoryAccess::Read)) {
+      // Fetch the missing block
+      m_nextLevelCache->access(blockAddress, MemoryAccess::Read);
+    }
+    if (type == MemoryAccess::Write &&
+        (missNoAlloc || getWritePolicy() == WritePolicy::WriteThrough)) {
+      // Write-through or write-around
+      m_nextLevelCache->access(address, MemoryAccess::Write);
+    }
+  }
+  if (!transaction.isHit && oldWay.valid) {
+    transaction.isWriteback |=
+        propagateEviction(oldWay, transaction.index.line);
+  }
+  if (m_inclusionPolicy == InclusionPolicy::Exclusive && transaction.isHit &&
+      type == MemoryAccess::Read) {
+    // The block moves to the upper level. Dirty data is written back to the
+    // next level, given that upper levels fill blocks clean.
+    if (invalidateWay(transaction.index.line, transaction.index.way, cycle)) {
+      transaction.isWriteback = true;
+      if (m_nextLevelCache) {
+        m_nextLevelCache->evict(blockAddress, true);
+      }
+    }
   }
 
-  // It should never be possible that a write returns an invalid way index if we
-  // write-allocate
-  if (type == MemoryAccess::Write &&
-      getWriteAllocPolicy() == WriteAllocPolicy::WriteAllocate) {
+  pushAccessTrace(transaction, cycle);
+
+  // === Some sanity checking ===
+  // It should never be possible that an allocating access returns an invalid
+  // way index
+  if (!missNoAlloc) {
     transaction.index.assertValid();
   }
 
   // ===========================
-  if (writeMissNoAlloc) {
+  if (missNoAlloc) {
     // There are no graphical changes to perform since nothing is pulled into
-    // the cache upon a missed write without write allocation
+    // the cache upon a miss without allocation
+    return;
+  }
+
+  if (isInteractive()) {
+    emit dataChanged(transaction);
+  }
+}
+
+void CacheSim::evict(AInt address, bool dirty) {
+  if (m_inclusionPolicy != InclusionPolicy::Exclusive) {
+    CacheInterface::evict(address, dirty);
     return;
   }
 
-  if (!ProcessorHandler::isRunning()) {
+  // Allocate the block evicted from the upper level. This is not an access of
+  // the cache, and is thus not recorded in the access log.
+  CacheTrace trace;
+  trace.kind = CacheTrace::Kind::Fill;
+  trace.cycle = currentCycle();
+  WayState oldWay;
+  CacheTransaction transaction;
+  transaction.address = address & ~0b11;
+  transaction.type = dirty ? MemoryAccess::Write : MemoryAccess::Read;
+
+  analyzeCacheAccess(transaction);
+  if (!transaction.isHit) {
+    oldWay = evictAndUpdate(transaction);
+  } else {
+    oldWay = wayState(transaction.index.line, transaction.index.way);
+    const uint64_t *mask =
+        dirtyMask(transaction.index.line, transaction.index.way);
+    std::copy(mask, mask + m_dirtyMaskWords, m_oldDirtyMask.begin());
+  }
+
+  const bool writeThrough =
+      dirty && getWritePolicy() == WritePolicy::WriteThrough;
+  if (dirty && !writeThrough) {
+    wayState(transaction.index.line, transaction.index.way).dirty = true;
+    dirtyMask(transaction.index.line,
+              transaction.index.way)[transaction.index.block / 64] |=
+        UINT64_C(1) << (transaction.index.block % 64);
+  }
+  trace.replToken = m_replEngine->touch(
+      transaction.index.line, transaction.index.way, transaction.tagChanged);
+
+  trace.oldWay = oldWay;
+  trace.transaction = transaction;
+  if (!m_detached) {
+    pushTrace(trace);
+  }
+
+  if (writeThrough && m_nextLevelCache) {
+    m_nextLevelCache->access(transaction.address, MemoryAccess::Write);
+  }
+  if (!transaction.isHit && oldWay.valid) {
+    propagateEviction(oldWay, transaction.index.line);
+  }
+
+  if (isInteractive()) {
     emit dataChanged(transaction);
   }
 }
 
+bool CacheSim::propagateEviction(const WayState &evicted, unsigned lineIdx) {
+  const AInt address = buildAddress(evicted.tag, lineIdx, 0);
+  bool dirty = evicted.dirty;
+  if (m_inclusionPolicy == InclusionPolicy::Inclusive) {
+    dirty |= invalidatePreviousLevels(address, blockBytes());
+  }
+  if (m_nextLevelCache) {
+    m_nextLevelCache->evict(address, dirty);
+  }
+  return dirty;
+}
+
+bool CacheSim::invalidate(AInt address, unsigned bytes) {
+  const unsigned cycle = currentCycle();
+  bool dirty = false;
+  const AInt end = address + bytes;
+  for (AInt block = address & ~static_cast<AInt>(blockBytes() - 1);
+       block < end; block += blockBytes()) {
+    CacheTransaction transaction;
+    transaction.address = block;
+    analyzeCacheAccess(transaction);
+    if (transaction.isHit) {
+      dirty |= invalidateWay(transaction.index.line, transaction.index.way,
+                             cycle);
+    }
+  }
+
+  // Maintain the inclusion of the levels above this cache.
+  dirty |= invalidatePreviousLevels(address, bytes);
+  return dirty;
+}
+
+bool CacheSim::invalidateWay(unsigned lineIdx, unsigned wayIdx,
+                             unsigned cycle) {
+  WayState &way = wayState(lineIdx, wayIdx);
+  uint64_t *mask = dirtyMask(lineIdx, wayIdx);
+  const bool dirty = way.dirty;
+
+  if (!m_detached) {
+    CacheTrace trace;
+    trace.kind = CacheTrace::Kind::Invalidate;
+    trace.cycle = cycle;
+    trace.transaction.address = buildAddress(way.tag, lineIdx, 0);
+    trace.transaction.index.line = lineIdx;
+    trace.transaction.index.way = wayIdx;
+    trace.oldWay = way;
+    std::copy(mask, mask + m_dirtyMaskWords, m_oldDirtyMask.begin());
+    pushTrace(trace);
+  }
+
+  way = WayState();
+  std::fill(mask, mask + m_dirtyMaskWords, 0);
+  m_validWays[lineIdx]--;
+
+  if (isInteractive()) {
+    emit wayInvalidated(lineIdx, wayIdx);
+  }
+  return dirty;
+}
+
 void CacheSim::undo() {
   if (m_traceStack.size() == 0)
     return;
 
   const auto trace = popTrace();
-  popAccessTrace();
+  if (trace.kind == CacheTrace::Kind::Access) {
+    popAccessTrace();
+  }
 
   const auto &oldWay = trace.oldWay;
   const unsigned &lineIdx = trace.transaction.index.line;
   const unsigned &wayIdx = trace.transaction.index.way;
-  auto &line = m_cacheLines.at(lineIdx);
-  auto &way = line.at(wayIdx);
+  if (wayIdx == s_invalidIndex) {
+    // A write miss without write allocation; no changes were made to the cache
+    // state.
+    return;
+  }
+  WayState &way = wayState(lineIdx, wayIdx);
 
+  // Case 0: A valid way was invalidated. Restore the way.
+  if (trace.kind == CacheTrace::Kind::Invalidate) {
+    way = oldWay;
+    m_validWays[lineIdx]++;
+  }
   // Case 1: A cache way was transitioned to valid. In this case, we simply
   // invalidate the cache way
-  if (trace.transaction.transToValid) {
+  else if (trace.transaction.transToValid) {
     // Invalidate the way
-    Q_ASSERT(m_cacheLines.at(lineIdx).count(wayIdx) != 0);
-    way = CacheWay();
+    way = WayState();
+    m_validWays[lineIdx]--;
   }
   // Case 2: A miss occured on a valid entry. In this case, we have to restore
   // the old way, which was evicted
@@ -380,10 +534,17 @@ void CacheSim::undo() {
   else if (!trace.transaction.isHit) {
     way = oldWay;
   }
-  // Case 3: Else, it was a cache hit; Revert replacement fields and dirty
-  // blocks
-  way.dirtyBlocks = oldWay.dirtyBlocks;
-  revertCacheLineReplFields(line, oldWay, wayIdx);
+  // Case 3: Else, it was a cache hit; Revert replacement fields, dirty bit and
+  // dirty blocks
+  else {
+    way.dirty = oldWay.dirty;
+  }
+  std::copy(m_oldDirtyMask.begin(), m_oldDirtyMask.end(),
+            dirtyMask(lineIdx, wayIdx));
+  if (trace.kind != CacheTrace::Kind::Invalidate) {
+    m_replEngine->revert(lineIdx, wayIdx, trace.transaction.tagChanged,
+                         trace.replToken);
+  }
 
   // Notify that changes to the way has been performed
   emit wayInvalidated(lineIdx, wayIdx);
@@ -401,13 +562,25 @@ CacheSim::CacheTrace CacheSim::popTrace() {
   Q_ASSERT(m_traceStack.size() > 0);
   auto val = m_traceStack.front();
   m_traceStack.pop_front();
+
+  // Restore the dirty-block mask recorded alongside the trace into the scratch
+  // buffer.
+  std::copy(m_traceDirtyMasks.begin(),
+            m_traceDirtyMasks.begin() + m_dirtyMaskWords,
+            m_oldDirtyMask.begin());
+  m_traceDirtyMasks.erase(m_traceDirtyMasks.begin(),
+                          m_traceDirtyMasks.begin() + m_dirtyMaskWords);
   return val;
 }
 
 void CacheSim::pushTrace(const CacheTrace &eviction) {
   m_traceStack.push_front(eviction);
+  m_traceDirtyMasks.insert(m_traceDirtyMasks.begin(), m_oldDirtyMask.begin(),
+                           m_oldDirtyMask.end());
   if (m_traceStack.size() > vsrtl::core::ClockedComponent::reverseStackSize()) {
     m_traceStack.pop_back();
+    m_traceDirtyMasks.erase(m_traceDirtyMasks.end() - m_dirtyMaskWords,
+                            m_traceDirtyMasks.end());
   }
 }
 
@@ -438,29 +611,57 @@ unsigned CacheSim::getBlockIdx(const AInt address) const {
   return maskedAddress;
 }
 
-const CacheSim::CacheLine *CacheSim::getLine(unsigned idx) const {
-  if (m_cacheLines.count(idx)) {
-    return &m_cacheLines.at(idx);
+std::optional<CacheSim::CacheLine> CacheSim::getLine(unsigned idx) const {
+  if (idx < static_cast<unsigned>(getLines())) {
+    return CacheLine(*this, idx);
   } else {
-    return nullptr;
+    return {};
+  }
+}
+
+CacheSim::CacheWay CacheSim::getWay(unsigned lineIdx, unsigned wayIdx) const {
+  CacheWay way;
+  if (lineIdx >= static_cast<unsigned>(getLines()) ||
+      wayIdx >= static_cast<unsigned>(getWays())) {
+    return way;
+  }
+
+  const WayState &state = wayState(lineIdx, wayIdx);
+  way.tag = state.tag;
+  way.valid = state.valid;
+  way.dirty = state.dirty;
+  if (state.valid) {
+    way.lru = m_replEngine->rank(lineIdx, wayIdx);
+  }
+
+  const uint64_t *mask = dirtyMask(lineIdx, wayIdx);
+  for (unsigned word = 0; word < m_dirtyMaskWords; ++word) {
+    for (uint64_t bits = mask[word]; bits != 0; bits &= bits - 1) {
+      way.dirtyBlocks.insert(word * 64 + firstSetBitIdx(bits));
+    }
   }
+  return way;
 }
 
 void CacheSim::reverse() {
-  if (m_accessTrace.size() == 0) {
+  if (m_detached || m_traceStack.empty()) {
     // Nothing to reverse
     return;
   }
 
   const unsigned cycleToUndo =
       ProcessorHandler::getProcessor()->getCycleCount() + 1;
-  if (m_accessTrace.rbegin()->first != cycleToUndo) {
+  if (m_traceStack.front().cycle != cycleToUndo) {
     // No cache access in this cycle
     return;
   }
 
-  // It is now safe to undo the cycle at the top of our access stack(s).
-  undo();
+  // It is now safe to undo the cycle at the top of our access stack(s). Within
+  // a cache hierarchy, a single cycle may comprise multiple modifications of
+  // the cache (ie. accesses from multiple upper levels, or invalidations).
+  while (!m_traceStack.empty() && m_traceStack.front().cycle == cycleToUndo) {
+    undo();
+  }
 
   CacheInterface::reverse();
 }
@@ -482,12 +683,13 @@ void CacheSim::reset() {
 
   m_isResetting = true;
 
-  m_cacheLines.clear();
-  m_accessTrace.clear();
-  m_traceStack.clear();
+  resizeStorage();
+  m_accessLog.clear();
 
-  m_wordBits = ProcessorHandler::currentISA()->bits();
-  m_byteOffset = log2Ceil(ProcessorHandler::currentISA()->bytes());
+  if (!m_detached) {
+    m_wordBits = ProcessorHandler::currentISA()->bits();
+    m_byteOffset = log2Ceil(ProcessorHandler::currentISA()->bytes());
+  }
   recalculateMasks();
   m_isResetting = false;
 
@@ -497,10 +699,28 @@ void CacheSim::reset() {
   CacheInterface::reset();
 }
 
+void CacheSim::resizeStorage() {
+  const unsigned entries = getLines() * getWays();
+  m_dirtyMaskWords = (getBlocks() + 63) / 64;
+  m_wayStates.assign(entries, WayState());
+  m_dirtyBlockMasks.assign(entries * m_dirtyMaskWords, 0);
+  m_oldDirtyMask.assign(m_dirtyMaskWords, 0);
+  m_validWays.assign(getLines(), 0);
+  m_replEngine = createReplacementEngine(m_replPolicy);
+  m_replEngine->reset(getLines(), getWays());
+
+  // Trace entries refer to indices within the previous storage layout.
+  m_traceStack.clear();
+  m_traceDirtyMasks.clear();
+}
+
 void CacheSim::updateConfiguration() {
   // Recalculate masks
-  m_byteOffset = log2Ceil(ProcessorHandler::currentISA()->bytes());
+  if (!m_detached) {
+    m_byteOffset = log2Ceil(ProcessorHandler::currentISA()->bytes());
+  }
   recalculateMasks();
+  resizeStorage();
   emit configurationChanged();
 }
 
@@ -534,6 +754,11 @@ void CacheSim::setReplacementPolicy(ReplPolicy policy) {
   updateConfiguration();
 }
 
+void CacheSim::setInclusionPolicy(InclusionPolicy policy) {
+  m_inclusionPolicy = policy;
+  updateConfiguration();
+}
+
 void CacheSim::setPreset(const CachePreset &preset) {
   m_blocks = preset.blocks;
   m_ways = preset.ways;
@@ -1,13 +1,19 @@
 #pragma once
 
+#include <deque>
 #include <map>
 #include <math.h>
+#include <memory>
+#include <optional>
+#include <set>
 #include <vector>
 
 #include <QDataStream>
 #include <QObject>
 
 #include "../external/VSRTL/core/vsrtl_register.h"
+#include "cacheaccesslog.h"
+#include "cachereplacement.h"
 #include "processors/RISC-V/rv_memory.h"
 #include "processors/interface/ripesprocessor.h"
 
@@ -16,7 +22,21 @@ class CacheSim;
 
 enum WriteAllocPolicy { WriteAllocate, NoWriteAllocate };
 enum WritePolicy { WriteThrough, WriteBack };
-enum ReplPolicy { Random, LRU };
+enum ReplPolicy { Random, LRU, PLRU, FIFO, NRU };
+
+/**
+ * @brief The InclusionPolicy enum
+ * Content policy of a cache with respect to the caches of the levels above it
+ * (its logical children).
+ * - NINE: Non-inclusive, non-exclusive. Blocks are allocated upon a miss, and
+ *   evictions do not affect the upper levels.
+ * - Inclusive: Blocks evicted from this cache are invalidated in all upper
+ *   levels (back-invalidation).
+ * - Exclusive: The cache acts as a victim cache for the upper levels. Blocks
+ *   are only allocated upon being evicted from an upper level, and are removed
+ *   from this cache when read by an upper level.
+ */
+enum InclusionPolicy { NINE, Inclusive, Exclusive };
 
 struct CachePreset {
   QString name;
@@ -59,7 +79,7 @@ class CacheInterface : public QObject {
   Q_OBJECT
 public:
   CacheInterface(QObject *parent) : QObject(parent) {}
-  virtual ~CacheInterface() {}
+  virtual ~CacheInterface();
 
   /**
    * @brief access
@@ -67,9 +87,24 @@ public:
    * desires to access this cache
    */
   virtual void access(AInt address, MemoryAccess::Type type) = 0;
-  void setNextLevelCache(const std::shared_ptr<CacheSim> &cache) {
-    m_nextLevelCache = cache;
-  }
+
+  /**
+   * @brief evict
+   * Called by the logical child of this cache when it evicts the block at
+   * @p address. By default, only dirty blocks are propagated, as a write
+   * (writeback) to this cache.
+   */
+  virtual void evict(AInt address, bool dirty);
+
+  /**
+   * @brief invalidate
+   * Called by the logical parent of this cache to invalidate any blocks within
+   * [@p address; @p address + @p bytes) in this cache and the levels above it.
+   * Returns true if any of the invalidated blocks were dirty.
+   */
+  virtual bool invalidate(AInt address, unsigned bytes);
+
+  void setNextLevelCache(const std::shared_ptr<CacheInterface> &cache);
 
   /**
    * @brief reset
@@ -80,11 +115,20 @@ public:
   virtual void reverse();
 
 protected:
+  /// Invalidates a block range in all caches of the levels above this cache.
+  bool invalidatePreviousLevels(AInt address, unsigned bytes);
+
   /**
    * @brief m_nextLevelCache
    * Pointer to the next level (logical parent) cache.
    */
-  std::shared_ptr<CacheSim> m_nextLevelCache;
+  std::shared_ptr<CacheInterface> m_nextLevelCache;
+
+  /**
+   * @brief m_previousLevelCaches
+   * The caches which have this cache as their next level (logical children).
+   */
+  std::vector<CacheInterface *> m_previousLevelCaches;
 };
 
 class CacheSim : public CacheInterface {
@@ -97,6 +141,12 @@ public:
     std::vector<QString> components;
   };
 
+  /**
+   * @brief The CacheWay struct
+   * Materialized view of a single cache way. The cache state itself is stored
+   * in a packed, flat representation (see WayState); CacheWay values are
+   * constructed on demand for inspection (ie. by the graphical view).
+   */
   struct CacheWay {
     VInt tag = -1;
     std::set<unsigned> dirtyBlocks;
@@ -138,45 +188,59 @@ public:
         false; // True if transToValid or the previous entry was evicted
   };
 
-  struct CacheAccessTrace {
-    int hits = 0;
-    int misses = 0;
-    int reads = 0;
-    int writes = 0;
-    int writebacks = 0;
-    CacheTransaction lastTransaction;
-    CacheAccessTrace() {}
-    CacheAccessTrace(const CacheTransaction &transaction)
-        : CacheAccessTrace(CacheAccessTrace(), transaction) {}
-    CacheAccessTrace(const CacheAccessTrace &pre,
-                     const CacheTransaction &transaction) {
-      lastTransaction = transaction;
-      reads = pre.reads + (transaction.type == MemoryAccess::Read ? 1 : 0);
-      writes = pre.writes + (transaction.type == MemoryAccess::Write ? 1 : 0);
-      writebacks = pre.writebacks + (transaction.isWriteback ? 1 : 0);
-      hits = pre.hits + (transaction.isHit ? 1 : 0);
-      misses = pre.misses + (transaction.isHit ? 0 : 1);
+  /**
+   * @brief The CacheLine class
+   * Lightweight, read-only view of a single cache line within the flat cache
+   * storage.
+   */
+  class CacheLine {
+  public:
+    CacheLine(const CacheSim &cache, unsigned lineIdx)
+        : m_cache(cache), m_lineIdx(lineIdx) {}
+    CacheWay at(unsigned wayIdx) const {
+      return m_cache.getWay(m_lineIdx, wayIdx);
     }
-  };
+    unsigned size() const { return m_cache.getWays(); }
 
-  using CacheLine = std::map<unsigned, CacheWay>;
+  private:
+    const CacheSim &m_cache;
+    unsigned m_lineIdx;
+  };
 
   CacheSim(QObject *parent);
+
+  /**
+   * @brief CacheSim
+   * Constructs a cache simulator which is detached from the ProcessorHandler,
+   * modelling a memory system of @p wordBytes bytes per word. Detached caches
+   * are driven exclusively through access(), do not record undo traces and do
+   * not emit per-access signals. They are intended for trace-driven simulation.
+   */
+  CacheSim(unsigned wordBytes, QObject *parent);
+
   void setWritePolicy(WritePolicy policy);
   void setWriteAllocatePolicy(WriteAllocPolicy policy);
   void setReplacementPolicy(ReplPolicy policy);
+  void setInclusionPolicy(InclusionPolicy policy);
 
   void access(AInt address, MemoryAccess::Type type) override;
+  void evict(AInt address, bool dirty) override;
+  bool invalidate(AInt address, unsigned bytes) override;
+  /**
+   * @brief access
+   * Accesses the cache, recording the access as having occurred in @p cycle.
+   */
+  void access(AInt address, MemoryAccess::Type type, unsigned cycle);
   void undo();
   void reset() override;
 
   WriteAllocPolicy getWriteAllocPolicy() const { return m_wrAllocPolicy; }
   ReplPolicy getReplacementPolicy() const { return m_replPolicy; }
   WritePolicy getWritePolicy() const { return m_wrPolicy; }
+  InclusionPolicy getInclusionPolicy() const { return m_inclusionPolicy; }
+  bool isDetached() const { return m_detached; }
 
-  const std::map<unsigned, CacheAccessTrace> &getAccessTrace() const {
-    return m_accessTrace;
-  }
+  const CacheAccessLog &getAccessLog() const { return m_accessLog; }
 
   double getHitRate() const;
   unsigned getHits() const;
@@ -193,9 +257,9 @@ public:
     return 32 - 2 /*byte offset*/ - getBlockBits() - getLineBits();
   }
 
-  int getBlocks() const { return static_cast<int>(std::pow(2, m_blocks)); }
-  int getWays() const { return static_cast<int>(std::pow(2, m_ways)); }
-  int getLines() const { return static_cast<int>(std::pow(2, m_lines)); }
+  int getBlocks() const { return 1 << m_blocks; }
+  int getWays() const { return 1 << m_ways; }
+  int getLines() const { return 1 << m_lines; }
   unsigned getBlockMask() const { return m_blockMask; }
   unsigned getTagMask() const { return m_tagMask; }
   unsigned getLineMask() const { return m_lineMask; }
@@ -204,7 +268,8 @@ public:
   unsigned getBlockIdx(const AInt address) const;
   unsigned getTag(const AInt address) const;
 
-  const CacheLine *getLine(unsigned idx) const;
+  std::optional<CacheLine> getLine(unsigned idx) const;
+  CacheWay getWay(unsigned lineIdx, unsigned wayIdx) const;
 
 public slots:
   void setBlocks(unsigned blocks);
@@ -240,16 +305,61 @@ signals:
   void cacheInvalidated();
 
 private:
+  /**
+   * @brief The WayState struct
+   * Packed per-way cache state. The dirty-block bitmask of a way is stored
+   * separately in m_dirtyBlockMasks.
+   */
+  struct WayState {
+    VInt tag = -1;
+    bool valid = false;
+    bool dirty = false;
+  };
+
   struct CacheTrace {
+    /**
+     * Access: An access of the cache, recorded in the access log.
+     * Fill: A block allocated in an exclusive cache upon eviction from an upper
+     * level.
+     * Invalidate: A way invalidated through invalidate().
+     */
+    enum class Kind { Access, Fill, Invalidate };
+    Kind kind = Kind::Access;
+    unsigned cycle = 0;
     CacheTransaction transaction;
-    CacheWay oldWay;
+    WayState oldWay;
+    ReplacementEngine::UndoToken replToken = 0;
   };
 
-  std::pair<unsigned, CacheSim::CacheWay *>
-  locateEvictionWay(const CacheTransaction &transaction);
-  CacheWay evictAndUpdate(CacheTransaction &transaction);
+  unsigned locateEvictionWay(const CacheTransaction &transaction);
+  WayState evictAndUpdate(CacheTransaction &transaction);
+
+  /**
+   * @brief propagateEviction
+   * Propagates the eviction of @p evicted from line @p lineIdx to the next
+   * level cache, back-invalidating the block in the upper levels if this cache
+   * is inclusive. Returns true if the eviction resulted in a writeback.
+   */
+  bool propagateEviction(const WayState &evicted, unsigned lineIdx);
+
+  /**
+   * @brief invalidateWay
+   * Invalidates a valid way. Returns true if the way was dirty.
+   */
+  bool invalidateWay(unsigned lineIdx, unsigned wayIdx, unsigned cycle);
+
+  /// Returns the cycle in which an access performed now should be recorded.
+  unsigned currentCycle() const;
+  unsigned blockBytes() const { return getBlocks() << m_byteOffset; }
   void analyzeCacheAccess(CacheTransaction &transaction) const;
-  void pushAccessTrace(const CacheTransaction &transaction);
+  void pushAccessTrace(const CacheTransaction &transaction, unsigned cycle);
+
+  /**
+   * @brief isInteractive
+   * Returns true if per-access signals should be emitted, ie. when attached to
+   * a processor which is not currently running.
+   */
+  bool isInteractive() const;
   void popAccessTrace();
 
   /**
@@ -260,6 +370,28 @@ private:
   void updateConfiguration();
   void recalculateMasks();
 
+  /**
+   * @brief resizeStorage
+   * (Re)allocates and invalidates the flat cache storage according to the
+   * current cache geometry.
+   */
+  void resizeStorage();
+
+  WayState &wayState(unsigned lineIdx, unsigned wayIdx) {
+    return m_wayStates[(lineIdx << m_ways) + wayIdx];
+  }
+  const WayState &wayState(unsigned lineIdx, unsigned wayIdx) const {
+    return m_wayStates[(lineIdx << m_ways) + wayIdx];
+  }
+  uint64_t *dirtyMask(unsigned lineIdx, unsigned wayIdx) {
+    return &m_dirtyBlockMasks[((lineIdx << m_ways) + wayIdx) *
+                              m_dirtyMaskWords];
+  }
+  const uint64_t *dirtyMask(unsigned lineIdx, unsigned wayIdx) const {
+    return &m_dirtyBlockMasks[((lineIdx << m_ways) + wayIdx) *
+                              m_dirtyMaskWords];
+  }
+
   /**
    * @brief reassociateMemory
    * Binds to a memory component exposed by the processor handler, based on the
@@ -270,6 +402,7 @@ private:
   ReplPolicy m_replPolicy = ReplPolicy::LRU;
   WritePolicy m_wrPolicy = WritePolicy::WriteBack;
   WriteAllocPolicy m_wrAllocPolicy = WriteAllocPolicy::WriteAllocate;
+  InclusionPolicy m_inclusionPolicy = InclusionPolicy::NINE;
 
   unsigned m_blockMask = -1;
   unsigned m_lineMask = -1;
@@ -282,27 +415,50 @@ private:
   unsigned m_wordBits = -1;
 
   /**
-   * @brief m_cacheLines
-   * The datastructure for storing our cache hierachy, as per the current cache
-   * configuration.
+   * @brief m_wayStates
+   * The datastructure for storing our cache state, as per the current cache
+   * configuration. Ways are stored contiguously in a flat lines × ways array,
+   * indexed by (lineIdx * ways + wayIdx).
    */
-  std::map<unsigned, CacheLine> m_cacheLines;
+  std::vector<WayState> m_wayStates;
 
-  void updateCacheLineReplFields(CacheLine &line, unsigned wayIdx);
   /**
-   * @brief revertCacheLineReplFields
-   * Called whenever undoing a transaction to the cache. Reverts a cacheline's
-   * replacement fields according to the configured replacement policy.
+   * @brief m_dirtyBlockMasks
+   * Dirty-block bitmasks for each way, laid out parallel to m_wayStates with
+   * m_dirtyMaskWords 64-bit words per way.
    */
-  void revertCacheLineReplFields(CacheLine &line, const CacheWay &oldWay,
-                                 unsigned wayIdx);
+  std::vector<uint64_t> m_dirtyBlockMasks;
+  unsigned m_dirtyMaskWords = 1;
 
   /**
-   * @brief m_accessTrace
-   * The access trace stack contains cache access statistics for each simulation
-   * cycle. Contrary to the TraceStack (m_traceStack).
+   * @brief m_oldDirtyMask
+   * Scratch buffer holding the dirty-block mask of the way modified by the
+   * current transaction, prior to the modification.
    */
-  std::map<unsigned, CacheAccessTrace> m_accessTrace;
+  std::vector<uint64_t> m_oldDirtyMask;
+
+  /**
+   * @brief m_validWays
+   * Number of valid ways within each cache line. Unless the replacement policy
+   * is random, invalid ways are filled before any valid way is replaced. In the
+   * absence of invalidations (see invalidate()), ways are filled in ascending
+   * order, and the valid ways of a line are the ways [0; m_validWays[line]).
+   */
+  std::vector<unsigned> m_validWays;
+
+  /**
+   * @brief m_replEngine
+   * Replacement state of the cache, as per the configured replacement policy.
+   */
+  std::unique_ptr<ReplacementEngine> m_replEngine;
+
+  /**
+   * @brief m_accessLog
+   * The access log contains cache access statistics for each simulation cycle
+   * in which the cache was accessed. Contrary to the TraceStack (m_traceStack),
+   * the access log is not bounded by the undo stack size.
+   */
+  CacheAccessLog m_accessLog;
 
   /**
    * @brief m_traceStack
@@ -313,6 +469,15 @@ private:
    */
   std::deque<CacheTrace> m_traceStack;
 
+  /**
+   * @brief m_traceDirtyMasks
+   * Dirty-block masks of the ways modified by each entry in m_traceStack, prior
+   * to the modification. Each trace entry owns m_dirtyMaskWords consecutive
+   * words, ordered such that the front of the deque belongs to the front of
+   * m_traceStack.
+   */
+  std::deque<uint64_t> m_traceDirtyMasks;
+
   /**
    * @brief m_isResetting
    * The cacheSim can be reset by either internally modyfing cache configuration
@@ -324,12 +489,23 @@ private:
    */
   bool m_isResetting = false;
 
+  /**
+   * @brief m_detached
+   * True if this cache is not attached to the ProcessorHandler; see the
+   * detached CacheSim constructor.
+   */
+  bool m_detached = false;
+
   CacheTrace popTrace();
   void pushTrace(const CacheTrace &trace);
 };
 
 const static std::map<ReplPolicy, QString> s_cacheReplPolicyStrings{
-    {ReplPolicy::Random, "Random"}, {ReplPolicy::LRU, "LRU"}};
+    {ReplPolicy::Random, "Random"},
+    {ReplPolicy::LRU, "LRU"},
+    {ReplPolicy::PLRU, "Tree-PLRU"},
+    {ReplPolicy::FIFO, "FIFO"},
+    {ReplPolicy::NRU, "NRU"}};
 const static std::map<WriteAllocPolicy, QString> s_cacheWriteAllocateStrings{
     {WriteAllocPolicy::WriteAllocate, "Write allocate"},
     {WriteAllocPolicy::NoWriteAllocate, "No write allocate"}};
@@ -338,6 +514,11 @@ const static std::map<WritePolicy, QString> s_cacheWritePolicyStrings{
     {WritePolicy::WriteThrough, "Write-through"},
     {WritePolicy::WriteBack, "Write-back"}};
 
+const static std::map<InclusionPolicy, QString> s_cacheInclusionPolicyStrings{
+    {InclusionPolicy::NINE, "Non-inclusive non-exclusive"},
+    {InclusionPolicy::Inclusive, "Inclusive"},
+    {InclusionPolicy::Exclusive, "Exclusive"}};
+
 } // namespace Ripes
 
 Q_DECLARE_METATYPE(Ripes::CacheSim::CacheTransaction);
@@ -0,0 +1,167 @@
+#include "cachesweep.h"
+#include "l1cacheshim.h"
+
+#include "processorhandler.h"
+
+#include <algorithm>
+
+namespace Ripes {
+
+// Accesses are published to the workers in batches of this size, amortizing
+// the synchronization cost of the ring buffer.
+static constexpr size_t s_batchSize = 256;
+static constexpr unsigned s_ringSizeLog2 = 16;
+
+static unsigned sweepWorkers(size_t configs) {
+  const unsigned hwThreads = std::max(1u, std::thread::hardware_concurrency());
+  return std::max<size_t>(1, std::min<size_t>(configs, hwThreads));
+}
+
+/**
+ * @brief The SweepPort class
+ * Next-level cache of an L1CacheShim, forwarding the accesses of the shim to
+ * the access stream of a CacheSweep.
+ */
+class SweepPort : public CacheInterface {
+public:
+  SweepPort(CacheSweep &sweep, bool instr)
+      : CacheInterface(nullptr), m_sweep(sweep), m_instr(instr) {}
+
+  void access(AInt address, MemoryAccess::Type type) override {
+    m_sweep.access(TraceAccess{address, type, m_instr});
+  }
+
+  // The sweep is reset through ProcessorHandler::processorReset; see
+  // CacheSweep::attachToProcessor. Detached caches cannot be reversed.
+  void reset() override {}
+  void reverse() override {}
+
+private:
+  CacheSweep &m_sweep;
+  bool m_instr;
+};
+
+CacheSweep::CacheSweep(const std::vector<Config> &configs, unsigned wordBytes,
+                       QObject *parent)
+    : QObject(parent), m_configs(configs),
+      m_ring(s_ringSizeLog2, sweepWorkers(configs.size())) {
+  for (const auto &config : m_configs) {
+    auto cache = std::make_unique<CacheSim>(wordBytes, nullptr);
+    cache->setPreset(config.preset);
+    m_caches.push_back(std::move(cache));
+  }
+
+  m_pending.reserve(s_batchSize);
+  const unsigned workers = sweepWorkers(m_configs.size());
+  for (unsigned worker = 0; worker < workers; ++worker) {
+    m_workers.emplace_back(&CacheSweep::workerLoop, this, worker, workers);
+  }
+}
+
+CacheSweep::~CacheSweep() {
+  flush();
+  m_ring.close();
+  for (auto &worker : m_workers) {
+    worker.join();
+  }
+}
+
+void CacheSweep::access(const TraceAccess &access) {
+  m_pending.push_back(access);
+  if (m_pending.size() == s_batchSize) {
+    flush();
+  }
+}
+
+void CacheSweep::access(const TraceAccess *accesses, size_t n) {
+  flush();
+  m_ring.push(accesses, n);
+}
+
+void CacheSweep::flush() {
+  m_ring.push(m_pending.data(), m_pending.size());
+  m_pending.clear();
+}
+
+void CacheSweep::sync() {
+  flush();
+  m_ring.waitDrained();
+}
+
+void CacheSweep::attachToProcessor() {
+  // The sweep must be reset prior to the shims reloading the initial state of
+  // the processor upon a processor reset. Connections are invoked in the order
+  // that they were made, so connect before constructing the shims.
+  connect(ProcessorHandler::get(), &ProcessorHandler::processorReset, this,
+          &CacheSweep::reset);
+
+  m_l1iShim = std::make_unique<L1CacheShim>(L1CacheShim::CacheType::InstrCache,
+                                            nullptr);
+  m_l1dShim = std::make_unique<L1CacheShim>(L1CacheShim::CacheType::DataCache,
+                                            nullptr);
+  m_l1iShim->setNextLevelCache(std::make_shared<SweepPort>(*this, true));
+  m_l1dShim->setNextLevelCache(std::make_shared<SweepPort>(*this, false));
+}
+
+void CacheSweep::reset() {
+  m_pending.clear();
+  m_ring.waitDrained();
+  for (auto &cache : m_caches) {
+    cache->reset();
+  }
+}
+
+std::vector<CacheSweep::Result> CacheSweep::results() {
+  sync();
+  std::vector<Result> results;
+  for (unsigned i = 0; i < m_configs.size(); ++i) {
+    const CacheSim &cache = *m_caches[i];
+    Result result;
+    result.config = m_configs[i];
+    result.hits = cache.getHits();
+    result.misses = cache.getMisses();
+    result.writebacks = cache.getWritebacks();
+    result.hitRate = cache.getHitRate();
+    result.sizeBits = cache.getCacheSize().bits;
+    results.push_back(result);
+  }
+  return results;
+}
+
+QString CacheSweep::targetName(Target target) {
+  switch (target) {
+  case Target::Instr:
+    return "I";
+  case Target::Data:
+    return "D";
+  case Target::Unified:
+    return "U";
+  }
+  Q_UNREACHABLE();
+}
+
+void CacheSweep::workerLoop(unsigned worker, unsigned workers) {
+  // Configurations are distributed round-robin across the workers.
+  std::vector<std::pair<CacheSim *, Target>> caches;
+  for (unsigned i = worker; i < m_configs.size(); i += workers) {
+    caches.push_back({m_caches[i].get(), m_configs[i].target});
+  }
+
+  const TraceAccess *accesses;
+  while (size_t n = m_ring.acquire(worker, accesses)) {
+    // Simulate the batch one cache at a time, keeping the state of a single
+    // cache hot at a time.
+    for (const auto &[cache, target] : caches) {
+      for (size_t i = 0; i < n; ++i) {
+        const TraceAccess &access = accesses[i];
+        if (target == Target::Unified ||
+            access.instr == (target == Target::Instr)) {
+          cache->access(access.address, access.type);
+        }
+      }
+    }
+    m_ring.release(worker, n);
+  }
+}
+
+} // namespace Ripes
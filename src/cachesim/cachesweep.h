@@ -0,0 +1,115 @@
+#pragma once
+
+#include <QObject>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "cachesim.h"
+#include "cachetracereader.h"
+#include "utilities/spmcring.h"
+
+namespace Ripes {
+
+class L1CacheShim;
+
+/**
+ * @brief The CacheSweep class
+ * Evaluates a set of cache configurations against a single memory access
+ * stream, allowing for an entire design space exploration grid to be produced
+ * in one simulation pass.
+ *
+ * Each configuration is simulated by a detached CacheSim. Accesses are
+ * broadcast to a pool of worker threads through a lock-free ring buffer, with
+ * each worker simulating a disjoint subset of the configurations (one
+ * configuration per worker, if enough hardware threads are available). The
+ * access stream is either provided explicitly through access() (ie. when
+ * replaying a trace), or recorded live from the current processor (see
+ * attachToProcessor()).
+ */
+class CacheSweep : public QObject {
+  Q_OBJECT
+public:
+  /**
+   * @brief The Target enum
+   * The subset of the access stream that a configuration is simulated against.
+   */
+  enum class Target { Instr, Data, Unified };
+
+  struct Config {
+    CachePreset preset;
+    Target target = Target::Data;
+  };
+
+  struct Result {
+    Config config;
+    unsigned hits = 0;
+    unsigned misses = 0;
+    unsigned writebacks = 0;
+    double hitRate = 0;
+    unsigned sizeBits = 0;
+  };
+
+  /**
+   * @brief CacheSweep
+   * Constructs a sweep over @p configs, modelling a memory system of
+   * @p wordBytes bytes per word, and starts the worker threads.
+   */
+  CacheSweep(const std::vector<Config> &configs, unsigned wordBytes,
+             QObject *parent = nullptr);
+  ~CacheSweep();
+
+  /**
+   * @brief access
+   * Appends accesses to the access stream. Accesses are staged locally and
+   * published to the workers in batches.
+   */
+  void access(const TraceAccess &access);
+  void access(const TraceAccess *accesses, size_t n);
+
+  /**
+   * @brief attachToProcessor
+   * Records the instruction and data accesses of the current processor through
+   * a pair of L1CacheShims. The sweep is reset whenever the processor is reset.
+   * Reversing the processor is not reflected in the sweep statistics.
+   */
+  void attachToProcessor();
+
+  /**
+   * @brief reset
+   * Waits for all pending accesses to be simulated, and resets all caches.
+   */
+  void reset();
+
+  /**
+   * @brief results
+   * Waits for all pending accesses to be simulated, and returns the statistics
+   * of each configuration, in the order that the configurations were given.
+   */
+  std::vector<Result> results();
+
+  unsigned workerCount() const { return m_workers.size(); }
+  static QString targetName(Target target);
+
+private:
+  void flush();
+  void sync();
+  void workerLoop(unsigned worker, unsigned workers);
+
+  std::vector<Config> m_configs;
+  std::vector<std::unique_ptr<CacheSim>> m_caches;
+
+  /**
+   * @brief m_pending
+   * Accesses which have not yet been published to the workers.
+   */
+  std::vector<TraceAccess> m_pending;
+  SPMCRing<TraceAccess> m_ring;
+  std::vector<std::thread> m_workers;
+
+  std::unique_ptr<L1CacheShim> m_l1iShim;
+  std::unique_ptr<L1CacheShim> m_l1dShim;
+};
+
+} // namespace Ripes
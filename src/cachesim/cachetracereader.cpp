@@ -0,0 +1,168 @@
+#include "cachetracereader.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Ripes {
+
+static constexpr size_t s_bufferSize = 1 << 20;
+
+CacheTraceReader::~CacheTraceReader() {
+  if (m_file && m_ownsFile) {
+    std::fclose(m_file);
+  }
+}
+
+QString CacheTraceReader::open(const QString &path) {
+  if (path == "-") {
+    m_file = stdin;
+    m_ownsFile = false;
+  } else {
+    m_file = std::fopen(path.toLocal8Bit().constData(), "rb");
+    m_ownsFile = true;
+    if (!m_file) {
+      return "Could not open trace file '" + path + "'";
+    }
+  }
+  m_buffer.resize(s_bufferSize);
+  m_pos = m_end = 0;
+  m_eof = false;
+  m_lineNumber = 0;
+  m_error.clear();
+  return QString();
+}
+
+bool CacheTraceReader::fill() {
+  if (m_eof) {
+    return false;
+  }
+
+  // Move any partial line to the start of the buffer.
+  const size_t remaining = m_end - m_pos;
+  std::memmove(m_buffer.data(), m_buffer.data() + m_pos, remaining);
+  m_pos = 0;
+  m_end = remaining;
+
+  if (m_end == m_buffer.size()) {
+    // A single line spans the entire buffer; grow it.
+    m_buffer.resize(m_buffer.size() * 2);
+  }
+
+  const size_t bytesRead =
+      std::fread(m_buffer.data() + m_end, 1, m_buffer.size() - m_end, m_file);
+  m_end += bytesRead;
+  if (bytesRead == 0) {
+    m_eof = true;
+  }
+  return bytesRead != 0;
+}
+
+static inline int hexValue(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+static inline const char *skipSpace(const char *it, const char *end) {
+  while (it != end && (*it == ' ' || *it == '\t' || *it == '\r' || *it == ','))
+    ++it;
+  return it;
+}
+
+bool CacheTraceReader::parseLine(const char *it, const char *end,
+                                 TraceAccess &access) {
+  it = skipSpace(it, end);
+  if (it == end || *it == '#') {
+    return false;
+  }
+
+  // Address
+  if (end - it > 2 && it[0] == '0' && (it[1] == 'x' || it[1] == 'X')) {
+    it += 2;
+  }
+  AInt address = 0;
+  const char *addrStart = it;
+  for (int v; it != end && (v = hexValue(*it)) >= 0; ++it) {
+    address = (address << 4) | v;
+  }
+  if (it == addrStart) {
+    m_error = "Invalid address on line " + QString::number(m_lineNumber);
+    return false;
+  }
+  access.address = address;
+
+  // Access type
+  it = skipSpace(it, end);
+  if (it == end) {
+    m_error = "Missing access type on line " + QString::number(m_lineNumber);
+    return false;
+  }
+  switch (*it++) {
+  case 'R':
+  case 'r':
+    access.type = MemoryAccess::Read;
+    break;
+  case 'W':
+  case 'w':
+    access.type = MemoryAccess::Write;
+    break;
+  default:
+    m_error = "Invalid access type on line " + QString::number(m_lineNumber);
+    return false;
+  }
+
+  // Access target
+  access.instr = false;
+  it = skipSpace(it, end);
+  if (it != end) {
+    switch (*it) {
+    case 'I':
+    case 'i':
+      access.instr = true;
+      break;
+    case 'D':
+    case 'd':
+      break;
+    default:
+      m_error =
+          "Invalid access target on line " + QString::number(m_lineNumber);
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t CacheTraceReader::read(TraceAccess *out, size_t n) {
+  size_t count = 0;
+  while (count < n && m_error.isEmpty()) {
+    const char *begin = m_buffer.data() + m_pos;
+    const char *bufEnd = m_buffer.data() + m_end;
+    const char *lineEnd =
+        static_cast<const char *>(std::memchr(begin, '\n', bufEnd - begin));
+
+    if (lineEnd == nullptr) {
+      if (fill()) {
+        continue;
+      }
+      if (m_pos == m_end) {
+        // End of trace
+        break;
+      }
+      // Final line without a trailing newline
+      lineEnd = m_buffer.data() + m_end;
+    }
+
+    m_lineNumber++;
+    if (parseLine(m_buffer.data() + m_pos, lineEnd, out[count])) {
+      count++;
+    }
+    m_pos = std::min<size_t>(lineEnd - m_buffer.data() + 1, m_end);
+  }
+  return count;
+}
+
+} // namespace Ripes
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QString>
+
+#include <cstdio>
+#include <vector>
+
+#include "processors/interface/ripesprocessor.h"
+
+namespace Ripes {
+
+/**
+ * @brief The TraceAccess struct
+ * A single memory access of a memory access trace.
+ */
+struct TraceAccess {
+  AInt address = 0;
+  MemoryAccess::Type type = MemoryAccess::None;
+  // True if the access is an instruction fetch, false if it is a data access.
+  bool instr = false;
+};
+
+/**
+ * @brief The CacheTraceReader class
+ * Buffered reader for memory access trace files. A trace file contains one
+ * access per line, formatted as:
+ *   <address> <R|W> [I|D]
+ * where the address is in hexadecimal notation (an optional '0x' prefix is
+ * allowed), R/W denotes a read or a write, and I/D denotes an instruction or a
+ * data access (data, if omitted). Empty lines and lines starting with '#' are
+ * ignored.
+ */
+class CacheTraceReader {
+public:
+  CacheTraceReader() = default;
+  CacheTraceReader(const CacheTraceReader &) = delete;
+  CacheTraceReader &operator=(const CacheTraceReader &) = delete;
+  ~CacheTraceReader();
+
+  /**
+   * @brief open
+   * Opens the trace file at @p path. If @p path is "-", the trace is read from
+   * standard input. Returns an error message if the file could not be opened.
+   */
+  QString open(const QString &path);
+
+  /**
+   * @brief read
+   * Parses up to @p n accesses into @p out. Returns the number of accesses
+   * parsed; 0 if the end of the trace was reached or a parse error occurred (see
+   * error()).
+   */
+  size_t read(TraceAccess *out, size_t n);
+
+  /// Returns a description of the most recent parse error, if any.
+  const QString &error() const { return m_error; }
+
+private:
+  /// Refills the read buffer, preserving any unconsumed bytes. Returns false if
+  /// no more data could be read.
+  bool fill();
+  bool parseLine(const char *begin, const char *end, TraceAccess &access);
+
+  std::FILE *m_file = nullptr;
+  bool m_ownsFile = false;
+  bool m_eof = false;
+  std::vector<char> m_buffer;
+  size_t m_pos = 0;
+  size_t m_end = 0;
+  uint64_t m_lineNumber = 0;
+  QString m_error;
+};
+
+} // namespace Ripes
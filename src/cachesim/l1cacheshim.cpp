@@ -1,26 +1,32 @@
 #include "l1cacheshim.h"
 
 #include "processorhandler.h"
+#include "simulationcontext.h"
 
 namespace Ripes {
 
 L1CacheShim::L1CacheShim(CacheType type, QObject *parent)
-    : CacheInterface(parent), m_type(type) {
+    : CacheInterface(parent), m_type(type),
+      m_context(SimulationContext::current()) {
   connect(ProcessorHandler::get(), &ProcessorHandler::processorReset, this,
           &L1CacheShim::processorReset);
 
   // We must update the cache statistics on each cycle, in lockstep with the
-  // procsesor itself. Connect to ProcessorHandler::processorClocked and ensure
-  // that the handler is executed in the thread that the processor lives in
-  // (direct connection).
-  connect(ProcessorHandler::get(), &ProcessorHandler::processorClocked, this,
-          &L1CacheShim::processorWasClocked, Qt::DirectConnection);
+  // procsesor itself. Register as a cycle observer, such that the handler is
+  // executed directly in the thread that the processor lives in.
+  m_cycleObserverID =
+      ProcessorHandler::addCycleObserver([=] { processorWasClocked(); });
   connect(ProcessorHandler::get(), &ProcessorHandler::processorReversed, this,
           &L1CacheShim::processorReversed);
 
   processorReset();
 }
 
+L1CacheShim::~L1CacheShim() {
+  SimulationContext::Scope scope(m_context);
+  ProcessorHandler::removeCycleObserver(m_cycleObserverID);
+}
+
 void L1CacheShim::access(AInt, MemoryAccess::Type) {
   // Should never occur; the shim determines accesses based on investigating the
   // associated memory.
@@ -9,6 +9,8 @@
 
 namespace Ripes {
 
+class SimulationContext;
+
 /**
  * @brief The CacheShim class
  * Provides a wrapper around the current processor models' data- and instruction
@@ -19,6 +21,7 @@ class L1CacheShim : public CacheInterface {
 public:
   enum class CacheType { DataCache, InstrCache };
   L1CacheShim(CacheType type, QObject *parent);
+  ~L1CacheShim() override;
   void access(AInt address, MemoryAccess::Type type) override;
 
   void setType(CacheType type);
@@ -35,6 +38,9 @@ private:
    * the given type of the memory.
    */
   CacheType m_type;
+  unsigned m_cycleObserverID;
+  // The simulation context of the processor which the shim is attached to.
+  SimulationContext &m_context;
 };
 
 } // namespace Ripes
@@ -0,0 +1,189 @@
+#include "checkpoint.h"
+
+#include <QtEndian>
+
+#include <algorithm>
+
+namespace Ripes {
+
+// Checkpoint file layout. All values are little-endian.
+//   header:  magic[8], u32 version, u32 xlen, u64 pc, u64 instructions
+//   regs:    u32 count, u64 value[count]
+//   files:   u32 count, {i32 fd, u32 flags, i64 position, u32 length,
+//            utf-8 name[length]}[count]
+//   ioRegs:  u32 count, {u64 address, u32 bytes, u64 value}[count]
+//   pages:   u32 count, {u64 address, contents[s_pageBytes]}[count]
+// The pages are placed last, such that they may be referenced in place.
+static constexpr char s_magic[8] = {'R', 'I', 'P', 'E', 'S', 'C', 'K', 'P'};
+static constexpr uint32_t s_version = 1;
+
+namespace {
+
+class Writer {
+public:
+  template <typename T>
+  void put(T value) {
+    const T le = qToLittleEndian(value);
+    m_data.append(reinterpret_cast<const char *>(&le), sizeof(T));
+  }
+  void put(const QByteArray &bytes) { m_data.append(bytes); }
+  const QByteArray &data() const { return m_data; }
+
+private:
+  QByteArray m_data;
+};
+
+class Reader {
+public:
+  Reader(const uchar *data, qint64 size) : m_data(data), m_size(size) {}
+
+  /// Reads a value into @p value. Returns false if the data is exhausted.
+  template <typename T>
+  bool get(T &value) {
+    if (!has(sizeof(T)))
+      return false;
+    value = qFromLittleEndian<T>(m_data + m_pos);
+    m_pos += sizeof(T);
+    return true;
+  }
+  /// Returns a pointer to the next @p bytes bytes, or nullptr if the data is
+  /// exhausted.
+  const char *take(qint64 bytes) {
+    if (!has(bytes))
+      return nullptr;
+    const char *ptr = reinterpret_cast<const char *>(m_data + m_pos);
+    m_pos += bytes;
+    return ptr;
+  }
+
+private:
+  bool has(qint64 bytes) const { return bytes <= m_size - m_pos; }
+
+  const uchar *m_data;
+  qint64 m_size;
+  qint64 m_pos = 0;
+};
+
+} // namespace
+
+QString Checkpoint::save(const QString &path) const {
+  Writer w;
+  w.put(QByteArray(s_magic, sizeof(s_magic)));
+  w.put<uint32_t>(s_version);
+  w.put<uint32_t>(xlen);
+  w.put<uint64_t>(pc);
+  w.put<uint64_t>(instructions);
+
+  w.put<uint32_t>(regs.size());
+  for (VInt reg : regs)
+    w.put<uint64_t>(reg);
+
+  w.put<uint32_t>(files.size());
+  for (const auto &file : files) {
+    const QByteArray name = file.name.toUtf8();
+    w.put<int32_t>(file.fd);
+    w.put<uint32_t>(file.flags);
+    w.put<int64_t>(file.position);
+    w.put<uint32_t>(name.size());
+    w.put(name);
+  }
+
+  w.put<uint32_t>(ioRegs.size());
+  for (const auto &reg : ioRegs) {
+    w.put<uint64_t>(reg.address);
+    w.put<uint32_t>(reg.bytes);
+    w.put<uint64_t>(reg.value);
+  }
+
+  w.put<uint32_t>(pages.size());
+  for (const auto &[address, contents] : pages) {
+    Q_ASSERT(static_cast<unsigned>(contents.size()) == s_pageBytes);
+    w.put<uint64_t>(address);
+    w.put(contents);
+  }
+
+  QFile file(path);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    return "Could not open checkpoint file '" + path + "' for writing.";
+  if (file.write(w.data()) != w.data().size())
+    return "Could not write checkpoint file '" + path + "'.";
+  return QString();
+}
+
+QString Checkpoint::load(const QString &path, Checkpoint &checkpoint) {
+  auto mapping = std::make_shared<QFile>(path);
+  if (!mapping->open(QIODevice::ReadOnly))
+    return "Could not open checkpoint file '" + path + "'.";
+  const uchar *data = mapping->map(0, mapping->size());
+  if (!data)
+    return "Could not map checkpoint file '" + path + "'.";
+
+  const QString corrupt = "Checkpoint file '" + path + "' is corrupt.";
+  Reader r(data, mapping->size());
+  const char *magic = r.take(sizeof(s_magic));
+  if (!magic || !std::equal(s_magic, s_magic + sizeof(s_magic), magic))
+    return "'" + path + "' is not a checkpoint file.";
+  uint32_t version;
+  if (!r.get(version) || version != s_version)
+    return "Unsupported checkpoint file version.";
+
+  Checkpoint cp;
+  uint32_t xlen, count;
+  if (!r.get(xlen) || !r.get(cp.pc) || !r.get(cp.instructions))
+    return corrupt;
+  cp.xlen = xlen;
+
+  if (!r.get(count))
+    return corrupt;
+  for (uint32_t i = 0; i < count; ++i) {
+    uint64_t reg;
+    if (!r.get(reg))
+      return corrupt;
+    cp.regs.push_back(reg);
+  }
+
+  if (!r.get(count))
+    return corrupt;
+  for (uint32_t i = 0; i < count; ++i) {
+    SystemIO::OpenFile file;
+    int32_t fd;
+    uint32_t flags, length;
+    const char *name = nullptr;
+    if (!r.get(fd) || !r.get(flags) || !r.get(file.position) ||
+        !r.get(length) || !(name = r.take(length)))
+      return corrupt;
+    file.fd = fd;
+    file.flags = flags;
+    file.name = QString::fromUtf8(name, length);
+    cp.files.push_back(file);
+  }
+
+  if (!r.get(count))
+    return corrupt;
+  for (uint32_t i = 0; i < count; ++i) {
+    PeripheralRegister reg;
+    uint32_t bytes;
+    if (!r.get(reg.address) || !r.get(bytes) || !r.get(reg.value))
+      return corrupt;
+    reg.bytes = bytes;
+    cp.ioRegs.push_back(reg);
+  }
+
+  if (!r.get(count))
+    return corrupt;
+  for (uint32_t i = 0; i < count; ++i) {
+    AInt address;
+    const char *contents = nullptr;
+    if (!r.get(address) || !(contents = r.take(s_pageBytes)))
+      return corrupt;
+    // The mapping is kept alive alongside the checkpoint, so the page contents
+    // need not be copied.
+    cp.pages[address] = QByteArray::fromRawData(contents, s_pageBytes);
+  }
+
+  cp.m_mapping = mapping;
+  checkpoint = std::move(cp);
+  return QString();
+}
+
+} // namespace Ripes
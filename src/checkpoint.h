@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "ripes_types.h"
+#include "syscall/systemio.h"
+
+namespace Ripes {
+
+/**
+ * @brief The Checkpoint struct
+ * The architectural state of a simulation at an instruction boundary: the
+ * registers, the program counter, the memory pages written to by the program,
+ * the files opened through system calls and the writable registers of the
+ * memory-mapped peripherals. Memory which was never written to is not part of a
+ * checkpoint, and a checkpoint must therefore be restored on top of the program
+ * which it was taken from.
+ */
+struct Checkpoint {
+  static constexpr unsigned s_pageBytes = 4096;
+
+  struct PeripheralRegister {
+    AInt address;
+    unsigned bytes;
+    VInt value;
+  };
+
+  unsigned xlen = 0;
+  AInt pc = 0;
+  // The number of instructions executed up until the checkpoint.
+  uint64_t instructions = 0;
+  std::vector<VInt> regs;
+  // Page base address => page contents (s_pageBytes bytes).
+  std::map<AInt, QByteArray> pages;
+  std::vector<SystemIO::OpenFile> files;
+  std::vector<PeripheralRegister> ioRegs;
+
+  /// Writes the checkpoint to @p path. Returns an error string on failure.
+  QString save(const QString &path) const;
+
+  /**
+   * @brief load
+   * Loads the checkpoint at @p path into @p checkpoint. Returns an error string
+   * on failure. The file is memory-mapped, and the loaded pages refer directly
+   * to the mapping.
+   */
+  static QString load(const QString &path, Checkpoint &checkpoint);
+
+private:
+  // The memory-mapped checkpoint file which the pages refer to (if loaded).
+  std::shared_ptr<QFile> m_mapping;
+};
+
+} // namespace Ripes
@@ -0,0 +1,187 @@
+#include "batchrunner.h"
+#include "clirunner.h"
+#include "simulationcontext.h"
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include <iostream>
+#include <thread>
+
+namespace Ripes {
+
+// Options which apply to the batch as a whole, and which may therefore not be
+// given for a job.
+static const QStringList s_batchOptions = {
+    "batch", "jobs", "output", "json", "v", "cachetrace", "cosim"};
+
+BatchRunner::BatchRunner(const CLIModeOptions &options) : m_options(options) {}
+
+int BatchRunner::run() {
+  const QString err = loadManifest();
+  if (!err.isEmpty()) {
+    std::cerr << "ERROR: " << err.toStdString() << std::endl;
+    return 1;
+  }
+
+  if (!m_options.outputFile.isEmpty()) {
+    m_outputFile = std::make_unique<QFile>(m_options.outputFile);
+    if (!m_outputFile->open(QIODevice::Truncate | QIODevice::Text |
+                            QIODevice::WriteOnly)) {
+      std::cerr << "ERROR: Failed to open output file" << std::endl;
+      return 1;
+    }
+  }
+
+  unsigned threads = m_options.batchThreads;
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  threads = std::min<size_t>(threads, m_jobs.size());
+  if (m_options.verbose)
+    std::cerr << "INFO: Running " << m_jobs.size() << " jobs on " << threads
+              << " threads" << std::endl;
+
+  // Jobs are claimed one at a time from the manifest by whichever worker is
+  // idle, such that long-running jobs do not hold up the remaining jobs.
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < threads; ++i)
+    workers.emplace_back(&BatchRunner::workerLoop, this);
+  for (auto &worker : workers)
+    worker.join();
+
+  if (m_outputFile)
+    m_outputFile->close();
+  return m_failed ? 1 : 0;
+}
+
+QString BatchRunner::loadManifest() {
+  QFile file(m_options.batch);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    return "Failed to open batch manifest '" + m_options.batch + "'";
+
+  int lineNumber = 0;
+  while (!file.atEnd()) {
+    const QByteArray line = file.readLine().trimmed();
+    lineNumber++;
+    if (line.isEmpty() || line.startsWith('#'))
+      continue;
+
+    const QString invalid = "Invalid job on line " +
+                            QString::number(lineNumber) +
+                            " of the batch manifest: ";
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(line, &parseError);
+    if (parseError.error != QJsonParseError::NoError)
+      return invalid + parseError.errorString();
+    if (!document.isObject())
+      return invalid + "expected a JSON object";
+
+    Job job;
+    job.line = lineNumber;
+    const QJsonObject jobObject = document.object();
+    for (auto it = jobObject.begin(); it != jobObject.end(); ++it) {
+      if (it.key() == "id") {
+        job.id = it.value();
+        continue;
+      }
+
+      const QString option = (it.key().size() == 1 ? "-" : "--") + it.key();
+      const QJsonValue &value = it.value();
+      if (value.isBool()) {
+        if (value.toBool())
+          job.arguments << option;
+      } else if (value.isString() || value.isDouble()) {
+        job.arguments << option << value.toVariant().toString();
+      } else if (value.isArray()) {
+        for (const auto &element : value.toArray()) {
+          if (!element.isString())
+            return invalid + "expected an array of strings for option '" +
+                   it.key() + "'";
+          job.arguments << option << element.toString();
+        }
+      } else {
+        return invalid + "unsupported value for option '" + it.key() + "'";
+      }
+    }
+    m_jobs.push_back(job);
+  }
+  return QString();
+}
+
+void BatchRunner::workerLoop() {
+  for (size_t i = m_nextJob++; i < m_jobs.size(); i = m_nextJob++) {
+    const QJsonObject report = runJob(m_jobs[i]);
+    if (report["status"] != "ok")
+      m_failed = true;
+    writeReport(report);
+  }
+}
+
+QJsonObject BatchRunner::runJob(const Job &job) {
+  QElapsedTimer wallTime;
+  wallTime.start();
+  QJsonObject report;
+  report["line"] = job.line;
+  if (!job.id.isUndefined())
+    report["id"] = job.id;
+
+  // Options are parsed within the context of the job, given that enabling a
+  // telemetry may attach it to the processor.
+  SimulationContext context;
+  SimulationContext::Scope scope(context);
+  QCommandLineParser parser;
+  CLIModeOptions options;
+  addCLIOptions(parser, options);
+
+  QString err;
+  if (!parser.parse(QStringList("Ripes") + job.arguments)) {
+    err = parser.errorText();
+  } else {
+    for (const auto &option : s_batchOptions) {
+      if (parser.isSet(option)) {
+        err = "Option '" + option + "' may not be given for a batch job.";
+        break;
+      }
+    }
+    if (err.isEmpty())
+      parseCLIOptions(parser, err, options);
+    if (err.isEmpty() && options.stdinPath == "-")
+      err = "The standard input of a batch job must be read from a file "
+            "(--stdin).";
+  }
+  if (!err.isEmpty()) {
+    report["status"] = "error";
+    report["error"] = err;
+    report["wall time (ms)"] = wallTime.elapsed();
+    return report;
+  }
+
+  options.jsonOutput = true;
+  report["src"] = options.src;
+  report["proc"] = enumToString<ProcessorID>(options.proc);
+  report["ISA extensions"] = QJsonArray::fromStringList(options.isaExtensions);
+  {
+    CLIRunner runner(options, context);
+    const QJsonObject result = runner.runJob();
+    for (auto it = result.begin(); it != result.end(); ++it)
+      report.insert(it.key(), it.value());
+  }
+  report["wall time (ms)"] = wallTime.elapsed();
+  return report;
+}
+
+void BatchRunner::writeReport(const QJsonObject &report) {
+  const QByteArray line =
+      QJsonDocument(report).toJson(QJsonDocument::Compact) + '\n';
+  std::unique_lock lock(m_outputLock);
+  if (m_outputFile) {
+    m_outputFile->write(line);
+    m_outputFile->flush();
+  } else {
+    std::cout.write(line.constData(), line.size());
+    std::cout.flush();
+  }
+}
+
+} // namespace Ripes
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "clioptions.h"
+
+#include <QFile>
+#include <QJsonObject>
+#include <QStringList>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace Ripes {
+
+/// The BatchRunner class runs a manifest of CLI jobs within a single process.
+/// Each line of the manifest is a JSON object of the CLI options of a job,
+/// where an option is given as a string, a number, true (for flags) or an array
+/// of strings (for options which may be given multiple times). Each job is run
+/// by a CLIRunner within its own SimulationContext, on a pool of worker
+/// threads. The report of each job is written as a line of JSON once the job
+/// completes; the order of the reports is thereby not that of the manifest.
+class BatchRunner {
+public:
+  BatchRunner(const CLIModeOptions &options);
+
+  /// Runs all jobs of the manifest. Returns 0 if all jobs succeeded.
+  int run();
+
+private:
+  struct Job {
+    // Line number of the job in the manifest.
+    int line;
+    // Optional identifier of the job, reported along with its results.
+    QJsonValue id;
+    QStringList arguments;
+  };
+
+  /// Parses the manifest into m_jobs. Returns an error message on failure.
+  QString loadManifest();
+
+  /// Runs jobs until all jobs of the manifest have been claimed.
+  void workerLoop();
+
+  /// Runs @p job, returning its report.
+  QJsonObject runJob(const Job &job);
+
+  /// Writes @p report as a line of the output.
+  void writeReport(const QJsonObject &report);
+
+  CLIModeOptions m_options;
+  std::vector<Job> m_jobs;
+  // Index of the next job to be claimed by a worker.
+  std::atomic<size_t> m_nextJob = 0;
+  std::atomic<bool> m_failed = false;
+
+  std::unique_ptr<QFile> m_outputFile;
+  std::mutex m_outputLock;
+};
+
+} // namespace Ripes
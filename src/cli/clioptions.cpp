@@ -35,20 +35,148 @@ void addCLIOptions(QCommandLineParser &parser, Ripes::CLIModeOptions &options) {
       "Simulation timeout in milliseconds. If simulation does not finish "
       "within the specified time, it will be aborted.",
       "ms", "0"));
+  parser.addOption(QCommandLineOption(
+      "fastforward",
+      "Execute the program on a functional instruction-set simulator until the "
+      "given target is reached, and continue on the selected processor model "
+      "from there. Reports only cover the remainder of the program. Format: "
+      "pc=<address>, instrs=<count> or marker=<syscall number> (an ecall with "
+      "the given syscall number, which is skipped).",
+      "target"));
+  parser.addOption(QCommandLineOption(
+      "checkpoint-at",
+      "As --fastforward, but additionally saves a checkpoint of the "
+      "architectural state at the given target to the path given by "
+      "--checkpoint.",
+      "target"));
+  parser.addOption(QCommandLineOption(
+      "checkpoint", "Checkpoint output file (--checkpoint-at).", "path",
+      "ripes.ckpt"));
+  parser.addOption(QCommandLineOption(
+      "restore",
+      "Restore the checkpoint at the given path before executing the program. "
+      "The checkpoint must have been taken from the same program and ISA.",
+      "path"));
+  parser.addOption(QCommandLineOption(
+      "stdin",
+      "Stream the standard input of the program from the file at the given "
+      "path (or '-' for stdin). If not set, the standard input of the program "
+      "is empty.",
+      "path"));
+  parser.addOption(QCommandLineOption(
+      "maxfiles",
+      "Maximum number of files which the program may have open at once, "
+      "including the standard i/o channels.",
+      "n", "32"));
+  parser.addOption(QCommandLineOption(
+      "filebuffer",
+      "Size in bytes of the write buffer of each file opened by the program.",
+      "bytes", "65536"));
   parser.addOption(QCommandLineOption("v", "Verbose output"));
   parser.addOption(QCommandLineOption(
       "output", "Report output file. If not set, report is printed to stdout.",
       "path"));
   parser.addOption(QCommandLineOption("json", "JSON-formatted report."));
+  parser.addOption(QCommandLineOption(
+      "pipetrace",
+      "Stream a pipeline trace of the processor model to the given path, in "
+      "the Kanata format of the Konata pipeline viewer. The trace is "
+      "gzip-compressed if the path ends with '.gz'.",
+      "path"));
+  parser.addOption(QCommandLineOption(
+      "cosim",
+      "Co-simulate the program on the processor model and on a reference "
+      "model (--cosim-ref) in lockstep, comparing each retired instruction "
+      "and stopping at the first divergence."));
+  parser.addOption(QCommandLineOption(
+      "cosim-ref",
+      "Reference model of the co-simulation (--cosim). Defaults to the "
+      "single-cycle processor of the register width of the processor model.",
+      "name"));
+  parser.addOption(QCommandLineOption(
+      "committrace",
+      "Write a record of each instruction retired by the processor model (PC, "
+      "instruction, register write and memory access) to the given path.",
+      "path"));
+  parser.addOption(QCommandLineOption(
+      "committrace-format",
+      "Format of the commit trace (--committrace). Options: [bin, spike], "
+      "where spike is the text format of the Spike ISA simulator's commit "
+      "log.",
+      "format", "bin"));
+  parser.addOption(QCommandLineOption(
+      "profile-folded",
+      "Write the cycles of each call stack observed by the profile "
+      "(--profile) to the given path, as folded stacks for flame graph "
+      "tools. Implies --profile.",
+      "path"));
 
   parser.addOption(QCommandLineOption("all", "Enable all report options."));
 
+  // Batch mode
+  parser.addOption(QCommandLineOption(
+      "batch",
+      "Run each job of the manifest at the given path, and stream the report "
+      "of each job as a line of JSON once it completes. Each line of the "
+      "manifest is a JSON object of CLI options for a job, ie. {\"src\": "
+      "\"foo.s\", \"t\": \"asm\", \"proc\": \"RV32_5S\", \"cpi\": true}.",
+      "path"));
+  parser.addOption(QCommandLineOption(
+      "jobs",
+      "Number of batch jobs to run in parallel (--batch). Defaults to the "
+      "number of hardware threads.",
+      "n", "0"));
+
+  // Cache hierarchy and trace-driven cache simulation
+  parser.addOption(QCommandLineOption(
+      "cachetrace",
+      "Simulate the memory access trace at the given path (or '-' for stdin) "
+      "through the cache hierarchy, instead of executing a program. Each line "
+      "of the trace is formatted as: <hex address> <R|W> [I|D]",
+      "path"));
+  const QString cacheDesc =
+      "cache configuration, given as a comma-separated list of "
+      "<key>=<value> pairs. Keys: lines, ways, blocks (log2 values), repl "
+      "[random, lru, plru, fifo, nru], wr [wb, wt], alloc [wa, nwa], incl "
+      "[nine, incl, excl] (inclusion policy w.r.t. the upper levels), lat "
+      "(access latency in cycles).";
+  parser.addOption(
+      QCommandLineOption("icache", "L1 instruction " + cacheDesc, "config"));
+  parser.addOption(
+      QCommandLineOption("dcache", "L1 data " + cacheDesc, "config"));
+  parser.addOption(
+      QCommandLineOption("l2cache", "Shared L2 " + cacheDesc, "config"));
+  parser.addOption(
+      QCommandLineOption("l3cache", "Shared L3 " + cacheDesc, "config"));
+  parser.addOption(QCommandLineOption(
+      "memlat", "Main memory access latency in cycles, used for the average "
+      "memory access time report of the cache hierarchy.", "cycles", "100"));
+  parser.addOption(QCommandLineOption(
+      "cachetiming",
+      "Estimate the cycles which the processor stalls on the access latencies "
+      "of the cache hierarchy. Estimated stall cycles are included in the "
+      "reported cycle count and CPI. If no caches are specified, the default "
+      "L1 caches are used."));
+  parser.addOption(QCommandLineOption(
+      "sweep",
+      "Cache design space sweep. Simulates every combination of the given "
+      "cache parameters in a single simulation pass, as part of either "
+      "trace-driven simulation or program execution. Specified as a cache "
+      "configuration, where each value may be a ':'-separated list of "
+      "alternatives or a '<from>..<to>' range, and with an additional key "
+      "target [i, d, u] (default: d). May be given multiple times.",
+      "grid"));
+
   // telemetry reporting
   options.telemetry.push_back(std::make_shared<CyclesTelemetry>());
   options.telemetry.push_back(std::make_shared<InstrsRetiredTelemetry>());
   options.telemetry.push_back(std::make_shared<CPITelemetry>());
+  options.telemetry.push_back(std::make_shared<MemoryStallCPITelemetry>());
   options.telemetry.push_back(std::make_shared<IPCTelemetry>());
   options.telemetry.push_back(std::make_shared<PipelineTelemetry>());
+  options.profile = std::make_shared<ProfileTelemetry>();
+  options.telemetry.push_back(options.profile);
+  options.telemetry.push_back(std::make_shared<SyscallTelemetry>());
   options.telemetry.push_back(std::make_shared<RegisterTelemetry>());
   options.telemetry.push_back(std::make_shared<RunInfoTelemetry>(&parser));
 
@@ -59,9 +187,339 @@ void addCLIOptions(QCommandLineParser &parser, Ripes::CLIModeOptions &options) {
   }
 }
 
+/// Parses a cache configuration string (see addCLIOptions) into @p preset.
+/// Returns true if the configuration was parsed successfully.
+static bool parseCachePreset(const QString &option, const QString &config,
+                             CachePreset &preset, QString &errorMessage) {
+  // Unspecified parameters default to a 32-entry 4-word direct-mapped cache.
+  preset = CachePreset{option, 2, 5, 0, WritePolicy::WriteBack,
+                       WriteAllocPolicy::WriteAllocate, ReplPolicy::LRU};
+
+  const std::map<QString, ReplPolicy> replPolicies = {
+      {"random", ReplPolicy::Random}, {"lru", ReplPolicy::LRU},
+      {"plru", ReplPolicy::PLRU},     {"fifo", ReplPolicy::FIFO},
+      {"nru", ReplPolicy::NRU}};
+
+  for (const auto &param : config.split(",", Qt::SkipEmptyParts)) {
+    const QStringList kv = param.split("=");
+    const QString invalid = "Invalid cache parameter '" + param +
+                            "' specified (--" + option + ").";
+    if (kv.size() != 2) {
+      errorMessage = invalid;
+      return false;
+    }
+    const QString &key = kv[0];
+    const QString value = kv[1].toLower();
+
+    if (key == "lines" || key == "ways" || key == "blocks") {
+      bool ok;
+      const unsigned bits = value.toUInt(&ok);
+      if (!ok || bits > 16) {
+        errorMessage = invalid;
+        return false;
+      }
+      if (key == "lines")
+        preset.lines = bits;
+      else if (key == "ways")
+        preset.ways = bits;
+      else
+        preset.blocks = bits;
+    } else if (key == "repl" && replPolicies.count(value)) {
+      preset.replPolicy = replPolicies.at(value);
+    } else if (key == "wr" && (value == "wb" || value == "wt")) {
+      preset.wrPolicy =
+          value == "wb" ? WritePolicy::WriteBack : WritePolicy::WriteThrough;
+    } else if (key == "alloc" && (value == "wa" || value == "nwa")) {
+      preset.wrAllocPolicy = value == "wa" ? WriteAllocPolicy::WriteAllocate
+                                           : WriteAllocPolicy::NoWriteAllocate;
+    } else {
+      errorMessage = invalid;
+      return false;
+    }
+  }
+
+  // The storage of a cache is allocated up front, with state for each way and
+  // a dirty bit for each word.
+  constexpr unsigned maxWayBits = 20;
+  constexpr unsigned maxWordBits = 24;
+  const unsigned wayBits = preset.lines + preset.ways;
+  if (wayBits > maxWayBits) {
+    errorMessage = "Cache configuration exceeds the maximum of 2^" +
+                   QString::number(maxWayBits) +
+                   " lines times ways (--" + option + ").";
+    return false;
+  }
+  if (wayBits + preset.blocks > maxWordBits) {
+    errorMessage = "Cache configuration exceeds the maximum of 2^" +
+                   QString::number(maxWordBits) + " words (--" + option +
+                   ").";
+    return false;
+  }
+  return true;
+}
+
+/// Parses the configuration of a level of the cache hierarchy. In addition to
+/// the cache configuration keys of parseCachePreset, the inclusion policy and
+/// latency of the level may be specified.
+static bool parseCacheLevel(const QString &option, const QString &config,
+                            CacheHierarchy::LevelConfig &level,
+                            QString &errorMessage) {
+  const std::map<QString, InclusionPolicy> inclusionPolicies = {
+      {"nine", InclusionPolicy::NINE},
+      {"incl", InclusionPolicy::Inclusive},
+      {"excl", InclusionPolicy::Exclusive}};
+
+  QStringList presetParams;
+  for (const auto &param : config.split(",", Qt::SkipEmptyParts)) {
+    const QStringList kv = param.split("=");
+    const QString invalid = "Invalid cache parameter '" + param +
+                            "' specified (--" + option + ").";
+    if (kv.size() == 2 && kv[0] == "incl") {
+      if (!inclusionPolicies.count(kv[1].toLower())) {
+        errorMessage = invalid;
+        return false;
+      }
+      level.inclusion = inclusionPolicies.at(kv[1].toLower());
+    } else if (kv.size() == 2 && kv[0] == "lat") {
+      bool ok;
+      level.latency = kv[1].toUInt(&ok);
+      if (!ok) {
+        errorMessage = invalid;
+        return false;
+      }
+    } else {
+      presetParams << param;
+    }
+  }
+  return parseCachePreset(option, presetParams.join(","), level.preset,
+                          errorMessage);
+}
+
+/// Adds an L1 instruction and data cache of the default configuration to the
+/// cache hierarchy.
+static void addDefaultL1Caches(CLIModeOptions &options) {
+  QString errorMessage;
+  for (const auto &[level, name] : {std::pair{CacheHierarchy::L1I, "icache"},
+                                    std::pair{CacheHierarchy::L1D, "dcache"}}) {
+    CacheHierarchy::LevelConfig config;
+    parseCacheLevel(name, "", config, errorMessage);
+    options.cacheHierarchy.levels[level] = config;
+  }
+}
+
+/// Parses the cache hierarchy options. Levels which are not specified are not
+/// present in the hierarchy.
+static bool parseCacheHierarchyOptions(QCommandLineParser &parser,
+                                       QString &errorMessage,
+                                       CLIModeOptions &options) {
+  const std::map<CacheHierarchy::Level, std::pair<QString, unsigned>> levels =
+      {{CacheHierarchy::L1I, {"icache", 1}},
+       {CacheHierarchy::L1D, {"dcache", 1}},
+       {CacheHierarchy::L2, {"l2cache", 10}},
+       {CacheHierarchy::L3, {"l3cache", 40}}};
+
+  for (const auto &[level, option] : levels) {
+    const auto &[name, defaultLatency] = option;
+    if (!parser.isSet(name))
+      continue;
+    CacheHierarchy::LevelConfig config;
+    config.latency = defaultLatency;
+    if (!parseCacheLevel(name, parser.value(name), config, errorMessage))
+      return false;
+    options.cacheHierarchy.levels[level] = config;
+  }
+
+  // Each access of the processor takes at least the single cycle of an ideal
+  // memory, in the first present level of its path.
+  for (const auto l1 : {CacheHierarchy::L1I, CacheHierarchy::L1D}) {
+    for (const auto level : {l1, CacheHierarchy::L2, CacheHierarchy::L3}) {
+      const auto &config = options.cacheHierarchy.levels[level];
+      if (!config)
+        continue;
+      if (config->latency == 0) {
+        errorMessage = "The latency of the first cache level of an access "
+                       "path must be at least 1 cycle (--" +
+                       levels.at(level).first + ").";
+        return false;
+      }
+      break;
+    }
+  }
+
+  bool ok;
+  options.cacheHierarchy.memoryLatency = parser.value("memlat").toUInt(&ok);
+  if (!ok) {
+    errorMessage = "Invalid memory latency specified (--memlat).";
+    return false;
+  }
+
+  options.cacheTiming = parser.isSet("cachetiming");
+  if (options.cacheTiming && options.cacheHierarchy.empty())
+    addDefaultL1Caches(options);
+  return true;
+}
+
+/// Expands a cache sweep grid (see addCLIOptions) into the set of cache
+/// configurations which it spans, appending them to @p configs. Returns true if
+/// the grid was parsed successfully.
+static bool parseCacheSweep(const QString &grid,
+                            std::vector<CacheSweep::Config> &configs,
+                            QString &errorMessage) {
+  constexpr unsigned maxConfigs = 4096;
+  const std::map<QString, CacheSweep::Target> targets = {
+      {"i", CacheSweep::Target::Instr},
+      {"d", CacheSweep::Target::Data},
+      {"u", CacheSweep::Target::Unified}};
+
+  CacheSweep::Target target = CacheSweep::Target::Data;
+  std::vector<QStringList> points = {{}};
+  for (const auto &param : grid.split(",", Qt::SkipEmptyParts)) {
+    const QStringList kv = param.split("=");
+    const QString invalid =
+        "Invalid cache sweep parameter '" + param + "' specified (--sweep).";
+    if (kv.size() != 2) {
+      errorMessage = invalid;
+      return false;
+    }
+    const QString &key = kv[0];
+    const QString value = kv[1].toLower();
+
+    if (key == "target") {
+      if (!targets.count(value)) {
+        errorMessage = invalid;
+        return false;
+      }
+      target = targets.at(value);
+      continue;
+    }
+
+    QStringList values;
+    for (const auto &alternative : value.split(":", Qt::SkipEmptyParts)) {
+      const QStringList range = alternative.split("..");
+      if (range.size() == 1) {
+        values << alternative;
+        continue;
+      }
+      bool okFrom, okTo;
+      const unsigned from = range[0].toUInt(&okFrom);
+      const unsigned to = range[1].toUInt(&okTo);
+      if (range.size() != 2 || !okFrom || !okTo || from > to || to > 16) {
+        errorMessage = invalid;
+        return false;
+      }
+      for (unsigned v = from; v <= to; ++v)
+        values << QString::number(v);
+    }
+    if (values.isEmpty()) {
+      errorMessage = invalid;
+      return false;
+    }
+
+    // Extend each point of the grid by each value of the parameter.
+    std::vector<QStringList> extended;
+    for (const auto &point : points)
+      for (const auto &v : values)
+        extended.push_back(QStringList(point) << key + "=" + v);
+    points = std::move(extended);
+    if (configs.size() + points.size() > maxConfigs) {
+      errorMessage = "Cache sweep exceeds the maximum of " +
+                     QString::number(maxConfigs) +
+                     " configurations (--sweep).";
+      return false;
+    }
+  }
+
+  for (const auto &point : points) {
+    CacheSweep::Config config;
+    config.target = target;
+    if (!parseCachePreset("sweep", point.join(","), config.preset,
+                          errorMessage))
+      return false;
+    config.preset.name = point.isEmpty() ? "default" : point.join(",");
+    configs.push_back(config);
+  }
+  return true;
+}
+
+/// Parses a fast-forward target (see addCLIOptions) given to @p option.
+static bool parseFastForwardTarget(const QString &option, const QString &value,
+                                   FastForwardTarget &target,
+                                   QString &errorMessage) {
+  const std::map<QString, FastForwardTarget::Type> types = {
+      {"pc", FastForwardTarget::Type::PC},
+      {"instrs", FastForwardTarget::Type::Instructions},
+      {"marker", FastForwardTarget::Type::Marker}};
+
+  const QStringList kv = value.split("=");
+  bool ok = kv.size() == 2 && types.count(kv[0]);
+  if (ok) {
+    target.type = types.at(kv[0]);
+    // Base 0: C-style prefixes, ie. hexadecimal if prefixed by 0x.
+    target.value = kv[1].toULongLong(&ok, 0);
+  }
+  if (!ok) {
+    errorMessage = "Invalid fast-forward target '" + value +
+                   "' specified (--" + option + ").";
+  }
+  return ok;
+}
+
+/// Parses the options of trace-driven cache simulation mode.
+static bool parseCacheTraceOptions(QCommandLineParser &parser,
+                                   QString &errorMessage,
+                                   CLIModeOptions &options) {
+  options.cacheTrace = parser.value("cachetrace");
+
+  // If no caches are specified, simulate both an instruction and a data cache
+  // of the default configuration.
+  if (options.cacheHierarchy.empty() && options.cacheSweep.empty())
+    addDefaultL1Caches(options);
+
+  // The processor model is optional, and only used for determining the word
+  // size of the simulated memory system.
+  options.proc = ProcessorID::RV32_5S;
+  if (parser.isSet("proc")) {
+    bool ok;
+    int procID = QMetaEnum::fromType<ProcessorID>().keyToValue(
+        parser.value("proc").toStdString().c_str(), &ok);
+    if (!ok) {
+      errorMessage = "Invalid processor model specified '" +
+                     parser.value("proc") + "' (--proc).";
+      return false;
+    }
+    options.proc = static_cast<ProcessorID>(procID);
+  }
+
+  return true;
+}
+
 bool parseCLIOptions(QCommandLineParser &parser, QString &errorMessage,
                      CLIModeOptions &options) {
   options.verbose = parser.isSet("v");
+  options.jsonOutput = parser.isSet("json");
+  options.outputFile = parser.value("output");
+
+  // The remaining options are given per job of a batch.
+  if (parser.isSet("batch")) {
+    options.batch = parser.value("batch");
+    bool ok;
+    options.batchThreads = parser.value("jobs").toUInt(&ok);
+    if (!ok) {
+      errorMessage = "Invalid number of jobs specified (--jobs).";
+      return false;
+    }
+    return true;
+  }
+
+  for (const auto &grid : parser.values("sweep"))
+    if (!parseCacheSweep(grid, options.cacheSweep, errorMessage))
+      return false;
+
+  if (!parseCacheHierarchyOptions(parser, errorMessage, options))
+    return false;
+
+  if (parser.isSet("cachetrace"))
+    return parseCacheTraceOptions(parser, errorMessage, options);
 
   if (!parser.isSet("src")) {
     errorMessage = "No source file specified (--src)";
@@ -101,8 +559,6 @@ bool parseCLIOptions(QCommandLineParser &parser, QString &errorMessage,
   }
   options.proc = static_cast<ProcessorID>(procID);
 
-  options.jsonOutput = parser.isSet("json");
-
   if (parser.isSet("isaexts")) {
     options.isaExtensions = parser.value("isaexts").split(",");
 
@@ -132,7 +588,89 @@ bool parseCLIOptions(QCommandLineParser &parser, QString &errorMessage,
     }
   }
 
-  options.outputFile = parser.value("output");
+  options.cosim = parser.isSet("cosim");
+  if (options.cosim) {
+    if (parser.isSet("cosim-ref")) {
+      int refID = QMetaEnum::fromType<ProcessorID>().keyToValue(
+          parser.value("cosim-ref").toStdString().c_str(), &ok);
+      if (!ok) {
+        errorMessage = "Invalid reference model specified '" +
+                       parser.value("cosim-ref") + "' (--cosim-ref).";
+        return false;
+      }
+      options.cosimReference = static_cast<ProcessorID>(refID);
+    } else {
+      const auto &isa = ProcessorRegistry::getDescription(options.proc)
+                            .isaInfo()
+                            .isa;
+      options.cosimReference =
+          isa->bits() == 64 ? ProcessorID::RV64_SS : ProcessorID::RV32_SS;
+    }
+
+    const auto refExts = ProcessorRegistry::getDescription(
+                             options.cosimReference)
+                             .isaInfo()
+                             .supportedExtensions;
+    for (auto &ext : qAsConst(options.isaExtensions)) {
+      if (!refExts.contains(ext)) {
+        errorMessage = "ISA extension '" + ext +
+                       "' is not supported by the reference model (--cosim).";
+        return false;
+      }
+    }
+  }
+
+  if (parser.isSet("fastforward") && parser.isSet("checkpoint-at")) {
+    errorMessage = "--fastforward and --checkpoint-at are mutually exclusive.";
+    return false;
+  }
+  if (parser.isSet("fastforward")) {
+    FastForwardTarget target;
+    if (!parseFastForwardTarget("fastforward", parser.value("fastforward"),
+                                target, errorMessage))
+      return false;
+    options.fastForward = target;
+  }
+  if (parser.isSet("checkpoint-at")) {
+    FastForwardTarget target;
+    if (!parseFastForwardTarget("checkpoint-at", parser.value("checkpoint-at"),
+                                target, errorMessage))
+      return false;
+    options.checkpointAt = target;
+  }
+  options.checkpointPath = parser.value("checkpoint");
+  options.restorePath = parser.value("restore");
+  options.stdinPath = parser.value("stdin");
+  options.maxFiles = parser.value("maxfiles").toInt(&ok);
+  if (!ok || options.maxFiles < 3) {
+    errorMessage = "Invalid maximum number of open files specified "
+                   "(--maxfiles); at least 3 are required.";
+    return false;
+  }
+  options.fileBufferSize = parser.value("filebuffer").toInt(&ok);
+  if (!ok || options.fileBufferSize <= 0) {
+    errorMessage = "Invalid file buffer size specified (--filebuffer).";
+    return false;
+  }
+  if (options.cosim && options.stdinPath == "-") {
+    // Both models read the input in full; stdin can only be read once.
+    errorMessage = "Co-simulation requires the standard input of the program "
+                   "to be read from a file (--stdin).";
+    return false;
+  }
+  options.pipelineTrace = parser.value("pipetrace");
+  options.profileFolded = parser.value("profile-folded");
+  options.commitTrace = parser.value("committrace");
+  const QString commitTraceFormat = parser.value("committrace-format");
+  if (commitTraceFormat == "bin") {
+    options.commitTraceFormat = CommitTraceWriter::Format::Binary;
+  } else if (commitTraceFormat == "spike") {
+    options.commitTraceFormat = CommitTraceWriter::Format::Spike;
+  } else {
+    errorMessage = "Invalid commit trace format '" + commitTraceFormat +
+                   "' specified (--committrace-format).";
+    return false;
+  }
 
   // Validate register initializations
   if (parser.isSet("reginit")) {
@@ -181,6 +719,8 @@ bool parseCLIOptions(QCommandLineParser &parser, QString &errorMessage,
   for (auto &telemetry : options.telemetry)
     if (parser.isSet("all") || parser.isSet(telemetry->key()))
       telemetry->enable();
+  if (!options.profileFolded.isEmpty() && !options.profile->isEnabled())
+    options.profile->enable();
 
   return true;
 }
@@ -1,9 +1,13 @@
 #pragma once
 
 #include "assembler/program.h"
+#include "cachesim/cachehierarchy.h"
+#include "cachesim/cachesweep.h"
+#include "committracewriter.h"
 #include "processorregistry.h"
 #include "telemetry.h"
 #include <QCommandLineParser>
+#include <optional>
 #include <set>
 
 namespace Ripes {
@@ -19,8 +23,73 @@ struct CLIModeOptions {
   int timeout = 0;
   RegisterInitialization regInit;
 
+  // If set, the program is executed functionally up until this target before
+  // switching to the selected processor model.
+  std::optional<FastForwardTarget> fastForward;
+
+  // If set, the program is fast-forwarded up until this target, at which point
+  // a checkpoint is saved to checkpointPath.
+  std::optional<FastForwardTarget> checkpointAt;
+  QString checkpointPath;
+
+  // If set, the checkpoint at this path is restored before executing the
+  // program.
+  QString restorePath;
+
+  // If set, the stdin of the program is streamed from the file at this path,
+  // or from the stdin of Ripes if '-'. Otherwise, the stdin of the program is
+  // empty.
+  QString stdinPath;
+
+  // Limits of the files opened by the program through the file syscalls; see
+  // SystemIO::setFileLimits().
+  int maxFiles = 32;
+  int fileBufferSize = 1 << 16;
+
+  // If set, a pipeline trace of the processor model is written to this path.
+  QString pipelineTrace;
+
+  // If set, a trace of the instructions retired by the processor model is
+  // written to this path.
+  QString commitTrace;
+  CommitTraceWriter::Format commitTraceFormat =
+      CommitTraceWriter::Format::Binary;
+
+  // Co-simulation. If set, the program is simulated in lockstep on the
+  // processor model and on the reference model, stopping at the first
+  // divergence between the two.
+  bool cosim = false;
+  ProcessorID cosimReference = ProcessorID::RV32_SS;
+
+  // Trace-driven cache simulation. If set, the memory access trace at this path
+  // is simulated through the cache hierarchy, instead of executing a program.
+  QString cacheTrace;
+
+  // Cache hierarchy which is simulated alongside either trace-driven cache
+  // simulation or program execution.
+  CacheHierarchy::Config cacheHierarchy;
+
+  // If set, the processor is stalled on the access latencies of the cache
+  // hierarchy.
+  bool cacheTiming = false;
+
+  // Cache configurations which are simulated alongside either trace-driven
+  // cache simulation or program execution.
+  std::vector<CacheSweep::Config> cacheSweep;
+
   // A list of enabled telemetry options.
   std::vector<std::shared_ptr<Telemetry>> telemetry;
+
+  // The profile telemetry, also contained in the above list. If profileFolded
+  // is set, the folded call stacks of the profile are written to this path.
+  std::shared_ptr<ProfileTelemetry> profile;
+  QString profileFolded;
+
+  // Batch mode. If set, each job of the manifest at this path is run as an
+  // independent CLI invocation, on batchThreads threads (0: one per hardware
+  // thread).
+  QString batch;
+  unsigned batchThreads = 0;
 };
 
 /// Adds Ripes CLI options to a parser.
@@ -1,12 +1,22 @@
 #include "clirunner.h"
+#include "cachesim/cachesim.h"
+#include "cachesim/cachetracereader.h"
+#include "checkpoint.h"
 #include "io/iomanager.h"
 #include "processorhandler.h"
 #include "programutilities.h"
 #include "syscall/systemio.h"
 
+#include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 
+#include <condition_variable>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
 namespace Ripes {
 
 // An extended QVariant-to-string convertion method which handles a few special
@@ -32,26 +42,120 @@ static QString qVariantToString(QVariant &v) {
   return def;
 }
 
-CLIRunner::CLIRunner(const CLIModeOptions &options)
-    : QObject(), m_options(options) {
+CLIRunner::CLIRunner(const CLIModeOptions &options,
+                     SimulationContext &context)
+    : QObject(), m_options(options), m_context(context) {
+  SimulationContext::Scope scope(m_context);
   info("Ripes CLI mode", false, true);
+
+  // Trace-driven cache simulation does not require a processor model.
+  if (!m_options.cacheTrace.isEmpty())
+    return;
+
   ProcessorHandler::selectProcessor(m_options.proc, m_options.isaExtensions,
                                     m_options.regInit);
+  SystemIO::setFileLimits(m_options.maxFiles, m_options.fileBufferSize);
 
-  // Connect systemIO output to stdout.
-  connect(&SystemIO::get(), &SystemIO::doPrint, this, [&](auto text) {
-    std::cout << text.toStdString();
-    std::flush(std::cout);
-  });
+  if (!m_options.cacheSweep.empty()) {
+    m_cacheSweep = std::make_unique<CacheSweep>(
+        m_options.cacheSweep, ProcessorHandler::currentISA()->bytes());
+    m_cacheSweep->attachToProcessor();
+  }
+
+  if (!m_options.cacheHierarchy.empty()) {
+    m_cacheHierarchy = std::make_unique<CacheHierarchy>(
+        m_options.cacheHierarchy, ProcessorHandler::currentISA()->bytes());
+    m_cacheHierarchy->attachToProcessor();
+    if (m_options.cacheTiming) {
+      ProcessorHandler::getProcessorNonConst()->memoryStallCycles =
+          [hierarchy = m_cacheHierarchy.get()] {
+            return static_cast<long long>(hierarchy->estimatedStallCycles());
+          };
+    }
+    if (auto *profiler = m_options.profile->profiler())
+      profiler->setCaches(m_cacheHierarchy->cache(CacheHierarchy::L1I),
+                          m_cacheHierarchy->cache(CacheHierarchy::L1D));
+  }
+
+  if (!m_context.isApplicationContext()) {
+    // The console output of a batch job is reported along with its results.
+    // Syscalls are executed while the simulation thread is blocked, so the
+    // output is collected directly from the thread executing the syscall.
+    connect(
+        &SystemIO::get(), &SystemIO::doPrint, this,
+        [&](const QByteArray &bytes) {
+          m_jobConsole += QString::fromUtf8(bytes);
+        },
+        Qt::DirectConnection);
+    return;
+  }
 
-  // TODO: how to handle system input?
+  // The output of the program is buffered by SystemIO, and written to stdout
+  // by a writer thread, in as large writes as are available. As such, output
+  // heavy programs are not throttled by the event loop nor by the console.
+  m_outputWriter =
+      std::thread([output = SystemIO::get().enableOutputBuffer()] {
+        const char *data;
+        while (const size_t n = output->acquire(0, data)) {
+          std::cout.write(data, n);
+          std::cout.flush();
+          output->release(0, n);
+        }
+      });
+  // Output which bypasses the ring (see SystemIO::writeOutput) is written
+  // directly, once the writer has drained the ring.
+  connect(
+      &SystemIO::get(), &SystemIO::doPrint, this,
+      [](const QByteArray &bytes) {
+        std::cout.write(bytes.constData(), bytes.size());
+        std::cout.flush();
+      },
+      Qt::DirectConnection);
+}
+
+CLIRunner::~CLIRunner() {
+  flushOutput();
+  closeStdIn();
+  if (m_options.cacheTiming && m_cacheHierarchy) {
+    // The stall callback refers to the cache hierarchy of this runner, whereas
+    // the processor outlives the runner.
+    SimulationContext::Scope scope(m_context);
+    ProcessorHandler::getProcessorNonConst()->memoryStallCycles = nullptr;
+  }
+}
+
+void CLIRunner::flushOutput() {
+  if (!m_outputWriter.joinable())
+    return;
+  SimulationContext::Scope scope(m_context);
+  SystemIO::get().disableOutputBuffer();
+  m_outputWriter.join();
 }
 
 int CLIRunner::run() {
+  SimulationContext::Scope scope(m_context);
+  if (!m_options.cacheTrace.isEmpty())
+    return runCacheTrace();
+
   if (processInput())
     return 1;
 
-  if (runModel())
+  if (openStdIn())
+    return 1;
+
+  if (restoreCheckpoint())
+    return 1;
+
+  if (fastForward())
+    return 1;
+
+  const int result = runModel();
+  // The output of the program precedes any reports.
+  flushOutput();
+  if (result)
+    return 1;
+
+  if (writeProfile())
     return 1;
 
   if (postRun())
@@ -60,6 +164,104 @@ int CLIRunner::run() {
   return 0;
 }
 
+QJsonObject CLIRunner::runJob() {
+  Q_ASSERT(!m_context.isApplicationContext());
+  SimulationContext::Scope scope(m_context);
+  QJsonObject result;
+
+  bool ok = !load();
+  if (ok) {
+    QElapsedTimer runTime;
+    runTime.start();
+    ok = !runModel();
+    const qint64 runNs = std::max<qint64>(1, runTime.nsecsElapsed());
+    const auto instrsRetired =
+        ProcessorHandler::getProcessor()->getInstructionsRetired();
+    result["MIPS"] = static_cast<double>(instrsRetired) * 1e3 / runNs;
+    ok = ok && !writeProfile();
+  }
+
+  if (ok) {
+    QJsonObject report;
+    reportJson(report);
+    result["report"] = report;
+  } else {
+    result["error"] = m_jobErrors.join("\n");
+  }
+  result["status"] = ok ? "ok" : "error";
+  result["output"] = m_jobConsole;
+  return result;
+}
+
+int CLIRunner::load() {
+  Q_ASSERT(!m_context.isApplicationContext());
+  SimulationContext::Scope scope(m_context);
+  if (processInput() || openStdIn() || restoreCheckpoint() || fastForward())
+    return 1;
+  return 0;
+}
+
+int CLIRunner::openStdIn() {
+  auto &sio = SystemIO::get();
+  const QString &path = m_options.stdinPath;
+  if (path.isEmpty()) {
+    // The stdin of Ripes is only read when requested, as the reader would
+    // otherwise consume the input of the invoking process.
+    sio.closeStdIn();
+    return 0;
+  }
+
+  if (path == "-") {
+    // stdin is read line by line, such that the program may be interacted
+    // with from a terminal.
+    m_stdinFromHost = true;
+    m_stdinReader = std::thread([&sio] {
+      std::string line;
+      while (std::getline(std::cin, line)) {
+        if (!std::cin.eof())
+          line.push_back('\n');
+        if (!sio.feedStdIn(line.data(), line.size()))
+          break;
+      }
+      sio.closeStdIn();
+    });
+    return 0;
+  }
+
+  FILE *file = std::fopen(path.toLocal8Bit().constData(), "rb");
+  if (!file) {
+    error("Could not open stdin file '" + path + "'");
+    return 1;
+  }
+  // The file is streamed in large blocks; at most SystemIO::STDIN_BUFFER_SIZE
+  // bytes of the file are buffered ahead of the program.
+  m_stdinReader = std::thread([&sio, file] {
+    std::vector<char> buffer(1 << 16);
+    size_t n;
+    while ((n = std::fread(buffer.data(), 1, buffer.size(), file)) > 0) {
+      if (!sio.feedStdIn(buffer.data(), n))
+        break;
+    }
+    std::fclose(file);
+    sio.closeStdIn();
+  });
+  return 0;
+}
+
+void CLIRunner::closeStdIn() {
+  if (!m_stdinReader.joinable())
+    return;
+  SimulationContext::Scope scope(m_context);
+  SystemIO::get().closeStdIn();
+  if (m_stdinFromHost) {
+    // The reader may be blocked on stdin indefinitely, and is left to finish
+    // once stdin is read from; any input is then discarded.
+    m_stdinReader.detach();
+  } else {
+    m_stdinReader.join();
+  }
+}
+
 int CLIRunner::processInput() {
   info("Processing input file", false, true);
 
@@ -95,15 +297,89 @@ int CLIRunner::processInput() {
     break;
   }
   default:
-    assert(false &&
-           "Command-line support for this source type is not yet implemented");
+    error("Command-line support for this source type is not yet implemented");
+    return 1;
   }
 
   return 0;
 }
 
+int CLIRunner::restoreCheckpoint() {
+  if (m_options.restorePath.isEmpty())
+    return 0;
+
+  info("Restoring checkpoint", false, true);
+  Checkpoint checkpoint;
+  QString err = Checkpoint::load(m_options.restorePath, checkpoint);
+  if (err.isEmpty())
+    err = ProcessorHandler::restoreCheckpoint(checkpoint);
+  if (!err.isEmpty()) {
+    error(err);
+    return 1;
+  }
+  m_restoredInstructions = checkpoint.instructions;
+  info("Restored checkpoint '" + m_options.restorePath + "' taken after " +
+       QString::number(checkpoint.instructions) + " instructions");
+  return 0;
+}
+
+int CLIRunner::fastForward() {
+  const bool checkpointing = m_options.checkpointAt.has_value();
+  const auto &target =
+      checkpointing ? m_options.checkpointAt : m_options.fastForward;
+  if (!target)
+    return 0;
+
+  info("Fast-forwarding", false, true);
+  QElapsedTimer elapsed;
+  elapsed.start();
+  long long instructions;
+  Checkpoint checkpoint;
+  const QString err = ProcessorHandler::fastForward(
+      *target, instructions, checkpointing ? &checkpoint : nullptr);
+  if (!err.isEmpty()) {
+    error(err);
+    return 1;
+  }
+  info("Fast-forwarded " + QString::number(instructions) +
+       " instructions in " + QString::number(elapsed.elapsed()) + " ms");
+
+  if (checkpointing) {
+    // Checkpoints count instructions from the start of the program.
+    checkpoint.instructions += m_restoredInstructions;
+    const QString saveErr = checkpoint.save(m_options.checkpointPath);
+    if (!saveErr.isEmpty()) {
+      error(saveErr);
+      return 1;
+    }
+    info("Saved checkpoint to '" + m_options.checkpointPath + "' (" +
+         QString::number(checkpoint.pages.size()) + " memory pages)");
+  }
+  return 0;
+}
+
 int CLIRunner::runModel() {
   info("Running model", false, true);
+  if (!m_options.pipelineTrace.isEmpty()) {
+    m_pipelineTrace = std::make_unique<PipelineTraceWriter>();
+    const QString err = m_pipelineTrace->open(m_options.pipelineTrace);
+    if (!err.isEmpty()) {
+      error(err);
+      return 1;
+    }
+  }
+  if (!m_options.commitTrace.isEmpty()) {
+    m_commitTrace = std::make_unique<CommitTraceWriter>();
+    const QString err =
+        m_commitTrace->open(m_options.commitTrace, m_options.commitTraceFormat);
+    if (!err.isEmpty()) {
+      error(err);
+      return 1;
+    }
+  }
+
+  if (!m_context.isApplicationContext())
+    return runModelBlocking();
 
   // Wait until receiving ProcessorHandler::runFinished signal
   // before proceeding.
@@ -157,32 +433,84 @@ int CLIRunner::runModel() {
   return 0;
 }
 
+int CLIRunner::runModelBlocking() {
+  // Without an event loop, the timeout is enforced by a watchdog thread, which
+  // stops the run unless it finishes in time.
+  std::mutex lock;
+  std::condition_variable finishedCond;
+  bool finished = false;
+  bool hadTimeout = false;
+  std::thread watchdog;
+  if (m_options.timeout != 0) {
+    watchdog = std::thread([&] {
+      std::unique_lock l(lock);
+      const auto timeout = std::chrono::milliseconds(m_options.timeout);
+      if (!finishedCond.wait_for(l, timeout, [&] { return finished; })) {
+        hadTimeout = true;
+        m_context.stop();
+      }
+    });
+  }
+
+  m_context.run();
+
+  {
+    std::unique_lock l(lock);
+    finished = true;
+  }
+  finishedCond.notify_all();
+  if (watchdog.joinable())
+    watchdog.join();
+
+  if (hadTimeout) {
+    error("Simulation did not finish within the specified timeout (" +
+          QString::number(m_options.timeout) + " ms)");
+    return 1;
+  }
+  return 0;
+}
+
+int CLIRunner::writeProfile() {
+  if (m_options.profileFolded.isEmpty())
+    return 0;
+
+  QFile file(m_options.profileFolded);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate |
+                 QIODevice::Text)) {
+    error("Failed to open profile output file '" + m_options.profileFolded +
+          "'");
+    return 1;
+  }
+  file.write(m_options.profile->profiler()->foldedStacks().toUtf8());
+  return 0;
+}
+
+std::unique_ptr<QTextStream>
+CLIRunner::openReportStream(std::unique_ptr<QFile> &outputFile) {
+  if (m_options.outputFile.isEmpty())
+    return std::make_unique<QTextStream>(stdout, QIODevice::WriteOnly);
+
+  outputFile = std::make_unique<QFile>(m_options.outputFile);
+  if (!outputFile->open(QIODevice::Truncate | QIODevice::Text |
+                        QIODevice::WriteOnly)) {
+    error("Failed to open output file");
+    return nullptr;
+  }
+  return std::make_unique<QTextStream>(outputFile.get());
+}
+
 int CLIRunner::postRun() {
   info("Post-run", false, true);
 
   // Open output stream
-  std::unique_ptr<QTextStream> stream;
   std::unique_ptr<QFile> outputFile;
-  if (m_options.outputFile.isEmpty()) {
-    stream = std::make_unique<QTextStream>(stdout, QIODevice::WriteOnly);
-  } else {
-    outputFile = std::make_unique<QFile>(m_options.outputFile);
-    if (!outputFile->open(QIODevice::Truncate | QIODevice::Text |
-                          QIODevice::WriteOnly)) {
-      error("Failed to open output file");
-      return 1;
-    }
-    stream = std::make_unique<QTextStream>(outputFile.get());
-  }
+  std::unique_ptr<QTextStream> stream = openReportStream(outputFile);
+  if (!stream)
+    return 1;
 
+  QJsonObject jsonOutput;
   if (m_options.jsonOutput) {
-    // Telemetry output
-    QJsonObject jsonOutput;
-    for (auto &telemetry : m_options.telemetry)
-      if (telemetry->isEnabled())
-        jsonOutput.insert(
-            telemetry->prettyKey(),
-            QJsonValue::fromVariant(telemetry->report(/*json=*/true)));
+    reportJson(jsonOutput);
     *stream << QJsonDocument(jsonOutput).toJson(QJsonDocument::Indented);
   } else {
     // Telemetry output
@@ -192,6 +520,8 @@ int CLIRunner::postRun() {
         QVariant reportedValue = telemetry->report(/*json=*/false);
         *stream << qVariantToString(reportedValue) << "\n";
       }
+    reportCacheHierarchy(*stream, jsonOutput);
+    reportCacheSweep(*stream, jsonOutput);
   }
 
   // Close output file if necessary
@@ -201,8 +531,198 @@ int CLIRunner::postRun() {
   return 0;
 }
 
+void CLIRunner::reportJson(QJsonObject &jsonOutput) {
+  Q_ASSERT(m_options.jsonOutput);
+
+  // Telemetry output
+  for (auto &telemetry : m_options.telemetry)
+    if (telemetry->isEnabled())
+      jsonOutput.insert(
+          telemetry->prettyKey(),
+          QJsonValue::fromVariant(telemetry->report(/*json=*/true)));
+
+  // The stream is not written to for JSON reports.
+  QTextStream unused;
+  reportCacheHierarchy(unused, jsonOutput);
+  reportCacheSweep(unused, jsonOutput);
+}
+
+int CLIRunner::runCacheTrace() {
+  info("Running cache trace", false, true);
+
+  CacheTraceReader reader;
+  QString err = reader.open(m_options.cacheTrace);
+  if (!err.isEmpty()) {
+    error(err);
+    return 1;
+  }
+
+  // Construct the caches detached from the processor handler; only the word
+  // size of the selected processor model is of relevance.
+  const unsigned wordBytes =
+      ProcessorRegistry::getDescription(m_options.proc).isaInfo().isa->bytes();
+  if (!m_options.cacheHierarchy.empty())
+    m_cacheHierarchy =
+        std::make_unique<CacheHierarchy>(m_options.cacheHierarchy, wordBytes);
+  if (!m_options.cacheSweep.empty()) {
+    m_cacheSweep =
+        std::make_unique<CacheSweep>(m_options.cacheSweep, wordBytes);
+    info("Sweeping " + QString::number(m_options.cacheSweep.size()) +
+         " cache configurations on " +
+         QString::number(m_cacheSweep->workerCount()) + " threads");
+  }
+
+  QElapsedTimer elapsed;
+  elapsed.start();
+  uint64_t accesses = 0;
+  std::vector<TraceAccess> buffer(1 << 16);
+  while (size_t n = reader.read(buffer.data(), buffer.size())) {
+    if (m_cacheSweep)
+      m_cacheSweep->access(buffer.data(), n);
+    if (m_cacheHierarchy)
+      for (size_t i = 0; i < n; ++i)
+        m_cacheHierarchy->access(buffer[i]);
+    accesses += n;
+  }
+  if (m_cacheSweep) {
+    // Wait for the sweep to finish
+    m_cacheSweep->results();
+  }
+  const qint64 elapsedMs = elapsed.elapsed();
+
+  if (!reader.error().isEmpty()) {
+    error(reader.error());
+    return 1;
+  }
+  info("Simulated " + QString::number(accesses) + " accesses in " +
+       QString::number(elapsedMs) + " ms");
+
+  // Report
+  std::unique_ptr<QFile> outputFile;
+  std::unique_ptr<QTextStream> stream = openReportStream(outputFile);
+  if (!stream)
+    return 1;
+
+  QVariantMap traceReport;
+  traceReport["file"] = m_options.cacheTrace;
+  traceReport["accesses"] = QVariant::fromValue(accesses);
+  traceReport["time (ms)"] = elapsedMs;
+  QJsonObject jsonOutput;
+  jsonOutput.insert("trace", QJsonValue::fromVariant(traceReport));
+  if (!m_options.jsonOutput) {
+    QVariant v = traceReport;
+    *stream << "===== trace\n" << qVariantToString(v) << "\n";
+  }
+
+  reportCacheHierarchy(*stream, jsonOutput);
+  reportCacheSweep(*stream, jsonOutput);
+  if (m_options.jsonOutput)
+    *stream << QJsonDocument(jsonOutput).toJson(QJsonDocument::Indented);
+
+  if (outputFile)
+    outputFile->close();
+
+  return 0;
+}
+
+void CLIRunner::reportCacheHierarchy(QTextStream &stream,
+                                     QJsonObject &jsonOutput) {
+  if (!m_cacheHierarchy)
+    return;
+
+  auto report = [&](const QString &name, const QVariantMap &values) {
+    if (m_options.jsonOutput) {
+      jsonOutput.insert(name, QJsonValue::fromVariant(values));
+    } else {
+      QVariant v = values;
+      stream << "===== " << name << "\n" << qVariantToString(v) << "\n";
+    }
+  };
+
+  QVariantMap amatReport;
+  for (unsigned i = 0; i < CacheHierarchy::NumLevels; ++i) {
+    const auto level = static_cast<CacheHierarchy::Level>(i);
+    const auto &cache = m_cacheHierarchy->cache(level);
+    if (!cache)
+      continue;
+    const auto &levelConfig = *m_cacheHierarchy->config().levels[level];
+    QVariantMap cacheReport;
+    cacheReport["accesses"] = cache->getHits() + cache->getMisses();
+    cacheReport["hits"] = cache->getHits();
+    cacheReport["misses"] = cache->getMisses();
+    cacheReport["hit rate"] = cache->getHitRate();
+    cacheReport["writebacks"] = cache->getWritebacks();
+    cacheReport["size (bits)"] = cache->getCacheSize().bits;
+    cacheReport["latency"] = levelConfig.latency;
+    cacheReport["inclusion"] =
+        s_cacheInclusionPolicyStrings.at(levelConfig.inclusion);
+    report(CacheHierarchy::levelName(level), cacheReport);
+  }
+
+  amatReport["instruction"] = m_cacheHierarchy->amat(true);
+  amatReport["data"] = m_cacheHierarchy->amat(false);
+  amatReport["overall"] = m_cacheHierarchy->amat();
+  amatReport["memory latency"] = m_cacheHierarchy->config().memoryLatency;
+  report("average memory access time (cycles)", amatReport);
+}
+
+void CLIRunner::reportCacheSweep(QTextStream &stream, QJsonObject &jsonOutput) {
+  if (!m_cacheSweep)
+    return;
+
+  const auto results = m_cacheSweep->results();
+  if (m_options.jsonOutput) {
+    QJsonArray jsonResults;
+    for (const auto &result : results) {
+      QJsonObject jsonResult;
+      jsonResult["target"] = CacheSweep::targetName(result.config.target);
+      jsonResult["config"] = result.config.preset.name;
+      jsonResult["accesses"] = double(result.hits) + result.misses;
+      jsonResult["hits"] = double(result.hits);
+      jsonResult["misses"] = double(result.misses);
+      jsonResult["hit rate"] = result.hitRate;
+      jsonResult["writebacks"] = double(result.writebacks);
+      jsonResult["size (bits)"] = double(result.sizeBits);
+      jsonResults.append(jsonResult);
+    }
+    jsonOutput.insert("cache sweep", jsonResults);
+    return;
+  }
+
+  int configWidth = QString("config").length();
+  for (const auto &result : results)
+    configWidth =
+        std::max<int>(configWidth, result.config.preset.name.length());
+
+  stream << "===== cache sweep\n";
+  stream << QString("%1  %2  %3  %4  %5  %6\n")
+                .arg("target")
+                .arg("config", -configWidth)
+                .arg("accesses", 12)
+                .arg("hit rate", 8)
+                .arg("writebacks", 12)
+                .arg("size (bits)", 12);
+  for (const auto &result : results) {
+    stream << QString("%1  %2  %3  %4  %5  %6\n")
+                  .arg(CacheSweep::targetName(result.config.target), -6)
+                  .arg(result.config.preset.name, -configWidth)
+                  .arg(qulonglong(result.hits) + result.misses, 12)
+                  .arg(result.hitRate, 8, 'f', 4)
+                  .arg(result.writebacks, 12)
+                  .arg(result.sizeBits, 12);
+  }
+  stream << "\n";
+}
+
 void CLIRunner::info(QString msg, bool alwaysPrint, bool header,
                      const QString &prefix) {
+  if (!m_context.isApplicationContext()) {
+    // Batch jobs only report the messages which are always printed, being
+    // their errors.
+    if (alwaysPrint)
+      m_jobErrors << msg;
+    return;
+  }
 
   if (m_options.verbose || alwaysPrint) {
     if (header) {
@@ -1,36 +1,126 @@
 #pragma once
 
 #include "clioptions.h"
+#include "pipelinetracewriter.h"
+#include "simulationcontext.h"
+#include <QFile>
+#include <QJsonObject>
 #include <QObject>
+#include <QTextStream>
+
+#include <thread>
 
 namespace Ripes {
 
 /// The CLIRunner class is used to run Ripes in CLI mode.
 /// Based on a CLIModeOptions struct, it will run the appropriate combination
 /// of source processing (assembler/compiler/...), processor model execution
-/// as well as telemetry gathering and reporting.
+/// as well as telemetry gathering and reporting. The simulation is performed
+/// within @p context, which may be shared with the GUI (the application
+/// context) or be private to the runner, ie. when running a batch job.
 class CLIRunner : public QObject {
   Q_OBJECT
 public:
-  CLIRunner(const CLIModeOptions &options);
+  CLIRunner(const CLIModeOptions &options,
+            SimulationContext &context = SimulationContext::application());
+  ~CLIRunner() override;
 
   /// Runs the CLI mode.
   int run();
 
+  /// Runs the CLI mode as a job of a batch, which must be run within a
+  /// context other than the application context. Nothing is printed to the
+  /// console; the JSON report, errors and console output of the program are
+  /// returned as a JSON object, along with the simulated MIPS of the run.
+  QJsonObject runJob();
+
+  /// Loads the program into the processor model; processes the input, restores
+  /// any checkpoint and fast-forwards to any target, as done prior to running
+  /// the model. Used for running the model outside of the runner, which must
+  /// be within a context other than the application context.
+  int load();
+
+  /// Returns the errors reported while running within a context other than
+  /// the application context.
+  const QStringList &errors() const { return m_jobErrors; }
+
 private:
   /// Process the provided source file (assembling, compiling, loading, ...)
   int processInput();
 
+  /// Starts streaming the stdin of the program from its source (see
+  /// CLIModeOptions::stdinPath) in a reader thread.
+  int openStdIn();
+
+  /// Closes the stdin of the program, and stops the reader thread (if
+  /// running).
+  void closeStdIn();
+
+  /// Restores the architectural state of the checkpoint to restore (if any).
+  int restoreCheckpoint();
+
+  /// Executes the program functionally up until the fast-forward or checkpoint
+  /// target (if any), before the processor model takes over. In the latter
+  /// case, a checkpoint is saved at the target.
+  int fastForward();
+
   /// Runs the processor model until the program is finished.
   int runModel();
 
+  /// As runModel(), but runs the processor model in the calling thread, which
+  /// need not have an event loop.
+  int runModelBlocking();
+
+  /// Writes the folded call stacks of the profile to the requested path (if
+  /// any).
+  int writeProfile();
+
+  /// Writes the remaining output of the program to stdout, and stops the
+  /// output writer thread (if running).
+  void flushOutput();
+
   /// Prints requested telemetry to the console/output file.
   int postRun();
+
+  /// Inserts the requested telemetry and cache statistics into @p jsonOutput.
+  void reportJson(QJsonObject &jsonOutput);
+
+  /// Simulates the memory access trace through the configured caches, and
+  /// reports the resulting cache statistics.
+  int runCacheTrace();
+
+  /// Reports the statistics of the cache sweep (if any) as a table, or as a
+  /// JSON array in @p jsonOutput.
+  void reportCacheSweep(QTextStream &stream, QJsonObject &jsonOutput);
+
+  /// Reports the statistics of each level of the cache hierarchy (if any),
+  /// followed by its average memory access time.
+  void reportCacheHierarchy(QTextStream &stream, QJsonObject &jsonOutput);
+
+  /// Opens the report output stream; either the output file (stored in
+  /// @p outputFile) or stdout. Returns nullptr on failure.
+  std::unique_ptr<QTextStream> openReportStream(std::unique_ptr<QFile> &file);
   void info(QString msg, bool alwaysPrint = false, bool header = false,
             const QString &prefix = "INFO");
   void error(const QString &msg);
 
   CLIModeOptions m_options;
+  SimulationContext &m_context;
+  // Errors and console output of a batch job; see runJob().
+  QStringList m_jobErrors;
+  QString m_jobConsole;
+  // The number of instructions executed prior to the restored checkpoint.
+  uint64_t m_restoredInstructions = 0;
+  std::unique_ptr<CacheSweep> m_cacheSweep;
+  std::unique_ptr<CacheHierarchy> m_cacheHierarchy;
+  // Written while running the model, and closed once the runner is destroyed.
+  std::unique_ptr<PipelineTraceWriter> m_pipelineTrace;
+  std::unique_ptr<CommitTraceWriter> m_commitTrace;
+  // Writes the buffered output of the program to stdout; see CLIRunner().
+  std::thread m_outputWriter;
+  // Feeds the stdin of the program from its source; see openStdIn().
+  std::thread m_stdinReader;
+  bool m_stdinFromHost = false;
 };
 
 } // namespace Ripes
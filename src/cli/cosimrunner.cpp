@@ -0,0 +1,245 @@
+#include "cosimrunner.h"
+#include "clirunner.h"
+#include "processorhandler.h"
+#include "simulationcontext.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <iostream>
+#include <thread>
+
+namespace Ripes {
+
+// Number of retired instructions by which the reference model may run ahead of
+// the target model.
+static constexpr unsigned s_ringSizeLog2 = 12;
+
+static std::vector<VInt> readRegisters() {
+  std::vector<VInt> regs;
+  for (unsigned i = 0; i < ProcessorHandler::currentISA()->regCnt(); ++i)
+    regs.push_back(
+        ProcessorHandler::getRegisterValue(RegisterFileType::GPR, i));
+  return regs;
+}
+
+CosimRunner::CosimRunner(const CLIModeOptions &options)
+    : m_options(options), m_ring(s_ringSizeLog2, 1) {}
+
+int CosimRunner::run() {
+  std::thread reference(&CosimRunner::runReference, this);
+  std::thread target(&CosimRunner::runTarget, this);
+
+  if (m_options.timeout != 0) {
+    std::unique_lock lock(m_doneLock);
+    const auto timeout = std::chrono::milliseconds(m_options.timeout);
+    if (!m_doneCond.wait_for(lock, timeout, [&] { return m_targetDone; })) {
+      m_timedOut = true;
+      lock.unlock();
+      stopAll();
+    }
+  }
+
+  target.join();
+  reference.join();
+  return report();
+}
+
+void CosimRunner::runReference() {
+  SimulationContext context;
+  SimulationContext::Scope scope(context);
+  CLIModeOptions options = m_options;
+  options.proc = m_options.cosimReference;
+  {
+    CLIRunner runner(options, context);
+    if (runner.load()) {
+      error("reference", runner.errors());
+      stopAll();
+    } else {
+      setContext(0, &context);
+      CommitObserver observer([&](const CommitRecord &record) {
+        if (m_stop) {
+          context.stop();
+          return;
+        }
+        m_ring.push(&record, 1);
+      });
+      context.run();
+      setContext(0, nullptr);
+      m_referenceRegs = readRegisters();
+    }
+  }
+  m_ring.close();
+}
+
+void CosimRunner::runTarget() {
+  SimulationContext context;
+  SimulationContext::Scope scope(context);
+  {
+    CLIRunner runner(m_options, context);
+    if (runner.load()) {
+      error("target", runner.errors());
+      stopAll();
+    } else {
+      m_xlen = ProcessorHandler::currentISA()->bits();
+      setContext(1, &context);
+      CommitObserver observer([&](const CommitRecord &record) {
+        if (m_stop) {
+          context.stop();
+          return;
+        }
+        const CommitRecord *reference;
+        if (m_ring.acquire(0, reference) == 0) {
+          if (!m_stop)
+            diverge("The reference model finished before the target model.",
+                    std::nullopt, record);
+          return;
+        }
+        const CommitRecord referenceRecord = *reference;
+        m_ring.release(0, 1);
+        if (referenceRecord != record) {
+          diverge("The retired instructions differ.", referenceRecord, record);
+          return;
+        }
+        m_instructions++;
+      });
+      context.run();
+      setContext(1, nullptr);
+
+      // The reference model must not retire any further instructions.
+      const CommitRecord *reference;
+      if (!m_stop && m_ring.acquire(0, reference) != 0)
+        diverge("The target model finished before the reference model.",
+                *reference, std::nullopt);
+      m_targetRegs = readRegisters();
+    }
+  }
+
+  // Drain the ring, such that the reference model is not blocked on pushing to
+  // it before it observes that it must stop.
+  m_stop = true;
+  const CommitRecord *items;
+  while (size_t n = m_ring.acquire(0, items))
+    m_ring.release(0, n);
+
+  {
+    std::unique_lock lock(m_doneLock);
+    m_targetDone = true;
+  }
+  m_doneCond.notify_all();
+}
+
+void CosimRunner::diverge(const QString &reason,
+                          std::optional<CommitRecord> reference,
+                          std::optional<CommitRecord> target) {
+  // Only called from the target thread.
+  if (m_divergence.isEmpty()) {
+    m_divergence = reason;
+    m_referenceRecord = reference;
+    m_targetRecord = target;
+  }
+  stopAll();
+}
+
+void CosimRunner::stopAll() {
+  m_stop = true;
+  std::unique_lock lock(m_contextLock);
+  for (auto *context : m_contexts)
+    if (context)
+      context->stop();
+}
+
+void CosimRunner::setContext(unsigned index, SimulationContext *context) {
+  std::unique_lock lock(m_contextLock);
+  m_contexts[index] = context;
+  if (context && m_stop)
+    context->stop();
+}
+
+void CosimRunner::error(const QString &model, const QStringList &errors) {
+  std::unique_lock lock(m_errorLock);
+  for (const auto &err : errors)
+    m_errors << "(" + model + ") " + err;
+}
+
+int CosimRunner::report() {
+  for (const auto &err : qAsConst(m_errors))
+    std::cerr << "ERROR: " << err.toStdString() << std::endl;
+
+  // Registers which are not written by retired instructions, ie. through
+  // system calls, are compared once both models finished.
+  if (m_errors.isEmpty() && !m_timedOut && m_divergence.isEmpty()) {
+    for (unsigned i = 0; i < m_referenceRegs.size(); ++i) {
+      if (i < m_targetRegs.size() && m_referenceRegs[i] != m_targetRegs[i]) {
+        m_divergence = "The final value of register x" + QString::number(i) +
+                       " differs (reference: 0x" +
+                       QString::number(m_referenceRegs[i], 16) +
+                       ", target: 0x" + QString::number(m_targetRegs[i], 16) +
+                       ").";
+        break;
+      }
+    }
+  }
+
+  QString status = "match";
+  if (!m_errors.isEmpty())
+    status = "error";
+  else if (m_timedOut)
+    status = "timeout";
+  else if (!m_divergence.isEmpty())
+    status = "divergence";
+
+  const QString reference =
+      enumToString<ProcessorID>(m_options.cosimReference);
+  const QString target = enumToString<ProcessorID>(m_options.proc);
+  auto recordString = [&](const std::optional<CommitRecord> &record) {
+    return record ? QString(record->toSpike(m_xlen)) : QString("-");
+  };
+
+  QString output;
+  QTextStream stream(&output);
+  if (m_options.jsonOutput) {
+    QJsonObject json;
+    json["reference"] = reference;
+    json["target"] = target;
+    json["status"] = status;
+    json["matching instructions"] = static_cast<qint64>(m_instructions);
+    if (!m_divergence.isEmpty()) {
+      QJsonObject divergence;
+      divergence["reason"] = m_divergence;
+      divergence["reference"] = recordString(m_referenceRecord);
+      divergence["target"] = recordString(m_targetRecord);
+      json["divergence"] = divergence;
+    }
+    stream << QJsonDocument(json).toJson(QJsonDocument::Indented);
+  } else {
+    stream << "Co-simulation of " << target << " against " << reference
+           << "\n";
+    stream << "Matching instructions: " << m_instructions << "\n";
+    stream << "Result: " << status << "\n";
+    if (!m_divergence.isEmpty()) {
+      stream << m_divergence << "\n";
+      if (m_referenceRecord || m_targetRecord) {
+        stream << "  reference: " << recordString(m_referenceRecord) << "\n";
+        stream << "  target:    " << recordString(m_targetRecord) << "\n";
+      }
+    }
+  }
+  stream.flush();
+
+  if (m_options.outputFile.isEmpty()) {
+    std::cout << output.toStdString();
+  } else {
+    QFile file(m_options.outputFile);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate |
+                   QIODevice::Text)) {
+      std::cerr << "ERROR: Failed to open output file" << std::endl;
+      return 1;
+    }
+    file.write(output.toUtf8());
+  }
+  return status == "match" ? 0 : 1;
+}
+
+} // namespace Ripes
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "utilities/spmcring.h"
+#include "clioptions.h"
+#include "commitobserver.h"
+
+#include <QStringList>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+
+namespace Ripes {
+
+class SimulationContext;
+
+/// The CosimRunner class co-simulates a program on the selected processor
+/// model (the target) and on a reference model, in lockstep. Each model is
+/// simulated within its own SimulationContext, on its own thread. The
+/// instructions retired by the reference model are passed to the target thread
+/// through a bounded, lock-free ring, and each instruction retired by the
+/// target model is compared to that retired by the reference model. The
+/// co-simulation stops at the first divergence. As the reference model runs at
+/// most a ring ahead of the target model, memory use is independent of the
+/// length of the program.
+class CosimRunner {
+public:
+  CosimRunner(const CLIModeOptions &options);
+
+  /// Runs the co-simulation. Returns 0 if the models did not diverge.
+  int run();
+
+private:
+  void runReference();
+  void runTarget();
+
+  /// Records a divergence (if none was recorded yet) and stops both models.
+  void diverge(const QString &reason, std::optional<CommitRecord> reference,
+               std::optional<CommitRecord> target);
+  void stopAll();
+  void error(const QString &model, const QStringList &errors);
+  /// Registers @p context of model @p index (0: reference, 1: target) to be
+  /// stopped by stopAll(), or unregisters it if nullptr.
+  void setContext(unsigned index, SimulationContext *context);
+  int report();
+
+  CLIModeOptions m_options;
+  SPMCRing<CommitRecord> m_ring;
+  std::atomic<bool> m_stop = false;
+  bool m_timedOut = false;
+
+  std::mutex m_contextLock;
+  SimulationContext *m_contexts[2] = {nullptr, nullptr};
+
+  std::mutex m_doneLock;
+  std::condition_variable m_doneCond;
+  bool m_targetDone = false;
+
+  // Results
+  // Number of retired instructions which matched.
+  uint64_t m_instructions = 0;
+  unsigned m_xlen = 32;
+  QString m_divergence;
+  std::optional<CommitRecord> m_referenceRecord;
+  std::optional<CommitRecord> m_targetRecord;
+  std::vector<VInt> m_referenceRegs;
+  std::vector<VInt> m_targetRegs;
+  std::mutex m_errorLock;
+  QStringList m_errors;
+};
+
+} // namespace Ripes
@@ -4,6 +4,7 @@
 
 #include "pipelinediagrammodel.h"
 #include "processorhandler.h"
+#include "profiler.h"
 #include "radix.h"
 
 #include <memory>
@@ -45,7 +46,8 @@ class CPITelemetry : public Telemetry {
   }
 
   QVariant report(bool /*json*/) override {
-    const auto cycleCount = ProcessorHandler::getProcessor()->getCycleCount();
+    const auto cycleCount =
+        ProcessorHandler::getProcessor()->getTotalCycleCount();
     const auto instrsRetired =
         ProcessorHandler::getProcessor()->getInstructionsRetired();
     const double cpi =
@@ -61,7 +63,8 @@ class IPCTelemetry : public Telemetry {
     return "instructions per cycle (IPC)";
   }
   QVariant report(bool /*json*/) override {
-    const auto cycleCount = ProcessorHandler::getProcessor()->getCycleCount();
+    const auto cycleCount =
+        ProcessorHandler::getProcessor()->getTotalCycleCount();
     const auto instrsRetired =
         ProcessorHandler::getProcessor()->getInstructionsRetired();
     const double cpi =
@@ -71,11 +74,29 @@ class IPCTelemetry : public Telemetry {
   }
 };
 
+class MemoryStallCPITelemetry : public Telemetry {
+  QString key() const override { return "memcpi"; }
+  QString prettyKey() const override { return "estimated memory stall CPI"; }
+  QString description() const override {
+    return "estimated memory stall cycles per instruction (requires "
+           "--cachetiming)";
+  }
+  QVariant report(bool /*json*/) override {
+    const auto stallCycles =
+        ProcessorHandler::getProcessor()->getMemoryStallCycles();
+    const auto instrsRetired =
+        ProcessorHandler::getProcessor()->getInstructionsRetired();
+    const double cpi =
+        static_cast<double>(stallCycles) / static_cast<double>(instrsRetired);
+    return cpi;
+  }
+};
+
 class CyclesTelemetry : public Telemetry {
   QString key() const override { return "cycles"; }
   QString description() const override { return "cycles"; }
   QVariant report(bool /*json*/) override {
-    return ProcessorHandler::getProcessor()->getCycleCount();
+    return ProcessorHandler::getProcessor()->getTotalCycleCount();
   }
 };
 
@@ -109,6 +130,64 @@ private:
   std::shared_ptr<PipelineDiagramModel> m_pipelineDiagramModel;
 };
 
+class ProfileTelemetry : public Telemetry {
+public:
+  ProfileTelemetry() {}
+  void enable() override {
+    // As the PipelineDiagramModel, the Profiler connects to the ProcessorHandler
+    // upon construction.
+    m_profiler = std::make_shared<Profiler>();
+    Telemetry::enable();
+  }
+
+  QString key() const override { return "profile"; }
+  QString description() const override {
+    return "per-instruction and per-function execution profile";
+  }
+  QVariant report(bool json) override {
+    return json ? m_profiler->toVariant() : m_profiler->toString();
+  }
+
+  /// The profiler of the enabled telemetry, or nullptr if not enabled.
+  Profiler *profiler() const { return m_profiler.get(); }
+
+private:
+  std::shared_ptr<Profiler> m_profiler;
+};
+
+class SyscallTelemetry : public Telemetry {
+public:
+  QString key() const override { return "syscalls"; }
+  QString prettyKey() const override { return "system calls"; }
+  QString description() const override {
+    return "system call counts and execution time";
+  }
+  QVariant report(bool json) override {
+    const auto &manager = ProcessorHandler::getSyscallManager();
+    QVariantMap syscallMap;
+    QString outStr;
+    QTextStream out(&outStr);
+    for (const auto &[id, statistics] : manager.statistics()) {
+      const QString &name = manager.getSyscalls().at(id)->name();
+      const double ms = statistics.nanoseconds / 1e6;
+      if (json) {
+        QVariantMap m;
+        m["id"] = id;
+        m["count"] = static_cast<qulonglong>(statistics.count);
+        m["time (ms)"] = ms;
+        syscallMap[name] = m;
+      } else {
+        out << name << " (" << id << "):\t" << statistics.count << " calls\t"
+            << QString::number(ms, 'f', 3) << " ms\n";
+      }
+    }
+    if (json)
+      return syscallMap;
+    out.flush();
+    return outStr;
+  }
+};
+
 class RegisterTelemetry : public Telemetry {
 public:
   QString key() const override { return "regs"; }
@@ -0,0 +1,167 @@
+#include "commitobserver.h"
+
+#include "processorhandler.h"
+#include "processors/RISC-V/rv_uncompress.h"
+#include "simulationcontext.h"
+
+#include <algorithm>
+
+namespace Ripes {
+
+namespace {
+// RISC-V major opcodes of the instructions which write rd.
+bool writesRd(uint32_t instr) {
+  switch (instr & 0x7F) {
+  case 0b0110111: // LUI
+  case 0b0010111: // AUIPC
+  case 0b1101111: // JAL
+  case 0b1100111: // JALR
+  case 0b0000011: // LOAD
+  case 0b0010011: // OP-IMM
+  case 0b0110011: // OP
+  case 0b0011011: // OP-IMM-32
+  case 0b0111011: // OP-32
+  case 0b0101111: // AMO
+    return true;
+  case 0b1110011: // SYSTEM; CSR instructions, but not ecall/ebreak
+    return ((instr >> 12) & 0b111) != 0;
+  default:
+    return false;
+  }
+}
+
+VInt signExtend12(uint32_t value) {
+  return static_cast<VInt>(static_cast<int64_t>(value << 20) >> 20);
+}
+
+// Formats @p value as a zero-padded hexadecimal value of @p bits, as does
+// Spike.
+QByteArray hex(uint64_t value, unsigned bits) {
+  return "0x" + QByteArray::number(static_cast<qulonglong>(value), 16)
+                    .rightJustified(bits / 4, '0');
+}
+} // namespace
+
+bool CommitRecord::operator==(const CommitRecord &other) const {
+  if (pc != other.pc || instr != other.instr || flags != other.flags)
+    return false;
+  if ((flags & RegWrite) && (rd != other.rd || rdValue != other.rdValue))
+    return false;
+  if ((flags & (MemRead | MemWrite)) &&
+      (memBytes != other.memBytes || memAddress != other.memAddress))
+    return false;
+  if ((flags & MemWrite) && memValue != other.memValue)
+    return false;
+  return true;
+}
+
+QByteArray CommitRecord::toSpike(unsigned xlen) const {
+  // Instructions are reported as executed in machine mode (3).
+  QByteArray text = "core   0: 3 " + hex(pc, xlen) + " (" +
+                    hex(instr, flags & Compressed ? 16 : 32) + ")";
+  if (flags & RegWrite)
+    text += " x" + QByteArray::number(rd).leftJustified(2, ' ') + " " +
+            hex(rdValue, xlen);
+  if (flags & (MemRead | MemWrite)) {
+    text += " mem " + hex(memAddress, xlen);
+    if (flags & MemWrite)
+      text += " " + hex(memValue, 8 * memBytes);
+  }
+  return text;
+}
+
+CommitObserver::CommitObserver(Callback callback)
+    : m_callback(std::move(callback)),
+      m_context(SimulationContext::current()) {
+  const auto *isa = ProcessorHandler::currentISA();
+  m_xlen = isa->bits();
+  m_compressed = isa->extensionEnabled("C");
+  m_regs.assign(32, 0);
+  m_regCnt = std::min(isa->regCnt(), 32u);
+  m_tracker.reset();
+  snapshot();
+
+  m_cycleObserverID =
+      ProcessorHandler::addCycleObserver([=] { processorWasClocked(); });
+}
+
+CommitObserver::~CommitObserver() {
+  SimulationContext::Scope scope(m_context);
+  ProcessorHandler::removeCycleObserver(m_cycleObserverID);
+}
+
+void CommitObserver::snapshot() {
+  const auto *processor = ProcessorHandler::getProcessor();
+  const auto &stages = m_tracker.stages();
+  m_writeValues.assign(stages.size(), std::nullopt);
+  for (unsigned s = 0; s < stages.size(); ++s)
+    if (m_tracker.isLastStage(s) && m_tracker.occupants()[s] != -1)
+      m_writeValues[s] = processor->registerWriteValue(stages[s]);
+
+  for (unsigned i = 0; i < m_regCnt; ++i)
+    m_regs[i] = processor->getRegister(RegisterFileType::GPR, i);
+}
+
+void CommitObserver::processorWasClocked() {
+  // Cycles which are reversed are not observed.
+  if (m_tracker.update()) {
+    // Instructions which retire in the same cycle do so in program order.
+    for (const auto &instr : m_tracker.retired())
+      m_callback(decode(instr));
+  }
+  snapshot();
+}
+
+CommitRecord
+CommitObserver::decode(const PipelineTracker::Instruction &retired) {
+  CommitRecord record;
+  record.pc = retired.pc;
+  record.instr = ProcessorHandler::getMemory().readMemConst(retired.pc, 4);
+  uint32_t instr = record.instr;
+  if ((instr & 0b11) != 0b11) {
+    record.flags |= CommitRecord::Compressed;
+    record.instr &= 0xFFFF;
+    instr = m_compressed ? vsrtl::core::RVCExpansionTable::get(
+                               ProcessorHandler::currentISA()->isaID())
+                               .expand(record.instr)
+                         : 0;
+  }
+
+  const VInt xlenMask = m_xlen == 64 ? ~VInt(0) : (VInt(1) << m_xlen) - 1;
+  const unsigned rd = (instr >> 7) & 0x1F;
+  const unsigned funct3 = (instr >> 12) & 0b111;
+  const VInt rs1 = m_regs[(instr >> 15) & 0x1F];
+  const VInt rs2 = m_regs[(instr >> 20) & 0x1F];
+
+  if (writesRd(instr) && rd != 0) {
+    record.flags |= CommitRecord::RegWrite;
+    record.rd = rd;
+    const auto &value = m_writeValues[retired.stage];
+    record.rdValue = (value ? *value
+                            : ProcessorHandler::getProcessor()->getRegister(
+                                  RegisterFileType::GPR, rd)) &
+                     xlenMask;
+  }
+
+  const unsigned memBytes = 1 << (funct3 & 0b11);
+  if ((instr & 0x7F) == 0b0000011) { // LOAD
+    record.flags |= CommitRecord::MemRead;
+    record.memBytes = memBytes;
+    record.memAddress = (rs1 + signExtend12(instr >> 20)) & xlenMask;
+  } else if ((instr & 0x7F) == 0b0100011) { // STORE
+    record.flags |= CommitRecord::MemWrite;
+    record.memBytes = memBytes;
+    record.memAddress =
+        (rs1 + signExtend12(((instr >> 25) << 5) | ((instr >> 7) & 0x1F))) &
+        xlenMask;
+    record.memValue =
+        memBytes == 8 ? rs2 : rs2 & ((VInt(1) << (8 * memBytes)) - 1);
+  }
+
+  // Younger instructions which retire in the same cycle observe the write.
+  if (record.flags & CommitRecord::RegWrite)
+    m_regs[record.rd] = record.rdValue;
+  return record;
+}
+
+} // namespace Ripes
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <QByteArray>
+
+#include "pipelinetracker.h"
+
+#include <functional>
+#include <optional>
+#include <vector>
+
+namespace Ripes {
+
+class SimulationContext;
+
+/**
+ * @brief The CommitRecord struct
+ * The architectural effects of a retired instruction: its PC, its instruction
+ * word, its write to a general purpose register and its data memory access.
+ */
+struct CommitRecord {
+  enum Flags : uint8_t {
+    RegWrite = 0b1,
+    MemRead = 0b10,
+    MemWrite = 0b100,
+    Compressed = 0b1000
+  };
+
+  AInt pc = 0;
+  // The instruction word as fetched; the lower 16 bits if Compressed.
+  uint32_t instr = 0;
+  uint8_t flags = 0;
+  uint8_t rd = 0;
+  uint8_t memBytes = 0;
+  VInt rdValue = 0;
+  AInt memAddress = 0;
+  // Stored value, for MemWrite.
+  VInt memValue = 0;
+
+  bool operator==(const CommitRecord &other) const;
+  bool operator!=(const CommitRecord &other) const { return !(*this == other); }
+
+  /// Renders the record as a line (without a line break) of the commit log of
+  /// the Spike RISC-V ISA simulator, for a register width of @p xlen.
+  QByteArray toSpike(unsigned xlen) const;
+};
+
+/**
+ * @brief The CommitObserver class
+ * Observes the instructions retired by the processor of the simulation context
+ * which is current upon construction, and reports a CommitRecord for each, in
+ * program order.
+ *
+ * The processor interface does not expose retirement events. Instead, the
+ * instructions within the pipeline are followed by a PipelineTracker, which
+ * reports the instructions retired in each cycle ordered by age. Register
+ * writes and memory accesses are derived from the instruction word, given the
+ * register values prior to the cycle in which the instruction retired, updated
+ * by the register writes of any older instruction which retired in the same
+ * cycle.
+ */
+class CommitObserver {
+public:
+  using Callback = std::function<void(const CommitRecord &)>;
+
+  /// Starts observing from the current cycle of the processor. @p callback is
+  /// called in the thread of the processor.
+  explicit CommitObserver(Callback callback);
+  ~CommitObserver();
+  CommitObserver(const CommitObserver &) = delete;
+  CommitObserver &operator=(const CommitObserver &) = delete;
+
+  /// Register width of the observed processor, in bits.
+  unsigned xlen() const { return m_xlen; }
+
+private:
+  void processorWasClocked();
+  /// Records the registers and the register write values of the last stages
+  /// in the current cycle, being the state prior to the next cycle.
+  void snapshot();
+  /// Decodes @p retired, and applies its register write to m_regs.
+  CommitRecord decode(const PipelineTracker::Instruction &retired);
+
+  Callback m_callback;
+  PipelineTracker m_tracker;
+  // Values written by the instructions which occupied each last stage in the
+  // previous cycle, as reported by the processor.
+  std::vector<std::optional<VInt>> m_writeValues;
+  // General purpose registers prior to the current cycle, of which m_regCnt
+  // are implemented.
+  std::vector<VInt> m_regs;
+  unsigned m_regCnt = 0;
+  unsigned m_xlen = 32;
+  bool m_compressed = false;
+
+  unsigned m_cycleObserverID;
+  // The simulation context of the processor which is observed.
+  SimulationContext &m_context;
+};
+
+} // namespace Ripes
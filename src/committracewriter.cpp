@@ -0,0 +1,143 @@
+#include "committracewriter.h"
+
+#include "processorhandler.h"
+
+namespace Ripes {
+
+// Records are submitted to the writer thread in chunks of this size.
+static constexpr int s_chunkSize = 1 << 18;
+// Maximum number of chunks queued for the writer thread.
+static constexpr size_t s_maxQueuedChunks = 8;
+
+static constexpr char s_magic[] = "RIPESCMT";
+static constexpr uint8_t s_version = 1;
+
+namespace {
+void appendLE(QByteArray &out, uint64_t value, unsigned bytes) {
+  for (unsigned i = 0; i < bytes; ++i)
+    out.append(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+uint64_t readLE(const char *&data, unsigned bytes) {
+  uint64_t value = 0;
+  for (unsigned i = 0; i < bytes; ++i)
+    value |= static_cast<uint64_t>(static_cast<uint8_t>(*data++)) << (8 * i);
+  return value;
+}
+} // namespace
+
+CommitTraceWriter::CommitTraceWriter() {}
+
+CommitTraceWriter::~CommitTraceWriter() { close(); }
+
+QString CommitTraceWriter::open(const QString &path, Format format) {
+  close();
+  m_file.setFileName(path);
+  if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    return "Failed to open commit trace '" + path + "'";
+  m_format = format;
+
+  m_xlen = ProcessorHandler::currentISA()->bits();
+  m_records = 0;
+  m_chunk.clear();
+  if (m_format == Format::Binary) {
+    m_chunk.append(s_magic, sizeof(s_magic) - 1);
+    m_chunk.append(static_cast<char>(s_version));
+    m_chunk.append(static_cast<char>(m_xlen));
+  }
+
+  m_closing = false;
+  m_writer = std::thread(&CommitTraceWriter::writerLoop, this);
+  m_observer = std::make_unique<CommitObserver>(
+      [this](const CommitRecord &commit) { record(commit); });
+  return QString();
+}
+
+void CommitTraceWriter::close() {
+  m_observer.reset();
+  if (m_writer.joinable()) {
+    submitChunk();
+    {
+      std::unique_lock lock(m_queueLock);
+      m_closing = true;
+    }
+    m_queueCond.notify_all();
+    m_writer.join();
+  }
+  if (m_file.isOpen())
+    m_file.close();
+}
+
+void CommitTraceWriter::record(const CommitRecord &record) {
+  m_chunk.append(static_cast<char>(record.flags));
+  appendLE(m_chunk, record.pc, 8);
+  appendLE(m_chunk, record.instr, 4);
+  if (record.flags & CommitRecord::RegWrite) {
+    m_chunk.append(static_cast<char>(record.rd));
+    appendLE(m_chunk, record.rdValue, 8);
+  }
+  if (record.flags & (CommitRecord::MemRead | CommitRecord::MemWrite)) {
+    m_chunk.append(static_cast<char>(record.memBytes));
+    appendLE(m_chunk, record.memAddress, 8);
+    if (record.flags & CommitRecord::MemWrite)
+      appendLE(m_chunk, record.memValue, 8);
+  }
+  m_records++;
+
+  if (m_chunk.size() >= s_chunkSize)
+    submitChunk();
+}
+
+void CommitTraceWriter::submitChunk() {
+  if (m_chunk.isEmpty())
+    return;
+  std::unique_lock lock(m_queueLock);
+  m_queueCond.wait(lock, [&] { return m_queue.size() < s_maxQueuedChunks; });
+  m_queue.push_back(std::move(m_chunk));
+  m_chunk = QByteArray();
+  m_chunk.reserve(s_chunkSize + 64);
+  lock.unlock();
+  m_queueCond.notify_all();
+}
+
+void CommitTraceWriter::writerLoop() {
+  while (true) {
+    QByteArray chunk;
+    {
+      std::unique_lock lock(m_queueLock);
+      m_queueCond.wait(lock, [&] { return m_closing || !m_queue.empty(); });
+      if (m_queue.empty())
+        return;
+      chunk = std::move(m_queue.front());
+      m_queue.pop_front();
+    }
+    m_queueCond.notify_all();
+    m_file.write(m_format == Format::Spike ? renderSpike(chunk) : chunk);
+  }
+}
+
+QByteArray CommitTraceWriter::renderSpike(const QByteArray &chunk) const {
+  QByteArray text;
+  const char *data = chunk.constData();
+  const char *end = data + chunk.size();
+  while (data < end) {
+    CommitRecord record;
+    record.flags = readLE(data, 1);
+    record.pc = readLE(data, 8);
+    record.instr = readLE(data, 4);
+    if (record.flags & CommitRecord::RegWrite) {
+      record.rd = readLE(data, 1);
+      record.rdValue = readLE(data, 8);
+    }
+    if (record.flags & (CommitRecord::MemRead | CommitRecord::MemWrite)) {
+      record.memBytes = readLE(data, 1);
+      record.memAddress = readLE(data, 8);
+      if (record.flags & CommitRecord::MemWrite)
+        record.memValue = readLE(data, 8);
+    }
+    text += record.toSpike(m_xlen) + '\n';
+  }
+  return text;
+}
+
+} // namespace Ripes
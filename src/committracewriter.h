@@ -0,0 +1,80 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+
+#include "commitobserver.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace Ripes {
+
+/**
+ * @brief The CommitTraceWriter class
+ * Writes a record of each instruction retired by the processor of the current
+ * simulation context (see CommitObserver) to a trace.
+ *
+ * Records are encoded in the thread of the processor, and written to the trace
+ * by a writer thread, in chunks. The trace is either binary, as described
+ * below, or a text rendering in the format of the commit log of the Spike
+ * RISC-V ISA simulator (--log-commits).
+ *
+ * The binary trace starts with the 8-byte magic "RIPESCMT", followed by a
+ * version byte (1) and the register width in bits (a byte). Each record then
+ * consists of a flags byte (see CommitRecord::Flags), the 8-byte PC and the
+ * 4-byte instruction word, optionally followed by the destination register
+ * index (a byte) and its 8-byte value (RegWrite), and the access size in bytes
+ * (a byte), the 8-byte address and, for stores, the 8-byte stored value
+ * (MemRead/MemWrite). All values are little-endian.
+ */
+class CommitTraceWriter {
+public:
+  enum class Format { Binary, Spike };
+
+  CommitTraceWriter();
+  ~CommitTraceWriter();
+
+  /**
+   * @brief open
+   * Opens the trace at @p path and starts tracing the instructions retired
+   * from the current cycle of the processor. Returns an error message on
+   * failure.
+   */
+  QString open(const QString &path, Format format);
+
+  /// Writes any pending records and closes the trace.
+  void close();
+
+  /// Returns the number of records written to the trace.
+  uint64_t records() const { return m_records; }
+
+private:
+  void record(const CommitRecord &record);
+  void submitChunk();
+  void writerLoop();
+  QByteArray renderSpike(const QByteArray &chunk) const;
+
+  std::unique_ptr<CommitObserver> m_observer;
+  unsigned m_xlen = 32;
+  uint64_t m_records = 0;
+
+  // Records which have not yet been submitted to the writer thread.
+  QByteArray m_chunk;
+
+  QFile m_file;
+  Format m_format = Format::Binary;
+  std::thread m_writer;
+  std::mutex m_queueLock;
+  std::condition_variable m_queueCond;
+  // Chunks submitted to the writer thread. Bounded, such that a simulation
+  // which outpaces the writer is throttled rather than buffering without
+  // limit.
+  std::deque<QByteArray> m_queue;
+  bool m_closing = false;
+};
+
+} // namespace Ripes
@@ -26,7 +26,23 @@ ConsoleWidget::ConsoleWidget(QWidget *parent)
 
   // Print output data from SystemIO in the console.
   connect(&SystemIO::get(), &SystemIO::doPrint, m_ui->console,
-          [&](auto text) { m_ui->console->putData(text.toUtf8()); });
+          [&](const QByteArray &bytes) { m_ui->console->putData(bytes); });
+
+  // Output of the simulation thread is buffered by SystemIO, and flushed to
+  // the console at the UI update rate.
+  SystemIO::get().enableOutputBuffer(thread());
+  m_outputFlushTimer = new QTimer(this);
+  m_outputFlushTimer->setInterval(
+      1000.0 / RipesSettings::value(RIPES_SETTING_UIUPDATEPS).toInt());
+  connect(m_outputFlushTimer, &QTimer::timeout, this,
+          [sio = &SystemIO::get()] { sio->flushOutput(); });
+  connect(RipesSettings::getObserver(RIPES_SETTING_UIUPDATEPS),
+          &SettingObserver::modified, m_outputFlushTimer, [=] {
+            m_outputFlushTimer->setInterval(
+                1000.0 /
+                RipesSettings::value(RIPES_SETTING_UIUPDATEPS).toInt());
+          });
+  m_outputFlushTimer->start();
 }
 
 ConsoleWidget::~ConsoleWidget() { delete m_ui; }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QTimer>
 #include <QWidget>
 
 namespace Ripes {
@@ -20,6 +21,7 @@ public:
 
 private:
   Ui::ConsoleWidget *m_ui;
+  QTimer *m_outputFlushTimer = nullptr;
 };
 
 } // namespace Ripes
@@ -1,7 +1,7 @@
 #include "iomanager.h"
 
 #include "processorhandler.h"
-#include "ripessettings.h"
+#include "simulationcontext.h"
 
 #include <memory>
 #include <ostream>
@@ -10,7 +10,11 @@
 
 namespace Ripes {
 
-IOManager::IOManager() : QObject(nullptr) {
+IOManager &IOManager::get() { return SimulationContext::current().ioManager(); }
+
+IOManager::IOManager(bool exportSymbolsHeader, AInt peripheralsStart)
+    : QObject(nullptr), m_exportSymbolsHeader(exportSymbolsHeader),
+      m_peripheralsStart(peripheralsStart) {
   // Always re-register the currently active peripherals when the processor
   // changes
   connect(ProcessorHandler::get(), &ProcessorHandler::processorChanged, this,
@@ -39,8 +43,7 @@ void IOManager::reset() {
 AInt IOManager::nextPeripheralAddress() const {
   AInt base = 0;
   if (m_periphMMappings.empty()) {
-    base = static_cast<unsigned>(
-        RipesSettings::value(RIPES_SETTING_PERIPHERALS_START).toInt());
+    base = m_peripheralsStart;
   } else {
     for (const auto &periph : m_periphMMappings) {
       if (periph.second.end() > base) {
@@ -219,6 +222,11 @@ void IOManager::updateSymbols() {
   }
   headerfile << "#endif // RIPES_IO_HEADER";
 
+  // The header file is shared by all contexts, and only exported for the
+  // application context.
+  if (!m_exportSymbolsHeader)
+    return;
+
   // Store header file at a temporary location
   if (!(m_symbolsHeaderFile &&
         (QFile::exists(m_symbolsHeaderFile->fileName())))) {
@@ -29,19 +29,27 @@ struct MemoryMapEntry {
 
 using MemoryMap = std::map<AInt, MemoryMapEntry>;
 
+/**
+ * @brief The IOManager class
+ * Manages the memory-mapped peripherals of a simulation. Each
+ * SimulationContext owns an IOManager.
+ */
 class IOManager : public QObject {
   Q_OBJECT
 
 public:
-  static IOManager &get() {
-    static IOManager manager;
-    return manager;
-  }
+  /// Returns the IOManager of the current simulation context.
+  static IOManager &get();
 
   IOBase *createPeripheral(IOType type, unsigned forcedId = UINT_MAX);
   void removePeripheral(IOBase *peripheral, std::atomic<bool> &ok);
   const MemoryMap &memoryMap() const { return m_memoryMap; }
 
+  /// Returns the memory mapping of each of the instantiated peripherals.
+  const std::map<IOBase *, MemoryMapEntry> &peripheralMappings() const {
+    return m_periphMMappings;
+  }
+
   /**
    * @brief cSymbolsHeaderpath
    * @returns the path of a header file of #define's containing the current
@@ -60,6 +68,13 @@ public:
   std::vector<std::pair<Symbol, AInt>>
   assemblerSymbolsForPeriph(IOBase *peripheral) const;
 
+  /**
+   * @brief setPeripheralsStart
+   * Sets the base address of the first peripheral, which takes effect on the
+   * next assignment of base addresses.
+   */
+  void setPeripheralsStart(AInt address) { m_peripheralsStart = address; }
+
   /**
    * @brief reset
    * Call to reset all IO devices.
@@ -71,7 +86,11 @@ signals:
   void peripheralRemoved(QObject *peripheral);
 
 private:
-  IOManager();
+  /// If @p exportSymbolsHeader is set, the peripheral symbols are written to a
+  /// header file; see cSymbolsHeaderpath(). Peripherals are mapped from
+  /// @p peripheralsStart and upwards.
+  IOManager(bool exportSymbolsHeader, AInt peripheralsStart);
+  friend class SimulationContext;
 
   /**
    * @brief updateSymbols
@@ -114,6 +133,8 @@ private:
   std::set<IOBase *> m_peripherals;
   Assembler::SymbolMap m_assemblerSymbols;
   std::unique_ptr<QFile> m_symbolsHeaderFile;
+  const bool m_exportSymbolsHeader;
+  AInt m_peripheralsStart;
 };
 
 } // namespace Ripes
@@ -2,6 +2,7 @@
 #include "ui_mainwindow.h"
 
 #include "cachetab.h"
+#include "checkpoint.h"
 #include "edittab.h"
 #include "iotab.h"
 #include "loaddialog.h"
@@ -210,6 +211,12 @@ void MainWindow::setupMenus() {
   auto *examplesMenu = m_ui->menuFile->addMenu("Load Example...");
   setupExamplesMenu(examplesMenu);
 
+  auto *restoreCheckpointAction =
+      new QAction(loadIcon, "Restore Checkpoint...", this);
+  connect(restoreCheckpointAction, &QAction::triggered, this,
+          &MainWindow::restoreCheckpointTriggered);
+  m_ui->menuFile->addAction(restoreCheckpointAction);
+
   m_ui->menuFile->addSeparator();
 
   const QIcon saveIcon = QIcon(":/icons/save.svg");
@@ -438,6 +445,31 @@ void MainWindow::saveFilesTriggered() {
                                        1000);
 }
 
+void MainWindow::restoreCheckpointTriggered() {
+  static_cast<ProcessorTab *>(m_tabWidgets.at(ProcessorTabID).tab)->pause();
+  const QString path =
+      QFileDialog::getOpenFileName(this, "Restore checkpoint", "",
+                                   "Checkpoint files (*.ckpt);;All files (*)");
+  if (path.isEmpty())
+    return;
+
+  Checkpoint checkpoint;
+  QString err = Checkpoint::load(path, checkpoint);
+  if (err.isEmpty()) {
+    // Checkpoints are restored on top of the reset state of the program.
+    RipesSettings::getObserver(RIPES_GLOBALSIGNAL_REQRESET)->trigger();
+    err = ProcessorHandler::restoreCheckpoint(checkpoint);
+  }
+  if (!err.isEmpty()) {
+    QMessageBox::warning(this, "Error", "Could not restore checkpoint: " + err);
+    return;
+  }
+  GeneralStatusManager::setStatusTimed(
+      "Restored checkpoint taken after " +
+          QString::number(checkpoint.instructions) + " instructions",
+      1000);
+}
+
 void MainWindow::saveFilesAsTriggered() {
   SaveDialog diag(
       static_cast<EditTab *>(m_tabWidgets.at(EditTabID).tab)->getSourceType());
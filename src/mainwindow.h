@@ -55,6 +55,7 @@ private slots:
   void version();
 
   void loadFileTriggered();
+  void restoreCheckpointTriggered();
 
   void saveFilesTriggered();
   void saveFilesAsTriggered();
@@ -2,8 +2,9 @@
 
 #include "processorhandler.h"
 #include "ripessettings.h"
+#include "simulationcontext.h"
 
-#include <vector>
+#include <algorithm>
 
 namespace Ripes {
 
@@ -16,11 +17,17 @@ static AInt indexToAddress(unsigned index) {
 }
 
 PipelineDiagramModel::PipelineDiagramModel(QObject *parent)
-    : QAbstractTableModel(parent) {
-  connect(ProcessorHandler::get(), &ProcessorHandler::processorClocked, this,
-          &PipelineDiagramModel::processorWasClocked, Qt::DirectConnection);
+    : QAbstractTableModel(parent), m_context(SimulationContext::current()) {
+  m_cycleObserverID =
+      ProcessorHandler::addCycleObserver([=] { processorWasClocked(); });
   connect(ProcessorHandler::get(), &ProcessorHandler::processorReset, this,
           &PipelineDiagramModel::reset);
+  reset();
+}
+
+PipelineDiagramModel::~PipelineDiagramModel() {
+  SimulationContext::Scope scope(m_context);
+  ProcessorHandler::removeCycleObserver(m_cycleObserverID);
 }
 
 QVariant PipelineDiagramModel::headerData(int section,
@@ -43,7 +50,7 @@ int PipelineDiagramModel::rowCount(const QModelIndex &) const {
 }
 
 int PipelineDiagramModel::columnCount(const QModelIndex &) const {
-  return m_cycleStageInfos.size();
+  return m_cycles;
 }
 
 void PipelineDiagramModel::processorWasClocked() {
@@ -53,15 +60,31 @@ void PipelineDiagramModel::processorWasClocked() {
   gatherStageInfo();
 
   const auto cycleCount = ProcessorHandler::getProcessor()->getCycleCount();
-  if (cycleCount >=
-      RipesSettings::value(RIPES_SETTING_PIPEDIAGRAM_MAXCYCLES).toInt()) {
+  if (cycleCount >= m_maxCycles) {
     m_atMaxCycles = true;
   }
 }
 
 void PipelineDiagramModel::reset() {
   m_atMaxCycles = false;
-  m_cycleStageInfos.clear();
+  m_maxCycles =
+      RipesSettings::value(RIPES_SETTING_PIPEDIAGRAM_MAXCYCLES).toLongLong();
+
+  m_stages.clear();
+  for (auto idx : ProcessorHandler::getProcessor()->structure().stageIt())
+    m_stages.push_back(idx);
+  m_stageColumns.clear();
+  m_stageColumns.resize(m_stages.size());
+  m_cycles = 0;
+
+  m_namedStates = {QString()};
+  m_namedStateIDs.clear();
+
+  m_instrBytes = ProcessorHandler::currentISA()->instrBytes();
+  m_textAddress = indexToAddress(0);
+  m_instrCycles.clear();
+  m_instrCycles.resize(rowCount());
+
   gatherStageInfo();
 }
 
@@ -70,17 +93,58 @@ void PipelineDiagramModel::prepareForView() {
   endResetModel();
 }
 
+uint16_t PipelineDiagramModel::namedStateID(const QString &namedState) {
+  if (namedState.isEmpty())
+    return 0;
+  auto it = m_namedStateIDs.find(namedState);
+  if (it != m_namedStateIDs.end())
+    return it.value();
+  Q_ASSERT(m_namedStates.size() <= UINT16_MAX && "Too many named states");
+  const uint16_t id = m_namedStates.size();
+  m_namedStates.push_back(namedState);
+  m_namedStateIDs[namedState] = id;
+  return id;
+}
+
 void PipelineDiagramModel::gatherStageInfo() {
-  long long cycleCount = ProcessorHandler::getProcessor()->getCycleCount();
-  auto stageInfoForCycle = m_cycleStageInfos.find(cycleCount);
-  if (stageInfoForCycle != m_cycleStageInfos.end()) {
+  auto *processor = ProcessorHandler::getProcessor();
+  const long long cycleCount = processor->getCycleCount();
+  if (cycleCount < m_cycles) {
     // Already gathered stage info for this cycle.
     return;
   }
-  m_cycleStageInfos[cycleCount];
-  for (auto idx : ProcessorHandler::getProcessor()->structure().stageIt())
-    m_cycleStageInfos[cycleCount][idx] =
-        ProcessorHandler::getProcessor()->stageInfo(idx);
+  if (cycleCount > m_maxCycles) {
+    m_atMaxCycles = true;
+    return;
+  }
+
+  // Any cycles which were not observed are recorded as empty, such that cycle
+  // i remains at index i of the columns.
+  for (; m_cycles <= cycleCount; ++m_cycles) {
+    const bool observed = m_cycles == cycleCount;
+    for (unsigned s = 0; s < m_stages.size(); ++s) {
+      const StageInfo info =
+          observed ? processor->stageInfo(m_stages[s]) : StageInfo();
+      auto &column = m_stageColumns[s];
+      column.pc.push_back(info.pc);
+      column.valid.push_back(info.stage_valid);
+      column.state.push_back(info.state);
+      column.namedState.push_back(namedStateID(info.namedState));
+
+      if (!info.stage_valid || info.state != StageInfo::State::None ||
+          info.pc < m_textAddress)
+        continue;
+      const AInt offset = info.pc - m_textAddress;
+      if (offset % m_instrBytes != 0)
+        continue;
+      const AInt row = offset / m_instrBytes;
+      if (row >= m_instrCycles.size())
+        continue;
+      auto &cycles = m_instrCycles[row];
+      if (cycles.empty() || cycles.back() != m_cycles)
+        cycles.push_back(static_cast<uint32_t>(m_cycles));
+    }
+  }
 }
 
 QVariant PipelineDiagramModel::data(const QModelIndex &index, int role) const {
@@ -94,36 +158,33 @@ QVariant PipelineDiagramModel::data(const QModelIndex &index, int role) const {
   if (role != Qt::DisplayRole)
     return QVariant();
 
-  if (!m_cycleStageInfos.count(index.column()))
+  const unsigned row = index.row();
+  const long long cycle = index.column();
+  if (cycle >= m_cycles || row >= m_instrCycles.size())
     return QVariant();
 
-  const AInt addr = indexToAddress(index.row());
-  const auto &stageInfo = m_cycleStageInfos.at(index.column());
+  const auto &instrCycles = m_instrCycles.at(row);
+  if (!std::binary_search(instrCycles.begin(), instrCycles.end(), cycle))
+    return QVariant();
 
+  const AInt addr = m_textAddress + row * m_instrBytes;
   QStringList stagesForAddr;
   QString stageStr;
-  for (const auto &si : stageInfo) {
-    if (si.second.pc == addr && si.second.stage_valid &&
-        si.second.state == StageInfo::State::None) {
-      if (m_cycleStageInfos.count(index.column() - 1)) {
-        const auto &prevCycleStageInfo =
-            m_cycleStageInfos.at(index.column() - 1);
-        if (prevCycleStageInfo.at(si.first).stage_valid &&
-            prevCycleStageInfo.at(si.first).pc == si.second.pc) {
-          stageStr = "-";
-          if (!si.second.namedState.isEmpty()) {
-            stageStr += " (" + si.second.namedState + ")";
-          }
-          stagesForAddr << stageStr;
-          continue;
-        }
-      }
-      stageStr = ProcessorHandler::getProcessor()->stageName(si.first);
-      if (!si.second.namedState.isEmpty()) {
-        stageStr += " (" + si.second.namedState + ")";
-      }
-      stagesForAddr << stageStr;
+  for (unsigned s = 0; s < m_stages.size(); ++s) {
+    const auto &column = m_stageColumns.at(s);
+    if (column.pc[cycle] != addr || !column.valid[cycle] ||
+        column.state[cycle] != StageInfo::State::None)
+      continue;
+
+    if (cycle > 0 && column.valid[cycle - 1] && column.pc[cycle - 1] == addr)
+      stageStr = "-";
+    else
+      stageStr = ProcessorHandler::getProcessor()->stageName(m_stages.at(s));
+    const QString &namedState = m_namedStates.at(column.namedState[cycle]);
+    if (!namedState.isEmpty()) {
+      stageStr += " (" + namedState + ")";
     }
+    stagesForAddr << stageStr;
   }
 
   if (stagesForAddr.size() == 0) {
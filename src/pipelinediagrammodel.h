@@ -2,14 +2,20 @@
 
 #include "processors/interface/ripesprocessor.h"
 #include <QAbstractTableModel>
+#include <QHash>
+
+#include <vector>
 
 namespace Ripes {
 
+class SimulationContext;
+
 class PipelineDiagramModel : public QAbstractTableModel {
   Q_OBJECT
 public:
   enum Column { Breakpoint = 0, PC = 1, Stage = 2, Instruction = 3, NColumns };
   PipelineDiagramModel(QObject *parent = nullptr);
+  ~PipelineDiagramModel() override;
 
   int rowCount(const QModelIndex &parent = QModelIndex()) const override;
   int columnCount(const QModelIndex &parent = QModelIndex()) const override;
@@ -30,11 +36,44 @@ public slots:
 private:
   void gatherStageInfo();
 
+  /// Returns the ID of @p namedState, interning it if not yet seen.
+  uint16_t namedStateID(const QString &namedState);
+
   /**
-   * @brief m_cycleStageInfos
-   * map<cycle, map<stageId, stageInfo>>
+   * @brief The StageColumn struct
+   * The recorded state of a single stage, stored column-wise with one entry
+   * per cycle. Named states are stored as IDs into m_namedStates.
    */
-  std::map<long long, std::map<StageIndex, StageInfo>> m_cycleStageInfos;
+  struct StageColumn {
+    std::vector<AInt> pc;
+    std::vector<bool> valid;
+    std::vector<StageInfo::State> state;
+    std::vector<uint16_t> namedState;
+  };
+
+  // Stages of the processor, in the order in which they are displayed. Indexes
+  // the stage columns.
+  std::vector<StageIndex> m_stages;
+  std::vector<StageColumn> m_stageColumns;
+  // Number of recorded cycles; cycle i is stored at index i of each column.
+  long long m_cycles = 0;
+
+  // Interned named states. ID 0 is the empty named state.
+  std::vector<QString> m_namedStates;
+  QHash<QString, uint16_t> m_namedStateIDs;
+
+  /**
+   * @brief m_instrCycles
+   * For each instruction (row) of the program, the ascending cycles during
+   * which the instruction occupied any stage. This allows for the cells which
+   * the diagram is mostly made up of, being empty, to be resolved without
+   * scanning the stages of a cycle.
+   */
+  std::vector<std::vector<uint32_t>> m_instrCycles;
+  // Address of the first instruction, and size of each instruction, of the
+  // program at the time of the last reset.
+  AInt m_textAddress = 0;
+  unsigned m_instrBytes = 1;
 
   /**
    * @brief m_atMaxCycles
@@ -44,5 +83,12 @@ private:
    * the value has been reached.
    */
   bool m_atMaxCycles = false;
+  // Value of RIPES_SETTING_PIPEDIAGRAM_MAXCYCLES at the time of the last reset.
+  long long m_maxCycles = 0;
+
+  // ID of this model as a ProcessorHandler cycle observer.
+  unsigned m_cycleObserverID;
+  // The simulation context of the processor which the model observes.
+  SimulationContext &m_context;
 };
 } // namespace Ripes
@@ -0,0 +1,189 @@
+#include "pipelinetracewriter.h"
+
+#include "processorhandler.h"
+#include "simulationcontext.h"
+
+#include <array>
+
+namespace Ripes {
+
+// Trace data is buffered, and compressed, in chunks of this size.
+static constexpr int s_chunkSize = 1 << 20;
+
+static uint32_t crc32(const QByteArray &data) {
+  static const auto table = [] {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < table.size(); ++i) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; ++bit)
+        crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+      table[i] = crc;
+    }
+    return table;
+  }();
+
+  uint32_t crc = 0xFFFFFFFFu;
+  for (const char byte : data)
+    crc = table[(crc ^ static_cast<uint8_t>(byte)) & 0xFF] ^ (crc >> 8);
+  return crc ^ 0xFFFFFFFFu;
+}
+
+static void appendLE32(QByteArray &out, uint32_t value) {
+  for (int i = 0; i < 4; ++i)
+    out.append(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+/// Compresses @p data into a gzip member. A gzip file may consist of any
+/// number of members, so each chunk of the trace is written as a member of its
+/// own. qCompress produces a zlib stream, prefixed by the uncompressed size;
+/// the deflate data within it is rewrapped with a gzip header and trailer.
+static QByteArray gzipMember(const QByteArray &data) {
+  const QByteArray zlib = qCompress(data);
+  // 4-byte size prefix, 2-byte zlib header, deflate data, 4-byte Adler-32.
+  constexpr int prefixBytes = 6;
+  constexpr int suffixBytes = 4;
+
+  QByteArray member;
+  member.reserve(zlib.size() + 12);
+  // Magic, deflate method, no flags, no modification time, unknown OS.
+  static const char header[] = {'\x1f', '\x8b', '\x08', '\x00', '\x00',
+                                '\x00', '\x00', '\x00', '\x00', '\xff'};
+  member.append(header, sizeof(header));
+  member.append(zlib.constData() + prefixBytes,
+                zlib.size() - prefixBytes - suffixBytes);
+  appendLE32(member, crc32(data));
+  appendLE32(member, static_cast<uint32_t>(data.size()));
+  return member;
+}
+
+PipelineTraceWriter::PipelineTraceWriter()
+    : m_context(SimulationContext::current()) {}
+
+PipelineTraceWriter::~PipelineTraceWriter() { close(); }
+
+QString PipelineTraceWriter::open(const QString &path) {
+  close();
+  m_file.setFileName(path);
+  if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    return "Failed to open pipeline trace '" + path + "'";
+  m_compress = path.endsWith(".gz");
+
+  auto *processor = ProcessorHandler::getProcessor();
+  m_tracker.reset();
+  m_stageNames.clear();
+  for (const auto &stage : m_tracker.stages())
+    m_stageNames.push_back(processor->stageName(stage).toUtf8());
+  m_stalled.clear();
+  m_labels.clear();
+  m_nextRetireID = 0;
+
+  const long long cycle = processor->getCycleCount();
+  m_buffer = "Kanata\t0004\nC=\t" + QByteArray::number(cycle) + "\n";
+  m_markedCycle = cycle;
+  m_cycleMarked = true;
+  traceCycle();
+
+  m_cycleObserverID =
+      ProcessorHandler::addCycleObserver([=] { processorWasClocked(); });
+  m_attached = true;
+  return QString();
+}
+
+void PipelineTraceWriter::close() {
+  if (m_attached) {
+    SimulationContext::Scope scope(m_context);
+    ProcessorHandler::removeCycleObserver(m_cycleObserverID);
+    m_attached = false;
+  }
+  if (m_file.isOpen()) {
+    writeBuffer();
+    m_file.close();
+  }
+}
+
+void PipelineTraceWriter::processorWasClocked() {
+  // Cycles which were already traced (i.e., after reversing the processor) are
+  // not traced again.
+  if (!m_tracker.update())
+    return;
+  m_cycleMarked = false;
+  traceCycle();
+  if (m_buffer.size() >= s_chunkSize)
+    writeBuffer();
+}
+
+void PipelineTraceWriter::beginCycle(long long cycle) {
+  // Cycle markers are only written for cycles which change the trace.
+  if (m_cycleMarked)
+    return;
+  m_buffer += "C\t" + QByteArray::number(cycle - m_markedCycle) + "\n";
+  m_markedCycle = cycle;
+  m_cycleMarked = true;
+}
+
+const QByteArray &PipelineTraceWriter::label(AInt pc) {
+  auto it = m_labels.find(pc);
+  if (it == m_labels.end()) {
+    QString text = "0x" + QString::number(pc, 16) + ": " +
+                   ProcessorHandler::disassembleInstr(pc);
+    text.replace('\t', ' ');
+    it = m_labels.emplace(pc, text.toUtf8()).first;
+  }
+  return it->second;
+}
+
+void PipelineTraceWriter::traceCycle() {
+  const long long cycle = ProcessorHandler::getProcessor()->getCycleCount();
+
+  // Instructions which left the pipeline, either by retiring from a last stage
+  // or by being flushed.
+  auto leave = [&](const PipelineTracker::Instruction &instr, bool retired) {
+    beginCycle(cycle);
+    const QByteArray id = QByteArray::number(instr.id);
+    if (m_stalled.erase(instr.id))
+      m_buffer += "E\t" + id + "\t1\tstall\n";
+    m_buffer += "E\t" + id + "\t0\t" + m_stageNames[instr.stage] + "\n";
+    if (retired)
+      m_buffer +=
+          "R\t" + id + "\t" + QByteArray::number(m_nextRetireID++) + "\t0\n";
+    else
+      m_buffer += "R\t" + id + "\t0\t1\n";
+  };
+  for (const auto &instr : m_tracker.retired())
+    leave(instr, true);
+  for (const auto &instr : m_tracker.flushed())
+    leave(instr, false);
+
+  for (const auto &instr : m_tracker.instructions()) {
+    const QByteArray id = QByteArray::number(instr.id);
+    if (instr.previousStage == -1) {
+      // A newly fetched instruction.
+      beginCycle(cycle);
+      m_buffer += "I\t" + id + "\t" + id + "\t0\n";
+      m_buffer += "L\t" + id + "\t0\t" + label(instr.pc) + "\n";
+      m_buffer += "S\t" + id + "\t0\t" + m_stageNames[instr.stage] + "\n";
+    } else if (static_cast<unsigned>(instr.previousStage) == instr.stage) {
+      // Held in the same stage, i.e., stalled.
+      if (m_stalled.insert(instr.id).second) {
+        beginCycle(cycle);
+        m_buffer += "S\t" + id + "\t1\tstall\n";
+      }
+    } else {
+      beginCycle(cycle);
+      if (m_stalled.erase(instr.id))
+        m_buffer += "E\t" + id + "\t1\tstall\n";
+      m_buffer += "E\t" + id + "\t0\t" + m_stageNames[instr.previousStage] +
+                  "\n";
+      m_buffer += "S\t" + id + "\t0\t" + m_stageNames[instr.stage] + "\n";
+    }
+  }
+}
+
+void PipelineTraceWriter::writeBuffer() {
+  if (m_buffer.isEmpty())
+    return;
+  m_file.write(m_compress ? gzipMember(m_buffer) : m_buffer);
+  m_buffer.clear();
+}
+
+} // namespace Ripes
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+
+#include "pipelinetracker.h"
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Ripes {
+
+class SimulationContext;
+
+/**
+ * @brief The PipelineTraceWriter class
+ * Streams the lifetime of each instruction executed by the processor of the
+ * current simulation context to a pipeline trace in the Kanata format, as read
+ * by the Konata pipeline viewer. For each instruction, the trace records the
+ * cycles spent in each stage, the cycles during which it was stalled, and
+ * whether it was retired or flushed.
+ *
+ * Instructions are identified by the sequence ids assigned by a
+ * PipelineTracker, such that each fetch of an instruction is traced as an
+ * instruction of its own.
+ *
+ * The trace is written incrementally, and only the instructions within the
+ * pipeline are kept in memory.
+ */
+class PipelineTraceWriter {
+public:
+  PipelineTraceWriter();
+  ~PipelineTraceWriter();
+
+  /**
+   * @brief open
+   * Opens the trace at @p path and starts tracing from the current cycle of
+   * the processor. If @p path ends with ".gz", the trace is gzip-compressed.
+   * Returns an error message on failure.
+   */
+  QString open(const QString &path);
+
+  /// Writes any buffered trace data and closes the trace.
+  void close();
+
+private:
+  void processorWasClocked();
+  void traceCycle();
+  void beginCycle(long long cycle);
+  void writeBuffer();
+  const QByteArray &label(AInt pc);
+
+  PipelineTracker m_tracker;
+  std::vector<QByteArray> m_stageNames;
+  // Ids of the instructions within the pipeline which are stalled.
+  std::unordered_set<uint64_t> m_stalled;
+  uint64_t m_nextRetireID = 0;
+
+  // Disassembled instruction labels, by PC.
+  std::unordered_map<AInt, QByteArray> m_labels;
+
+  // Cycle of the last cycle marker written to the trace.
+  long long m_markedCycle = 0;
+  bool m_cycleMarked = false;
+
+  QFile m_file;
+  bool m_compress = false;
+  QByteArray m_buffer;
+
+  unsigned m_cycleObserverID = 0;
+  bool m_attached = false;
+  // The simulation context of the processor which is traced.
+  SimulationContext &m_context;
+};
+
+} // namespace Ripes
@@ -0,0 +1,164 @@
+#include "pipelinetracker.h"
+
+#include "processorhandler.h"
+
+#include <algorithm>
+
+namespace Ripes {
+
+void PipelineTracker::reset() {
+  const auto *processor = ProcessorHandler::getProcessor();
+  const auto &structure = processor->structure();
+  m_stages.clear();
+  m_lastStage.clear();
+  for (auto idx : structure.stageIt()) {
+    m_stages.push_back(idx);
+    m_lastStage.push_back(idx.index() + 1 == structure.at(idx.lane()));
+  }
+  m_matchOrder.resize(m_stages.size());
+  for (unsigned s = 0; s < m_stages.size(); ++s)
+    m_matchOrder[s] = s;
+  std::stable_sort(m_matchOrder.begin(), m_matchOrder.end(),
+                   [&](unsigned a, unsigned b) {
+                     return m_stages[a].index() > m_stages[b].index();
+                   });
+
+  m_instructions.clear();
+  m_occupants.assign(m_stages.size(), -1);
+  m_retired.clear();
+  m_flushed.clear();
+  m_nextID = 0;
+  m_lastCycle = processor->getCycleCount();
+  m_instructionsRetired = processor->getInstructionsRetired();
+  track();
+}
+
+bool PipelineTracker::update() {
+  const auto *processor = ProcessorHandler::getProcessor();
+  const long long cycle = processor->getCycleCount();
+  if (cycle <= m_lastCycle) {
+    m_instructionsRetired = processor->getInstructionsRetired();
+    return false;
+  }
+  m_lastCycle = cycle;
+  track();
+  return true;
+}
+
+void PipelineTracker::track() {
+  const auto *processor = ProcessorHandler::getProcessor();
+  const long long instructionsRetired = processor->getInstructionsRetired();
+  long long retiring = instructionsRetired - m_instructionsRetired;
+  m_instructionsRetired = instructionsRetired;
+
+  // Previous instructions which have been accounted for in this cycle.
+  std::vector<bool> done(m_instructions.size(), false);
+  m_retired.clear();
+  m_flushed.clear();
+  for (unsigned i = 0; i < m_instructions.size() && retiring > 0; ++i) {
+    if (!m_lastStage[m_instructions[i].stage])
+      continue;
+    m_retired.push_back(m_instructions[i]);
+    done[i] = true;
+    --retiring;
+  }
+
+  std::vector<StageInfo> infos;
+  infos.reserve(m_stages.size());
+  for (const auto &stage : m_stages)
+    infos.push_back(processor->stageInfo(stage));
+
+  // The first stage holds newly fetched instructions if the processor fetched
+  // from its address.
+  bool fetched = false;
+  for (unsigned s = 0; s < m_stages.size(); ++s)
+    fetched |= m_stages[s].index() == 0 && infos[s].stage_valid &&
+               infos[s].pc == m_nextFetched;
+
+  std::vector<Instruction> next;
+  // For each stage, the index into next of its occupant, or -1.
+  std::vector<int> occupants(m_stages.size(), -1);
+  for (const unsigned s : m_matchOrder) {
+    const StageInfo &info = infos[s];
+    if (!info.stage_valid || info.state != StageInfo::State::None)
+      continue;
+    const unsigned index = m_stages[s].index();
+
+    // Held in the same stage, or advanced from the preceding stage. The
+    // instructions are ordered by age, so the first candidate is the oldest.
+    int from = -1;
+    for (unsigned i = 0; i < m_instructions.size() && from == -1; ++i) {
+      const auto &instr = m_instructions[i];
+      if (done[i] || instr.pc != info.pc)
+        continue;
+      const bool held = instr.stage == s && (index != 0 || !fetched);
+      if (held || m_stages[instr.stage].index() + 1 == index)
+        from = i;
+    }
+    if (from != -1) {
+      done[from] = true;
+      Instruction instr = m_instructions[from];
+      instr.previousStage = static_cast<int>(instr.stage);
+      instr.stage = s;
+      occupants[s] = static_cast<int>(next.size());
+      next.push_back(instr);
+      continue;
+    }
+
+    // The same instruction may be shown in the same stage of multiple lanes.
+    bool shared = false;
+    for (unsigned t = 0; t < m_stages.size() && !shared; ++t) {
+      if (occupants[t] != -1 && m_stages[t].index() == index &&
+          next[occupants[t]].pc == info.pc) {
+        occupants[s] = occupants[t];
+        shared = true;
+      }
+    }
+    if (shared)
+      continue;
+
+    // An instruction which entered the pipeline; assigned an id below.
+    Instruction instr;
+    instr.pc = info.pc;
+    instr.stage = s;
+    occupants[s] = static_cast<int>(next.size());
+    next.push_back(instr);
+  }
+
+  for (unsigned i = 0; i < m_instructions.size(); ++i)
+    if (!done[i])
+      m_flushed.push_back(m_instructions[i]);
+
+  // Instructions which entered the pipeline are younger than those already
+  // within it, and are ordered by their progress through the pipeline. An
+  // instruction pair within the same stage is ordered by address.
+  std::vector<unsigned> entered;
+  for (unsigned i = 0; i < next.size(); ++i)
+    if (next[i].previousStage == -1)
+      entered.push_back(i);
+  std::sort(entered.begin(), entered.end(), [&](unsigned a, unsigned b) {
+    const unsigned ia = m_stages[next[a].stage].index();
+    const unsigned ib = m_stages[next[b].stage].index();
+    return ia != ib ? ia > ib : next[a].pc < next[b].pc;
+  });
+  for (const unsigned i : entered)
+    next[i].id = m_nextID++;
+
+  std::vector<unsigned> order(next.size());
+  for (unsigned i = 0; i < order.size(); ++i)
+    order[i] = i;
+  std::sort(order.begin(), order.end(),
+            [&](unsigned a, unsigned b) { return next[a].id < next[b].id; });
+  std::vector<int> remap(next.size());
+  m_instructions.clear();
+  for (const unsigned i : order) {
+    remap[i] = static_cast<int>(m_instructions.size());
+    m_instructions.push_back(next[i]);
+  }
+  for (unsigned s = 0; s < m_stages.size(); ++s)
+    m_occupants[s] = occupants[s] == -1 ? -1 : remap[occupants[s]];
+
+  m_nextFetched = processor->nextFetchedAddress();
+}
+
+} // namespace Ripes
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "processors/interface/ripesprocessor.h"
+
+#include <vector>
+
+namespace Ripes {
+
+/**
+ * @brief The PipelineTracker class
+ * Tracks the instructions within the pipeline of the processor of the current
+ * simulation context, from cycle to cycle. Each instruction is assigned a
+ * sequence id once it enters the pipeline; as instructions enter the pipeline
+ * in program order, the ids order the instructions by age.
+ *
+ * The processor does not identify the instructions within its pipeline, so
+ * these are matched between cycles by their PC. Stages are visited from the
+ * last stage to the first, and an instruction in a stage is taken to be the
+ * oldest instruction of the same PC which was held in that stage, or which was
+ * in the preceding stage of any lane, in the previous cycle. The first stage
+ * holds a newly fetched instruction if the processor fetched the address of
+ * the stage in the previous cycle. The instructions which retired in a cycle,
+ * per the instruction retirement count of the processor, are the oldest
+ * instructions which occupied a last stage in the previous cycle. Any other
+ * instruction which left the pipeline was flushed.
+ *
+ * An instruction which is flushed from the first stage, and then fetched anew
+ * from the same address without the processor announcing the fetch, is taken
+ * to have been held.
+ */
+class PipelineTracker {
+public:
+  struct Instruction {
+    uint64_t id = 0;
+    AInt pc = 0;
+    // Stage (index into stages()) holding the instruction.
+    unsigned stage = 0;
+    // Stage holding the instruction in the previous cycle, or -1 if the
+    // instruction entered the pipeline in this cycle.
+    int previousStage = -1;
+  };
+
+  /// Starts tracking the processor of the current simulation context, from
+  /// its current cycle.
+  void reset();
+
+  /// Tracks the current cycle of the processor; to be called after the
+  /// processor was clocked. Returns false if the cycle was already tracked,
+  /// i.e., after reversing the processor, in which case nothing changes.
+  bool update();
+
+  const std::vector<StageIndex> &stages() const { return m_stages; }
+  bool isLastStage(unsigned stage) const { return m_lastStage[stage]; }
+
+  /// Instructions within the pipeline, ordered by id.
+  const std::vector<Instruction> &instructions() const {
+    return m_instructions;
+  }
+  /// For each stage, the index into instructions() of the instruction which
+  /// occupies it, or -1.
+  const std::vector<int> &occupants() const { return m_occupants; }
+
+  /// Instructions which retired, and which were flushed, in the last tracked
+  /// cycle, ordered by id. Each is reported with the stage it left from.
+  const std::vector<Instruction> &retired() const { return m_retired; }
+  const std::vector<Instruction> &flushed() const { return m_flushed; }
+
+private:
+  void track();
+
+  std::vector<StageIndex> m_stages;
+  // Whether each stage is the last stage of its lane.
+  std::vector<bool> m_lastStage;
+  // Stages in the order in which they are matched; from the last stage to the
+  // first, and by lane.
+  std::vector<unsigned> m_matchOrder;
+
+  std::vector<Instruction> m_instructions;
+  std::vector<int> m_occupants;
+  std::vector<Instruction> m_retired;
+  std::vector<Instruction> m_flushed;
+
+  uint64_t m_nextID = 0;
+  long long m_lastCycle = -1;
+  long long m_instructionsRetired = 0;
+  AInt m_nextFetched = 0;
+};
+
+} // namespace Ripes
@@ -1,8 +1,12 @@
 #include "processorhandler.h"
 
+#include "STLExtras.h"
+#include "checkpoint.h"
 #include "processorregistry.h"
+#include "processors/RISC-V/rviss/rviss.h"
 #include "processors/ripesvsrtlprocessor.h"
 #include "ripessettings.h"
+#include "simulationcontext.h"
 #include "statusmanager.h"
 
 #include "assembler/program.h"
@@ -14,12 +18,32 @@
 
 #include <QMessageBox>
 #include <QtConcurrent/QtConcurrent>
+#include <QtEndian>
+
+#include <algorithm>
 
 namespace Ripes {
 
-ProcessorHandler::ProcessorHandler() {
+ProcessorHandler *ProcessorHandler::get() {
+  return &SimulationContext::current().processorHandler();
+}
+
+ProcessorHandler::ProcessorHandler(SimulationContext &context)
+    : m_context(context) {
   m_constructing = true;
 
+  if (!m_context.isApplicationContext()) {
+    // Contexts other than the application context are independent of the
+    // application settings, and start out with the default processor.
+    m_currentID = ProcessorID::RV32_5S;
+    const auto &desc = ProcessorRegistry::getDescription(m_currentID);
+    _selectProcessor(m_currentID, desc.isaInfo().isa->supportedExtensions(),
+                     desc.defaultRegisterVals);
+    m_syscallManager = std::make_unique<RISCVSyscallManager>();
+    m_constructing = false;
+    return;
+  }
+
   // Contruct the default processor
   // Processor ID
   if (RipesSettings::value(RIPES_SETTING_PROCESSOR_ID).isNull()) {
@@ -134,15 +158,119 @@ void ProcessorHandler::_loadProgram(const std::shared_ptr<Program> &p) {
   for (const auto &bp : bpsToRemove) {
     m_breakpoints.erase(bp);
   }
+  updateBreakpointBitmap();
 
-  RipesSettings::getObserver(RIPES_GLOBALSIGNAL_REQRESET)->trigger();
+  requestReset();
   emit programChanged();
 }
 
+/// Records the checkpoint pages spanned by the @p bytes bytes at @p address.
+static void markDirtyPages(std::set<AInt> &pages, AInt address, size_t bytes) {
+  if (bytes == 0) {
+    return;
+  }
+  constexpr AInt pageMask = ~static_cast<AInt>(Checkpoint::s_pageBytes - 1);
+  const AInt lastPage = (address + bytes - 1) & pageMask;
+  for (AInt page = address & pageMask; page <= lastPage;
+       page += Checkpoint::s_pageBytes) {
+    pages.insert(page);
+  }
+}
+
 void ProcessorHandler::_writeMem(AInt address, VInt value, int size) {
+  if (m_dirtyPages) {
+    markDirtyPages(*m_dirtyPages, address, size);
+  }
   m_currentProcessor->getMemory().writeMem(address, value, size);
 }
 
+bool ProcessorHandler::overlapsPeripheral(AInt address, size_t size) const {
+  const auto &peripherals = m_context.ioManager().peripheralMappings();
+  return llvm::any_of(peripherals, [&](const auto &entry) {
+    return entry.second.startAddr < address + size &&
+           address < entry.second.end();
+  });
+}
+
+void ProcessorHandler::_writeMemRange(AInt address, const char *data,
+                                      size_t size) {
+  if (size == 0) {
+    return;
+  }
+  if (m_dirtyPages) {
+    markDirtyPages(*m_dirtyPages, address, size);
+  }
+
+  auto &memory = m_currentProcessor->getMemory();
+  size_t i = 0;
+  if (!overlapsPeripheral(address, size)) {
+    // Bytes up until the first aligned word are written individually.
+    constexpr unsigned wordBytes = sizeof(VInt);
+    for (; i < size && (address + i) % wordBytes != 0; i++) {
+      memory.writeMem(address + i, static_cast<uint8_t>(data[i]), 1);
+    }
+    for (; i + wordBytes <= size; i += wordBytes) {
+      memory.writeMem(address + i, qFromLittleEndian<VInt>(data + i),
+                      wordBytes);
+    }
+  }
+  // Peripherals observe each byte-sized access.
+  for (; i < size; i++) {
+    memory.writeMem(address + i, static_cast<uint8_t>(data[i]), 1);
+  }
+}
+
+QByteArray ProcessorHandler::_readMemRange(AInt address, size_t size) const {
+  QByteArray bytes(static_cast<qsizetype>(size), Qt::Uninitialized);
+  char *data = bytes.data();
+  auto &memory = m_currentProcessor->getMemory();
+  size_t i = 0;
+  if (!overlapsPeripheral(address, size)) {
+    constexpr unsigned wordBytes = sizeof(VInt);
+    for (; i < size && (address + i) % wordBytes != 0; i++) {
+      data[i] = static_cast<char>(memory.readMemConst(address + i, 1) & 0xFF);
+    }
+    for (; i + wordBytes <= size; i += wordBytes) {
+      qToLittleEndian<VInt>(memory.readMemConst(address + i, wordBytes),
+                            data + i);
+    }
+  }
+  for (; i < size; i++) {
+    data[i] = static_cast<char>(memory.readMemConst(address + i, 1) & 0xFF);
+  }
+  return bytes;
+}
+
+QByteArray ProcessorHandler::_readMemString(AInt address) const {
+  // Strings are read in aligned chunks, up until the chunk which holds the null
+  // terminator.
+  constexpr AInt chunkBytes = 64;
+  QByteArray string;
+  while (true) {
+    const AInt chunkEnd = (address & ~(chunkBytes - 1)) + chunkBytes;
+    if (overlapsPeripheral(address, chunkEnd - address)) {
+      // Peripheral registers are not read beyond the terminator.
+      auto &memory = m_currentProcessor->getMemory();
+      for (;; address++) {
+        const char byte =
+            static_cast<char>(memory.readMemConst(address, 1) & 0xFF);
+        if (byte == '\0') {
+          return string;
+        }
+        string.append(byte);
+      }
+    }
+    const QByteArray chunk = _readMemRange(address, chunkEnd - address);
+    const qsizetype terminator = chunk.indexOf('\0');
+    if (terminator != -1) {
+      string.append(chunk.constData(), terminator);
+      return string;
+    }
+    string.append(chunk);
+    address = chunkEnd;
+  }
+}
+
 vsrtl::core::AddressSpaceMM &ProcessorHandler::_getMemory() {
   return m_currentProcessor->getMemory();
 }
@@ -160,8 +288,10 @@ void ProcessorHandler::_triggerProcStateChangeTimer() {
 
 class ProcessorClocker : public QRunnable {
 public:
-  explicit ProcessorClocker(std::mutex &clockLock) : clockLock(clockLock) {}
+  ProcessorClocker(SimulationContext &context, std::mutex &clockLock)
+      : context(context), clockLock(clockLock) {}
   void run() override {
+    SimulationContext::Scope scope(context);
     std::unique_lock l(clockLock);
     ProcessorHandler::getProcessorNonConst()->clock();
     ProcessorHandler::checkProcessorFinished();
@@ -171,6 +301,7 @@ public:
   }
 
 private:
+  SimulationContext &context;
   std::mutex &clockLock;
 };
 
@@ -179,34 +310,259 @@ void ProcessorHandler::_clock() {
   // that there already is an ongoing clock event. This _clock event will
   // therefore be ignored.
   if (m_clockLock.try_lock()) {
-    QThreadPool::globalInstance()->start(new ProcessorClocker(m_clockLock));
+    QThreadPool::globalInstance()->start(
+        new ProcessorClocker(m_context, m_clockLock));
     m_clockLock.unlock();
   }
 }
 
 void ProcessorHandler::_run() {
-  ProcessorStatusManager::setStatusTimed("Running...");
+  if (m_context.isApplicationContext()) {
+    ProcessorStatusManager::setStatusTimed("Running...");
+  }
   emit runStarted();
+  m_context.systemIO().setRunStopping(false);
 
   // Start running through the VSRTL Widget interface
   m_runWatcher.setFuture(QtConcurrent::run([=] {
-    auto *vsrtl_proc =
-        dynamic_cast<vsrtl::SimDesign *>(m_currentProcessor.get());
+    SimulationContext::Scope scope(m_context);
+    runLoop();
+    emit runFinished();
+  }));
+}
 
-    if (vsrtl_proc) {
-      vsrtl_proc->setEnableSignals(false);
-    }
+void ProcessorHandler::_runBlocking() {
+  emit runStarted();
+  m_context.systemIO().setRunStopping(false);
+  m_runningBlocking = true;
+  runLoop();
+  m_runningBlocking = false;
+  m_stopRunningFlag = false;
+  emit runFinished();
+}
 
-    while (!(_checkBreakpoint() || m_currentProcessor->finished() ||
-             m_stopRunningFlag)) {
+void ProcessorHandler::runLoop() {
+  auto *vsrtl_proc = dynamic_cast<vsrtl::SimDesign *>(m_currentProcessor.get());
+
+  if (vsrtl_proc) {
+    vsrtl_proc->setEnableSignals(false);
+  }
+
+  // Breakpoints and the finished state are checked on each cycle, whereas the
+  // stop flag is only checked in between batches of cycles. A trap requesting
+  // to stop the run ends the current batch (see syscallTrap).
+  bool stop = false;
+  while (!stop && !m_stopRunningFlag.load(std::memory_order_relaxed)) {
+    m_runBatchCycles = c_runBatchCycles;
+    while (m_runBatchCycles != 0) {
+      if (_checkBreakpoint() || m_currentProcessor->finished()) {
+        stop = true;
+        break;
+      }
+      m_runBatchCycles--;
       m_currentProcessor->clock();
     }
+  }
+
+  if (vsrtl_proc) {
+    vsrtl_proc->setEnableSignals(true);
+  }
+}
+
+/// Constructs a functional simulator which executes on the memory of
+/// @p processor.
+template <typename XLEN_T>
+static std::unique_ptr<RipesProcessor>
+constructFunctionalModel(RipesProcessor &processor,
+                         const QStringList &extensions) {
+  auto iss = std::make_unique<RVISS<XLEN_T>>(extensions);
+  iss->shareMemory(processor.getMemory());
+  return iss;
+}
 
-    if (vsrtl_proc) {
-      vsrtl_proc->setEnableSignals(true);
+QString ProcessorHandler::_fastForward(const FastForwardTarget &target,
+                                       long long &instructions,
+                                       Checkpoint *checkpoint) {
+  instructions = 0;
+  if (!m_program) {
+    return "No program loaded.";
+  }
+  if (m_currentProcessor->getCycleCount() != 0) {
+    return "Fast-forwarding requires the processor to be in its reset state.";
+  }
+
+  const QStringList &extensions = _currentISA()->enabledExtensions();
+  std::unique_ptr<RipesProcessor> functional =
+      _currentISA()->bits() == 32
+          ? constructFunctionalModel<uint32_t>(*m_currentProcessor, extensions)
+          : constructFunctionalModel<uint64_t>(*m_currentProcessor, extensions);
+  functional->isExecutableAddress = [=](AInt address) {
+    return _isExecutableAddress(address);
+  };
+  functional->trapHandler = [=] { syscallTrap(); };
+  // Execution continues from the current PC, which differs from the entry
+  // point if a checkpoint has been restored.
+  functional->setPCInitialValue(m_currentProcessor->getPcForStage({0, 0}));
+  functional->resetProcessor();
+  const unsigned regCnt = _currentISA()->regCnt();
+  for (unsigned i = 0; i < regCnt; i++) {
+    functional->setRegister(
+        RegisterFileType::GPR, i,
+        m_currentProcessor->getRegister(RegisterFileType::GPR, i));
+  }
+
+  // The functional simulator is made the current processor while
+  // fast-forwarding, such that system calls act upon its state.
+  std::swap(m_currentProcessor, functional);
+  constexpr VInt ecallInstr = 0x00000073;
+  const auto targetReached = [&] {
+    const AInt pc = m_currentProcessor->getPcForStage({0, 0});
+    switch (target.type) {
+    case FastForwardTarget::Type::PC:
+      return pc == target.value;
+    case FastForwardTarget::Type::Instructions:
+      return static_cast<AInt>(
+                 m_currentProcessor->getInstructionsRetired()) >= target.value;
+    case FastForwardTarget::Type::Marker:
+      return m_currentProcessor->getMemory().readMemConst(pc, 4) ==
+                 ecallInstr &&
+             m_currentProcessor->getRegister(RegisterFileType::GPR,
+                                             _currentISA()->syscallReg()) ==
+                 target.value;
     }
-    emit runFinished();
-  }));
+    Q_UNREACHABLE();
+  };
+
+  // When checkpointing, the pages written to by the program are tracked
+  // through the stores of the simulator and the memory writes of syscalls, on
+  // top of the pages of any restored checkpoint.
+  std::set<AInt> dirtyPages = m_restoredPages;
+  if (checkpoint) {
+    m_dirtyPages = &dirtyPages;
+  }
+  bool reached = false;
+  while (!(reached = targetReached()) && !m_currentProcessor->finished() &&
+         !m_stopRunningFlag) {
+    if (checkpoint) {
+      const MemoryAccess access = m_currentProcessor->dataMemAccess();
+      if (access.type == MemoryAccess::Write) {
+        markDirtyPages(dirtyPages, access.address, access.bytes);
+      }
+    }
+    m_currentProcessor->clock();
+  }
+  m_dirtyPages = nullptr;
+  if (reached && target.type == FastForwardTarget::Type::Marker) {
+    m_currentProcessor->setProgramCounter(
+        m_currentProcessor->getPcForStage({0, 0}) + 4);
+  }
+  instructions = m_currentProcessor->getInstructionsRetired();
+  if (reached && checkpoint) {
+    captureCheckpoint(*checkpoint, dirtyPages);
+    checkpoint->instructions = instructions;
+  }
+  std::swap(m_currentProcessor, functional);
+
+  if (!reached) {
+    return "Program finished before reaching the fast-forward target.";
+  }
+
+  // Memory is shared, so only registers and the PC must be transferred.
+  for (unsigned i = 1; i < regCnt; i++) {
+    m_currentProcessor->setRegister(
+        RegisterFileType::GPR, i,
+        functional->getRegister(RegisterFileType::GPR, i));
+  }
+  m_currentProcessor->setProgramCounter(functional->getPcForStage({0, 0}));
+  emit procStateChangedNonRun();
+  return QString();
+}
+
+void ProcessorHandler::captureCheckpoint(
+    Checkpoint &checkpoint, const std::set<AInt> &dirtyPages) const {
+  checkpoint = Checkpoint();
+  checkpoint.xlen = _currentISA()->bits();
+  checkpoint.pc = m_currentProcessor->getPcForStage({0, 0});
+  for (unsigned i = 0; i < _currentISA()->regCnt(); i++) {
+    checkpoint.regs.push_back(
+        m_currentProcessor->getRegister(RegisterFileType::GPR, i));
+  }
+
+  // Pages overlapping a peripheral are not memory; the state of peripherals is
+  // captured through their registers.
+  for (AInt page : dirtyPages) {
+    if (overlapsPeripheral(page, Checkpoint::s_pageBytes)) {
+      continue;
+    }
+    checkpoint.pages[page] = _readMemRange(page, Checkpoint::s_pageBytes);
+  }
+
+  // Read-only peripheral registers reflect external inputs, and are therefore
+  // not captured.
+  const auto &peripherals = m_context.ioManager().peripheralMappings();
+  for (const auto &[peripheral, mapping] : peripherals) {
+    for (const RegDesc &reg : peripheral->registers()) {
+      if (reg.rw == RegDesc::RW::RW) {
+        checkpoint.ioRegs.push_back({mapping.startAddr + reg.address, 4,
+                                     peripheral->ioRead(reg.address, 4)});
+      }
+    }
+  }
+
+  checkpoint.files = SystemIO::openFiles();
+}
+
+QString ProcessorHandler::_restoreCheckpoint(const Checkpoint &checkpoint) {
+  if (!m_program) {
+    return "No program loaded.";
+  }
+  if (m_currentProcessor->getCycleCount() != 0) {
+    return "Restoring a checkpoint requires the processor to be in its reset "
+           "state.";
+  }
+  const unsigned regCnt = _currentISA()->regCnt();
+  if (checkpoint.xlen != _currentISA()->bits() ||
+      checkpoint.regs.size() != regCnt) {
+    return "The checkpoint was taken on a different ISA than that of the "
+           "current processor.";
+  }
+
+  // Locate the peripheral of each register before modifying any state.
+  const auto &peripherals = m_context.ioManager().peripheralMappings();
+  std::vector<std::pair<IOBase *, AInt>> ioRegs;
+  for (const auto &reg : checkpoint.ioRegs) {
+    const auto it = llvm::find_if(peripherals, [&](const auto &entry) {
+      return entry.second.startAddr <= reg.address &&
+             reg.address < entry.second.end();
+    });
+    if (it == peripherals.end()) {
+      return "The checkpoint refers to a peripheral register at 0x" +
+             QString::number(reg.address, 16) + ", which is not mapped.";
+    }
+    ioRegs.push_back({it->first, reg.address - it->second.startAddr});
+  }
+
+  for (const auto &[page, contents] : checkpoint.pages) {
+    _writeMemRange(page, contents.constData(), contents.size());
+    m_restoredPages.insert(page);
+  }
+  for (unsigned i = 1; i < regCnt; i++) {
+    m_currentProcessor->setRegister(RegisterFileType::GPR, i,
+                                    checkpoint.regs.at(i));
+  }
+  m_currentProcessor->setProgramCounter(checkpoint.pc);
+  for (unsigned i = 0; i < ioRegs.size(); i++) {
+    ioRegs[i].first->ioWrite(ioRegs[i].second, checkpoint.ioRegs[i].value,
+                             checkpoint.ioRegs[i].bytes);
+  }
+  for (const auto &file : checkpoint.files) {
+    const QString err = SystemIO::restoreFile(file);
+    if (!err.isEmpty()) {
+      return err;
+    }
+  }
+  emit procStateChangedNonRun();
+  return QString();
 }
 
 void ProcessorHandler::_setBreakpoint(const AInt address, bool enabled) {
@@ -215,6 +571,7 @@ void ProcessorHandler::_setBreakpoint(const AInt address, bool enabled) {
   } else {
     m_breakpoints.erase(address);
   }
+  updateBreakpointBitmap();
 }
 
 void ProcessorHandler::_loadProcessorToWidget(vsrtl::VSRTLWidget *widget,
@@ -233,21 +590,42 @@ bool ProcessorHandler::_hasBreakpoint(const AInt address) const {
 }
 
 bool ProcessorHandler::_checkBreakpoint() {
-  for (const auto &stage : m_currentProcessor->breakpointTriggeringStages()) {
-    const auto it =
-        m_breakpoints.find(m_currentProcessor->getPcForStage(stage));
-    if (it != m_breakpoints.end()) {
+  for (const auto &stage : m_breakpointStages) {
+    // Addresses below the text section wrap around to out-of-range bits.
+    const AInt bit =
+        (m_currentProcessor->getPcForStage(stage) - m_breakpointBitmapBase) /
+        c_breakpointBitmapGranularity;
+    if (bit < m_breakpointBitmap.size() * 64 &&
+        ((m_breakpointBitmap[bit / 64] >> (bit % 64)) & 1)) {
       return true;
     }
   }
   return false;
 }
 
+void ProcessorHandler::updateBreakpointBitmap() {
+  m_breakpointBitmapBase = _getTextStart();
+  const unsigned bits =
+      (_getCurrentProgramSize() + c_breakpointBitmapGranularity - 1) /
+      c_breakpointBitmapGranularity;
+  m_breakpointBitmap.assign((bits + 63) / 64, 0);
+  for (const AInt bp : m_breakpoints) {
+    const AInt bit =
+        (bp - m_breakpointBitmapBase) / c_breakpointBitmapGranularity;
+    if (bit < bits) {
+      m_breakpointBitmap[bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+  }
+}
+
 void ProcessorHandler::_toggleBreakpoint(const AInt address) {
-  _setBreakpoint(address, !hasBreakpoint(address));
+  _setBreakpoint(address, !_hasBreakpoint(address));
 }
 
-void ProcessorHandler::_clearBreakpoints() { m_breakpoints.clear(); }
+void ProcessorHandler::_clearBreakpoints() {
+  m_breakpoints.clear();
+  updateBreakpointBitmap();
+}
 
 void ProcessorHandler::createAssemblerForCurrentISA() {
   const auto &ISA = _currentISA();
@@ -267,7 +645,9 @@ void ProcessorHandler::_reset() {
   }
 
   SystemIO::abortSyscall();
-  getProcessorNonConst()->resetProcessor();
+  m_currentProcessor->resetProcessor();
+  m_syscallManager->resetStatistics();
+  m_restoredPages.clear();
 
   // Rewrite register initializations
   for (const auto &kv : m_currentRegInits) {
@@ -275,7 +655,7 @@ void ProcessorHandler::_reset() {
   }
 
   // Reset IO devices.
-  IOManager::get().reset();
+  m_context.ioManager().reset();
 
   // Forcing memory values doesn't necessarily mean that the processor will
   // notify that its state changed. Manually trigger a state change signal, to
@@ -283,13 +663,25 @@ void ProcessorHandler::_reset() {
   emit procStateChangedNonRun();
 }
 
+void ProcessorHandler::requestReset() {
+  // Resetting the application context is a global request, which all of the
+  // application (i.e., the GUI) responds to. Other contexts are reset directly.
+  if (m_context.isApplicationContext()) {
+    RipesSettings::getObserver(RIPES_GLOBALSIGNAL_REQRESET)->trigger();
+  } else {
+    _reset();
+  }
+}
+
 void ProcessorHandler::_selectProcessor(const ProcessorID &id,
                                         const QStringList &extensions,
                                         const RegisterInitialization &setup) {
   m_currentID = id;
   m_currentRegInits = setup;
-  RipesSettings::setValue(RIPES_SETTING_PROCESSOR_ID, id);
-  RipesSettings::setValue(RIPES_SETTING_PROCESSOR_EXTENSIONS, extensions);
+  if (m_context.isApplicationContext()) {
+    RipesSettings::setValue(RIPES_SETTING_PROCESSOR_ID, id);
+    RipesSettings::setValue(RIPES_SETTING_PROCESSOR_EXTENSIONS, extensions);
+  }
 
   // Keep current program if the ISA between the two processors are identical
   const bool keepProgram =
@@ -309,12 +701,19 @@ void ProcessorHandler::_selectProcessor(const ProcessorID &id,
   m_currentProcessor->trapHandler = [=] { syscallTrap(); };
 
   m_currentProcessor->postConstruct();
+  if (!m_context.isApplicationContext()) {
+    // Reverse execution is only of use when interactively stepping through a
+    // program, which is done in the application context.
+    m_currentProcessor->setMaxReverseCycles(0);
+  }
+  m_breakpointStages = m_currentProcessor->breakpointTriggeringStages();
   createAssemblerForCurrentISA();
 
   if (keepProgram && m_program) {
-    loadProgram(m_program);
+    _loadProgram(m_program);
   } else {
     m_program = nullptr;
+    updateBreakpointBitmap();
     emit programChanged();
   }
 
@@ -330,12 +729,12 @@ void ProcessorHandler::_selectProcessor(const ProcessorID &id,
             }
           },
           m_currentProcessor->processorWasClocked)));
-  // Connect ProcessorHandler::processorClocked since things connected to this
-  // signal _must_ be updated _for each_ processor cycle, in order. Which would
-  // not be possible through processorClockedNonRun, which might be cross-thread
-  // and out of order.
+  // Cycle observers _must_ be updated _for each_ processor cycle, in order.
+  // Which would not be possible through processorClockedNonRun, which might be
+  // cross-thread and out of order. They are called directly, such that the
+  // cost of a cycle is not dominated by signal dispatching while running.
   m_currentProcessor->processorWasClocked.Connect(
-      this, &ProcessorHandler::processorClocked);
+      this, &ProcessorHandler::notifyCycleObservers);
 
   m_signalWrappers.push_back(std::unique_ptr<vsrtl::GallantSignalWrapperBase>(
       new vsrtl::GallantSignalWrapper(
@@ -358,7 +757,7 @@ void ProcessorHandler::_selectProcessor(const ProcessorID &id,
   emit processorChanged();
 
   // Finally, reset the processor
-  RipesSettings::getObserver(RIPES_GLOBALSIGNAL_REQRESET)->trigger();
+  requestReset();
 }
 
 int ProcessorHandler::_getCurrentProgramSize() const {
@@ -394,21 +793,37 @@ QString ProcessorHandler::_disassembleInstr(const AInt addr) const {
 }
 
 void ProcessorHandler::syscallTrap() {
-  auto futureWatcher = QFutureWatcher<bool>();
-  futureWatcher.setFuture(QtConcurrent::run([=] {
-    const unsigned int function = m_currentProcessor->getRegister(
-        RegisterFileType::GPR, _currentISA()->syscallReg());
-    return m_syscallManager->execute(function);
-  }));
+  SimulationContext::Scope scope(m_context);
+  const unsigned int function = m_currentProcessor->getRegister(
+      RegisterFileType::GPR, _currentISA()->syscallReg());
+
+  bool success;
+  if (m_syscallManager->isInteractive(function)) {
+    // System calls which wait for user interaction are executed in a separate
+    // thread, whereas all other system calls are executed directly within the
+    // simulation thread.
+    auto futureWatcher = QFutureWatcher<bool>();
+    futureWatcher.setFuture(QtConcurrent::run([=] {
+      SimulationContext::Scope scope(m_context);
+      return m_syscallManager->execute(function);
+    }));
+    futureWatcher.waitForFinished();
+    success = futureWatcher.result();
+  } else {
+    success = m_syscallManager->execute(function);
+  }
 
-  futureWatcher.waitForFinished();
-  if (!futureWatcher.result()) {
-    // Syscall handling failed, stop running processor
+  if (!success) {
+    // Syscall handling failed, stop running processor. The current batch of
+    // the run loop is ended, such that the run stops directly after the trap.
     setStopRunFlag();
+    m_runBatchCycles = 0;
   }
 }
 
-bool ProcessorHandler::_isRunning() { return !m_runWatcher.isFinished(); }
+bool ProcessorHandler::_isRunning() {
+  return m_runningBlocking || !m_runWatcher.isFinished();
+}
 
 void ProcessorHandler::_checkProcessorFinished() {
   if (m_currentProcessor->finished())
@@ -417,20 +832,51 @@ void ProcessorHandler::_checkProcessorFinished() {
 
 void ProcessorHandler::setStopRunFlag() {
   emit stopping();
-  if (m_runWatcher.isRunning()) {
+  if (m_runningBlocking || m_runWatcher.isRunning()) {
     m_stopRunningFlag = true;
     // We might be currently trapping for user I/O. Signal to abort the trap, in
-    // this avoiding a deadlock.
+    // this avoiding a deadlock. This may be called from outside of the context
+    // of this handler.
+    SimulationContext::Scope scope(m_context);
     SystemIO::abortSyscall();
+    m_context.systemIO().setRunStopping(true);
   }
 }
 
 void ProcessorHandler::_stopRun() {
   setStopRunFlag();
+  // The run may be blocked on writing output which this thread consumes.
+  auto &sio = m_context.systemIO();
+  while (m_runWatcher.isRunning()) {
+    sio.flushOutput();
+    QThread::msleep(1);
+  }
   m_runWatcher.waitForFinished();
   m_stopRunningFlag = false;
 }
 
+unsigned ProcessorHandler::_addCycleObserver(std::function<void()> observer) {
+  // The observers are called from the thread running the processor, and must
+  // therefore not change while running.
+  _stopRun();
+  m_cycleObservers.emplace_back(m_nextCycleObserverID, std::move(observer));
+  return m_nextCycleObserverID++;
+}
+
+void ProcessorHandler::_removeCycleObserver(unsigned id) {
+  _stopRun();
+  auto it = std::remove_if(
+      m_cycleObservers.begin(), m_cycleObservers.end(),
+      [=](const auto &observer) { return observer.first == id; });
+  m_cycleObservers.erase(it, m_cycleObservers.end());
+}
+
+void ProcessorHandler::notifyCycleObservers() {
+  for (const auto &observer : m_cycleObservers) {
+    observer.second();
+  }
+}
+
 bool ProcessorHandler::_isExecutableAddress(AInt address) const {
   if (m_program) {
     if (auto *textSection = m_program->getSection(TEXT_SECTION_NAME)) {
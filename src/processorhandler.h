@@ -3,6 +3,8 @@
 #include <QFuture>
 #include <QFutureWatcher>
 #include <QObject>
+#include <atomic>
+#include <functional>
 #include <memory>
 
 #include "VSRTL/graphics/gallantsignalwrapper.h"
@@ -16,21 +18,42 @@
 
 namespace Ripes {
 
+struct Checkpoint;
+class SimulationContext;
+
+/**
+ * @brief The FastForwardTarget struct
+ * The point of a program up until which it is executed functionally, before
+ * switching to the selected processor model.
+ */
+struct FastForwardTarget {
+  enum class Type {
+    // Until the program counter reaches the given address.
+    PC,
+    // Until the given number of instructions have been executed.
+    Instructions,
+    // Until an ecall with the given syscall number (a marker) is reached. The
+    // marker ecall itself is skipped.
+    Marker
+  };
+  Type type = Type::Instructions;
+  AInt value = 0;
+};
+
 /**
  * @brief The ProcessorHandler class
  * Manages construction and destruction of a VSRTL processor design, when
  * selecting between processors. Manages all interaction and control of the
- * current processor.
+ * current processor. Each SimulationContext owns a ProcessorHandler; the static
+ * functions of this class act upon the handler of the current context.
  */
 class ProcessorHandler : public QObject {
   Q_OBJECT
 
 public:
-  /// Returns a pointer to the ProcessorHandler singleton.
-  static ProcessorHandler *get() {
-    static auto *handler = new ProcessorHandler;
-    return handler;
-  }
+  /// Returns a pointer to the ProcessorHandler of the current simulation
+  /// context.
+  static ProcessorHandler *get();
 
   /// Returns a non-const pointer to the currently instantiated processor.
   static RipesProcessor *getProcessorNonConst() {
@@ -146,6 +169,36 @@ public:
     get()->_writeMem(address, value, size);
   }
 
+  /**
+   * @brief writeMemRange
+   * Writes the @p size bytes at @p data into the memory of the simulator, from
+   * @p address. Equivalent to writing each byte through writeMem(), but ranges
+   * which do not overlap a peripheral are written in word-sized accesses.
+   */
+  static void writeMemRange(AInt address, const char *data, size_t size) {
+    get()->_writeMemRange(address, data, size);
+  }
+
+  /**
+   * @brief readMemRange
+   * Returns the @p size bytes of the memory of the simulator from @p address,
+   * read as through readMemConst(). Ranges which do not overlap a peripheral
+   * are read in word-sized accesses.
+   */
+  static QByteArray readMemRange(AInt address, size_t size) {
+    return get()->_readMemRange(address, size);
+  }
+
+  /**
+   * @brief readMemString
+   * Returns the null-terminated string at @p address, excluding the null
+   * terminator. Bytes following the terminator are read only if they do not
+   * belong to a peripheral.
+   */
+  static QByteArray readMemString(AInt address) {
+    return get()->_readMemString(address);
+  }
+
   /**
    * @brief getRegisterValue
    * @returns value of register @param idx
@@ -156,8 +209,8 @@ public:
 
   /// Returns true if the processor is currently at a breakpoint. This is done
   /// through comparing the breakpoint-triggering stages of the current
-  /// processor, fetching the PC of those stages, and comparing them against the
-  /// current set of breakpoint addresses.
+  /// processor, fetching the PC of those stages, and looking them up in the
+  /// breakpoint bitmap of the text section.
   static bool checkBreakpoint() { return get()->_checkBreakpoint(); }
 
   /// Set/unset the provided address as a breakpoint.
@@ -198,6 +251,41 @@ public:
    */
   static void run() { get()->_run(); }
 
+  /**
+   * @brief runBlocking
+   * As run(), but runs the current processor in the calling thread and returns
+   * once the run has finished. This is intended for simulation contexts driven
+   * from their own thread, which need not have an event loop.
+   */
+  static void runBlocking() { get()->_runBlocking(); }
+
+  /**
+   * @brief fastForward
+   * Executes the current program on a functional instruction-set simulator
+   * until @p target is reached, and transfers the architectural state
+   * (registers and PC) to the current processor, which continues from that
+   * point onwards. The simulator executes on the memory of the current
+   * processor, which must be in its reset state. The number of executed
+   * instructions is returned through @p instructions. Returns an error message
+   * if the target could not be reached. If @p checkpoint is set, the
+   * architectural state at the target is captured into it.
+   */
+  static QString fastForward(const FastForwardTarget &target,
+                             long long &instructions,
+                             Checkpoint *checkpoint = nullptr) {
+    return get()->_fastForward(target, instructions, checkpoint);
+  }
+
+  /**
+   * @brief restoreCheckpoint
+   * Restores the architectural state of @p checkpoint onto the current
+   * processor, which must be in its reset state with the program that the
+   * checkpoint was taken from loaded. Returns an error message on failure.
+   */
+  static QString restoreCheckpoint(const Checkpoint &checkpoint) {
+    return get()->_restoreCheckpoint(checkpoint);
+  }
+
   static void clock() { get()->_clock(); }
 
   /**
@@ -207,6 +295,25 @@ public:
    */
   static void stopRun() { get()->_stopRun(); }
 
+  /**
+   * @brief addCycleObserver
+   * Registers @p observer to be called after each cycle of the processor, in
+   * lockstep with and in the thread of the processor. This is intended for
+   * things which must be updated for each processor cycle, in order; i.e., for
+   * logging statistics per cycle. The observers are called directly, without
+   * any signal dispatching, and must not update the GUI. Any running
+   * simulation is stopped. Returns an ID for removeCycleObserver().
+   */
+  static unsigned addCycleObserver(std::function<void()> observer) {
+    return get()->_addCycleObserver(std::move(observer));
+  }
+
+  /// Removes the cycle observer with the provided ID. Any running simulation is
+  /// stopped.
+  static void removeCycleObserver(unsigned id) {
+    get()->_removeCycleObserver(id);
+  }
+
 signals:
 
   /**
@@ -244,10 +351,6 @@ signals:
   void programChanged();
   void processorReset();
   void processorReversed();
-  // Only connect to this if not updating gui!´ i.e., for logging statistics per
-  // cycle. Remember to use Qt::DirectConnection for the slot to be executed
-  // directly, instead of concurrently in the event loop.
-  void processorClocked();
   void processorClockedNonRun(); // Only emitted when _not_ running; i.e., for
                                  // GUI updating
   void procStateChangedNonRun(); // processorReset | processorReversed |
@@ -267,7 +370,7 @@ private slots:
   void syscallTrap();
 
 private:
-  /// Private implementations of the ProcessorHandler singleton functions. For
+  /// Private implementations of the ProcessorHandler static functions. For
   /// documentation, refer to their static counterparts above.
 
   void _loadProgram(const std::shared_ptr<Program> &p);
@@ -297,8 +400,14 @@ private:
   const vsrtl::core::AddressSpace &_getRegisters() const;
   void _setRegisterValue(RegisterFileType rfid, const unsigned idx, VInt value);
   void _writeMem(AInt address, VInt value, int size = sizeof(VInt));
+  void _writeMemRange(AInt address, const char *data, size_t size);
+  QByteArray _readMemRange(AInt address, size_t size) const;
+  QByteArray _readMemString(AInt address) const;
+  /// Returns true if [address, address + size[ overlaps a peripheral.
+  bool overlapsPeripheral(AInt address, size_t size) const;
   VInt _getRegisterValue(RegisterFileType rfid, const unsigned idx) const;
   bool _checkBreakpoint();
+  void updateBreakpointBitmap();
   void _setBreakpoint(const AInt address, bool enabled);
   void _toggleBreakpoint(const AInt address);
   bool _hasBreakpoint(const AInt address) const;
@@ -306,17 +415,31 @@ private:
   void _checkProcessorFinished();
   bool _isRunning();
   void _run();
+  void _runBlocking();
+  void runLoop();
+  QString _fastForward(const FastForwardTarget &target,
+                       long long &instructions, Checkpoint *checkpoint);
+  void captureCheckpoint(Checkpoint &checkpoint,
+                         const std::set<AInt> &dirtyPages) const;
+  QString _restoreCheckpoint(const Checkpoint &checkpoint);
   void _clock();
   void _reset();
   void _stopRun();
+  unsigned _addCycleObserver(std::function<void()> observer);
+  void _removeCycleObserver(unsigned id);
+  void notifyCycleObservers();
   void _triggerProcStateChangeTimer();
 
   void createAssemblerForCurrentISA();
   void setStopRunFlag();
-  ProcessorHandler();
-
-  // Flag used during construction to avoid calling ProcessorHandler::get() to
-  // retrieve the singleton while it is being constructed.
+  void requestReset();
+  explicit ProcessorHandler(SimulationContext &context);
+  friend class SimulationContext;
+
+  // The simulation context which owns this handler.
+  SimulationContext &m_context;
+  // Flag used during construction to avoid resetting the processor while the
+  // handler is being constructed.
   bool m_constructing = false;
   ProcessorID m_currentID;
   RegisterInitialization m_currentRegInits;
@@ -333,10 +456,49 @@ private:
   std::set<AInt> m_breakpoints;
   std::shared_ptr<Program> m_program;
 
+  /**
+   * @brief m_breakpointBitmap
+   * The breakpoints of m_breakpoints as a flat bitmap over the text section,
+   * such that the run loop may check for breakpoints without any lookups. Bit
+   * i corresponds to the address m_breakpointBitmapBase +
+   * i * c_breakpointBitmapGranularity.
+   */
+  static constexpr unsigned c_breakpointBitmapGranularity = 2;
+  std::vector<uint64_t> m_breakpointBitmap;
+  AInt m_breakpointBitmapBase = 0;
+  // Cached, as the breakpoint-triggering stages are checked on every cycle.
+  std::vector<StageIndex> m_breakpointStages;
+
   QFutureWatcher<void> m_runWatcher;
-  bool m_stopRunningFlag = false;
+  // Set while running through runBlocking(), which bypasses m_runWatcher.
+  std::atomic<bool> m_runningBlocking = false;
+  std::atomic<bool> m_stopRunningFlag = false;
+  // The run loop checks the stop flag once per batch of c_runBatchCycles
+  // cycles. m_runBatchCycles holds the number of cycles left in the current
+  // batch.
+  static constexpr unsigned c_runBatchCycles = 4096;
+  unsigned m_runBatchCycles = 0;
   std::mutex m_clockLock;
 
+  // Registered cycle observers, by ID.
+  std::vector<std::pair<unsigned, std::function<void()>>> m_cycleObservers;
+  unsigned m_nextCycleObserverID = 0;
+
+  /**
+   * @brief m_dirtyPages
+   * If set, the base address of each checkpoint page written to through
+   * writeMem() is recorded in this set.
+   */
+  std::set<AInt> *m_dirtyPages = nullptr;
+
+  /**
+   * @brief m_restoredPages
+   * The pages written by the checkpoint restored since the last reset (if
+   * any). A checkpoint taken after a restore holds these pages in addition to
+   * the pages written to since the restore.
+   */
+  std::set<AInt> m_restoredPages;
+
   /**
    * @brief To avoid excessive UI updates due to things relying on
    * procStateChangedNonRun, the m_procStateChangeTimer ensures that the signal
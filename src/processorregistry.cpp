@@ -7,6 +7,7 @@
 #include "processors/RISC-V/rv5s_no_fw_hz/rv5s_no_fw_hz.h"
 #include "processors/RISC-V/rv5s_no_hz/rv5s_no_hz.h"
 #include "processors/RISC-V/rv6s_dual/rv6s_dual.h"
+#include "processors/RISC-V/rviss/rviss.h"
 #include "processors/RISC-V/rvss/rvss.h"
 
 namespace Ripes {
@@ -41,6 +42,12 @@ constexpr const char rv6s_desc[] =
     "is reserved for controlflow and ecall instructions, and way 2 for "
     "memory accessing instructions.";
 
+constexpr const char rviss_desc[] =
+    "A functional instruction-set simulator. Instructions are executed one per "
+    "cycle without modelling the processor datapath, trading visualization for "
+    "simulation speed. Suited for long-running programs and cache "
+    "simulations.";
+
 ProcessorRegistry::ProcessorRegistry() {
   // Initialize processors
   std::vector<Layout> layouts;
@@ -178,5 +185,15 @@ ProcessorRegistry::ProcessorRegistry() {
   addProcessor(ProcInfo<vsrtl::core::RV6S_DUAL<uint64_t>>(
       ProcessorID::RV64_6S_DUAL, "6-stage dual-issue processor", rv6s_desc,
       layouts, defRegVals));
+
+  // RISC-V instruction-set simulator
+  layouts = {};
+  defRegVals = {{2, 0x7ffffff0}, {3, 0x10000000}};
+  addProcessor(ProcInfo<RVISS<uint32_t>>(
+      ProcessorID::RV32_ISS, "Instruction-set simulator", rviss_desc, layouts,
+      defRegVals));
+  addProcessor(ProcInfo<RVISS<uint64_t>>(
+      ProcessorID::RV64_ISS, "Instruction-set simulator", rviss_desc, layouts,
+      defRegVals));
 }
 } // namespace Ripes
@@ -50,6 +50,19 @@ Enum(ECALL, none, print_int = 1, print_char = 2, print_string = 4, exit = 10);
 Enum(PcSrc, PC4 = 0, ALU = 1);
 Enum(PcInc, INC2 = 0, INC4 = 1);
 
+/** Fields of the 32-bit instruction formats */
+namespace RVInstrField {
+using Opcode = InstrField<0, 7>;
+using Rd = InstrField<7, 5>;
+using Funct3 = InstrField<12, 3>;
+using Rs1 = InstrField<15, 5>;
+using Rs2 = InstrField<20, 5>;
+using Funct7 = InstrField<25, 7>;
+// Upper bits of funct7, which select between shift variants of the I-type
+// shift instructions (bit 25 being part of the shift amount in RV64I).
+using Funct6 = InstrField<26, 6>;
+} // namespace RVInstrField
+
 /** Instruction field parser */
 class RVInstrParser {
 public:
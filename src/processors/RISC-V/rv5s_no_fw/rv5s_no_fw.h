@@ -428,6 +428,7 @@ public:
   const std::vector<StageIndex> breakpointTriggeringStages() const override {
     return {{0, IF}};
   }
+  StageIndex dataMemAccessStage() const override { return {0, MEM}; }
 
   MemoryAccess dataMemAccess() const override {
     return memToAccessInfo(data_mem);
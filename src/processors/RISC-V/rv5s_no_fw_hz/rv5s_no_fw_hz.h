@@ -383,6 +383,7 @@ public:
   MemoryAccess dataMemAccess() const override {
     return memToAccessInfo(data_mem);
   }
+  StageIndex dataMemAccessStage() const override { return {0, MEM}; }
   MemoryAccess instrMemAccess() const override {
     auto instrAccess = memToAccessInfo(instr_mem);
     instrAccess.type = MemoryAccess::Read;
@@ -795,6 +795,13 @@ public:
   VInt getRegister(RegisterFileType, unsigned i) const override {
     return registerFile->getRegister(i);
   }
+  std::optional<VInt> registerWriteValue(StageIndex stage) const override {
+    if (stage == StageIndex{EXEC, WB})
+      return registerFile->data_1_in.uValue();
+    if (stage == StageIndex{DATA, WB})
+      return registerFile->data_2_in.uValue();
+    return std::nullopt;
+  }
   void finalize(FinalizeReason fr) override {
     if ((fr & FinalizeReason::exitSyscall) &&
         !ecallChecker->isSysCallExiting()) {
@@ -808,6 +815,7 @@ public:
   const std::vector<StageIndex> breakpointTriggeringStages() const override {
     return {{DATA, IF}, {EXEC, IF}};
   }
+  StageIndex dataMemAccessStage() const override { return {DATA, MEM}; }
 
   MemoryAccess dataMemAccess() const override {
     return memToAccessInfo(data_mem);
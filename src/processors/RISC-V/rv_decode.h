@@ -1,8 +1,195 @@
 ﻿#pragma once
 
+#include <algorithm>
+#include <array>
+
 #include "VSRTL/core/vsrtl_component.h"
 #include "riscv.h"
 
+namespace Ripes {
+
+/**
+ * Decoding of 32-bit instructions to their RVInstr. The RVInstr of an
+ * instruction is fully determined by its opcode, funct3 and funct6 fields and
+ * bit 25 (the lowest bit of funct7). Instructions are decoded through a single
+ * lookup in a dispatch table indexed by these bits, which is generated at
+ * compile time from the reference decoder decodeFields().
+ */
+namespace RVDecode {
+
+/**
+ * @brief decodeFields
+ * Reference decoder of @p instr. M extension instructions are only decoded if
+ * @p hasM is set.
+ */
+constexpr unsigned decodeFields(uint32_t instr, bool hasM) {
+  const unsigned funct3 = RVInstrField::Funct3::get(instr);
+  const unsigned funct6 = RVInstrField::Funct6::get(instr);
+  const unsigned funct7 = RVInstrField::Funct7::get(instr);
+
+  switch (RVInstrField::Opcode::get(instr)) {
+  case RVISA::Opcode::LUI:
+    return RVInstr::LUI;
+  case RVISA::Opcode::AUIPC:
+    return RVInstr::AUIPC;
+  case RVISA::Opcode::JAL:
+    return RVInstr::JAL;
+  case RVISA::Opcode::JALR:
+    return RVInstr::JALR;
+  case RVISA::Opcode::ECALL:
+    return RVInstr::ECALL;
+
+  case RVISA::Opcode::OPIMM: {
+    // I-Type
+    constexpr unsigned ops[] = {RVInstr::ADDI, RVInstr::SLLI, RVInstr::SLTI,
+                                RVInstr::SLTIU, RVInstr::XORI, RVInstr::NOP,
+                                RVInstr::ORI,  RVInstr::ANDI};
+    if (funct3 == 0b101) {
+      return funct6 == 0b000000   ? RVInstr::SRLI
+             : funct6 == 0b010000 ? RVInstr::SRAI
+                                  : RVInstr::NOP;
+    }
+    return ops[funct3];
+  }
+
+  case RVISA::Opcode::OPIMM32: {
+    // I-Type (32-bit, in 64-bit ISA)
+    switch (funct3) {
+    case 0b000:
+      return RVInstr::ADDIW;
+    case 0b001:
+      return RVInstr::SLLIW;
+    case 0b101:
+      return funct6 == 0b000000   ? RVInstr::SRLIW
+             : funct6 == 0b010000 ? RVInstr::SRAIW
+                                  : RVInstr::NOP;
+    default:
+      return RVInstr::NOP;
+    }
+  }
+
+  case RVISA::Opcode::OP: {
+    // R-Type
+    if (funct7 == 0b0000001) {
+      // RV32M Standard extension
+      constexpr unsigned ops[] = {RVInstr::MUL, RVInstr::MULH, RVInstr::MULHSU,
+                                  RVInstr::MULHU, RVInstr::DIV, RVInstr::DIVU,
+                                  RVInstr::REM,  RVInstr::REMU};
+      if (!hasM) {
+        return RVInstr::NOP;
+      }
+      return ops[funct3];
+    }
+    constexpr unsigned ops[] = {RVInstr::ADD, RVInstr::SLL, RVInstr::SLT,
+                                RVInstr::SLTU, RVInstr::XOR, RVInstr::SRL,
+                                RVInstr::OR,  RVInstr::AND};
+    if ((funct3 == 0b000 || funct3 == 0b101) && funct7 != 0b0000000) {
+      if (funct7 != 0b0100000) {
+        return RVInstr::NOP;
+      }
+      return funct3 == 0b000 ? RVInstr::SUB : RVInstr::SRA;
+    }
+    return ops[funct3];
+  }
+
+  case RVISA::Opcode::OP32: {
+    // R-Type (32-bit, in 64-bit ISA)
+    if (funct7 == 0b0000001) {
+      // RV64M Standard extension
+      constexpr unsigned ops[] = {RVInstr::MULW, RVInstr::NOP,   RVInstr::NOP,
+                                  RVInstr::NOP,  RVInstr::DIVW,  RVInstr::DIVUW,
+                                  RVInstr::REMW, RVInstr::REMUW};
+      if (!hasM) {
+        return RVInstr::NOP;
+      }
+      return ops[funct3];
+    }
+    constexpr unsigned ops[] = {RVInstr::ADDW, RVInstr::SLLW, RVInstr::NOP,
+                                RVInstr::NOP,  RVInstr::NOP,  RVInstr::SRLW,
+                                RVInstr::NOP,  RVInstr::NOP};
+    if ((funct3 == 0b000 || funct3 == 0b101) && funct7 != 0b0000000) {
+      if (funct7 != 0b0100000) {
+        return RVInstr::NOP;
+      }
+      return funct3 == 0b000 ? RVInstr::SUBW : RVInstr::SRAW;
+    }
+    return ops[funct3];
+  }
+
+  case RVISA::Opcode::LOAD: {
+    constexpr unsigned ops[] = {RVInstr::LB,  RVInstr::LH,  RVInstr::LW,
+                                RVInstr::LD,  RVInstr::LBU, RVInstr::LHU,
+                                RVInstr::LWU, RVInstr::NOP};
+    return ops[funct3];
+  }
+
+  case RVISA::Opcode::STORE: {
+    constexpr unsigned ops[] = {RVInstr::SB,  RVInstr::SH,  RVInstr::SW,
+                                RVInstr::SD,  RVInstr::NOP, RVInstr::NOP,
+                                RVInstr::NOP, RVInstr::NOP};
+    return ops[funct3];
+  }
+
+  case RVISA::Opcode::BRANCH: {
+    constexpr unsigned ops[] = {RVInstr::BEQ, RVInstr::BNE,  RVInstr::NOP,
+                                RVInstr::NOP, RVInstr::BLT,  RVInstr::BGE,
+                                RVInstr::BLTU, RVInstr::BGEU};
+    return ops[funct3];
+  }
+
+  default:
+    // Unknown instruction.
+    return RVInstr::NOP;
+  }
+}
+
+// Table index: [10:6] opcode[6:2], [5:3] funct3, [2:1] funct6 class, [0] bit
+// 25. The two lowest opcode bits are 0b11 for all 32-bit instructions.
+constexpr unsigned c_tableBits = 11;
+using Table = std::array<uint8_t, 1 << c_tableBits>;
+
+// funct6 values are classified by the values which decodeFields() discerns
+// between. The representative funct6 of each class is used to generate the
+// table.
+constexpr unsigned c_funct6Class[] = {0b000000, 0b010000, 0b111111};
+
+constexpr unsigned index(uint32_t instr) {
+  const unsigned funct6 = RVInstrField::Funct6::get(instr);
+  const unsigned funct6Class = funct6 == c_funct6Class[0]   ? 0
+                               : funct6 == c_funct6Class[1] ? 1
+                                                            : 2;
+  return (RVInstrField::Opcode::get(instr) >> 2) << 6 |
+         RVInstrField::Funct3::get(instr) << 3 | funct6Class << 1 |
+         ((instr >> 25) & 0b1);
+}
+
+constexpr Table generateTable(bool hasM) {
+  Table table{};
+  for (unsigned i = 0; i < table.size(); ++i) {
+    const uint32_t instr = ((i >> 6) << 2 | 0b11) | ((i >> 3) & 0b111) << 12 |
+                           c_funct6Class[std::min((i >> 1) & 0b11, 2u)] << 26 |
+                           (i & 0b1) << 25;
+    table[i] = decodeFields(instr, hasM);
+  }
+  return table;
+}
+
+// Dispatch tables without/with the M extension.
+inline constexpr std::array<Table, 2> c_tables = {generateTable(false),
+                                                  generateTable(true)};
+
+/// Returns the RVInstr of @p instr. M extension instructions are only decoded
+/// if @p hasM is set.
+inline unsigned decode(uint32_t instr, bool hasM) {
+  if ((instr & 0b11) != 0b11) {
+    return RVInstr::NOP;
+  }
+  return c_tables[hasM][index(instr)];
+}
+
+} // namespace RVDecode
+} // namespace Ripes
+
 namespace vsrtl {
 namespace core {
 using namespace Ripes;
@@ -10,214 +197,17 @@ using namespace Ripes;
 template <unsigned XLEN>
 class Decode : public Component {
 public:
-  void setISA(const std::shared_ptr<ISAInfoBase> &isa) { m_isa = isa; }
+  void setISA(const std::shared_ptr<ISAInfoBase> &isa) {
+    m_hasM = isa && isa->extensionEnabled("M");
+  }
 
   Decode(const std::string &name, SimComponent *parent)
       : Component(name, parent) {
-    opcode << [=] {
-      const auto instrValue = instr.uValue();
-
-      const unsigned l7 = instrValue & 0b1111111;
-
-      // clang-format off
-            switch(l7) {
-            case RVISA::Opcode::LUI: return RVInstr::LUI;
-            case RVISA::Opcode::AUIPC: return RVInstr::AUIPC;
-            case RVISA::Opcode::JAL: return RVInstr::JAL;
-            case RVISA::Opcode::JALR: return RVInstr::JALR;
-            case RVISA::Opcode::ECALL: return RVInstr::ECALL;
-
-            case RVISA::Opcode::OPIMM: {
-                // I-Type
-                const auto fields = RVInstrParser::getParser()->decodeI32Instr(instrValue);
-                switch(fields[2]) {
-                case 0b000: return RVInstr::ADDI;
-                case 0b010: return RVInstr::SLTI;
-                case 0b011: return RVInstr::SLTIU;
-                case 0b100: return RVInstr::XORI;
-                case 0b110: return RVInstr::ORI;
-                case 0b111: return RVInstr::ANDI;
-                case 0b001: return RVInstr::SLLI;
-                case 0b101: {
-                    switch (instrValue >> 26) {
-                    case 0b000000: return RVInstr::SRLI;
-                    case 0b010000: return RVInstr::SRAI;
-                    }
-                }
-                default: break;
-                }
-                break;
-            }
-
-            case RVISA::Opcode::OPIMM32: {
-                // I-Type (32-bit, in 64-bit ISA)
-                const auto fields = RVInstrParser::getParser()->decodeI32Instr(instrValue);
-                switch(fields[2]) {
-                case 0b000: return RVInstr::ADDIW;
-                case 0b001: return RVInstr::SLLIW;
-                case 0b101: {
-                    switch (instrValue >> 26) {
-                    case 0b000000: return RVInstr::SRLIW;
-                    case 0b010000: return RVInstr::SRAIW;
-                    }
-                }
-                default: break;
-                }
-                break;
-            }
-
-            case RVISA::Opcode::OP: {
-                // R-Type
-                const auto fields = RVInstrParser::getParser()->decodeR32Instr(instrValue);
-                if (fields[0] == 0b0000001) {
-                    if(m_isa && m_isa->extensionEnabled("M")) {
-                        // RV32M Standard extension
-                        switch (fields[3]) {
-                            case 0b000: return RVInstr::MUL;
-                            case 0b001: return RVInstr::MULH;
-                            case 0b010: return RVInstr::MULHSU;
-                            case 0b011: return RVInstr::MULHU;
-                            case 0b100: return RVInstr::DIV;
-                            case 0b101: return RVInstr::DIVU;
-                            case 0b110: return RVInstr::REM;
-                            case 0b111: return RVInstr::REMU;
-                            default: break;
-                        }
-                    }
-                } else {
-                    switch (fields[3]) {
-                        case 0b000: {
-                            switch (fields[0]) {
-                                case 0b0000000: return RVInstr::ADD;
-                                case 0b0100000: return RVInstr::SUB;
-                                default: return RVInstr::NOP;
-                            }
-                        }
-                        case 0b001: return RVInstr::SLL;
-                        case 0b010: return RVInstr::SLT;
-                        case 0b011: return RVInstr::SLTU;
-                        case 0b100: return RVInstr::XOR;
-                        case 0b101: {
-                            switch (fields[0]) {
-                                case 0b0000000: return RVInstr::SRL;
-                                case 0b0100000: return RVInstr::SRA;
-                                default: return RVInstr::NOP;
-                            }
-                        }
-                        case 0b110: return RVInstr::OR;
-                        case 0b111: return RVInstr::AND;
-                        default: break;
-                    }
-                    break;
-                }
-                break;
-            }
-
-            case RVISA::Opcode::OP32: {
-                // R-Type (32-bit, in 64-bit ISA)
-                const auto fields = RVInstrParser::getParser()->decodeR32Instr(instrValue);
-                if (fields[0] == 0b0000001) {
-                    if(m_isa && m_isa->extensionEnabled("M")) {
-                        // RV64M Standard extension
-                        switch (fields[3]) {
-                            case 0b000: return RVInstr::MULW;
-                            case 0b100: return RVInstr::DIVW;
-                            case 0b101: return RVInstr::DIVUW;
-                            case 0b110: return RVInstr::REMW;
-                            case 0b111: return RVInstr::REMUW;
-                            default: break;
-                        }
-                    }
-                } else {
-                    switch (fields[3]) {
-                        case 0b000: {
-                            switch (fields[0]) {
-                                case 0b0000000: return RVInstr::ADDW;
-                                case 0b0100000: return RVInstr::SUBW;
-                                default: return RVInstr::NOP;
-                            }
-                        }
-                        case 0b001: return RVInstr::SLLW;
-                        case 0b101: {
-                            switch (fields[0]) {
-                                case 0b0000000: return RVInstr::SRLW;
-                                case 0b0100000: return RVInstr::SRAW;
-                                default: return RVInstr::NOP;
-                            }
-                        }
-                        default: break;
-                    }
-                    break;
-                }
-                break;
-            }
-
-            case RVISA::Opcode::LOAD: {
-                // Load instruction
-                const auto fields = RVInstrParser::getParser()->decodeI32Instr(instrValue);
-                switch (fields[2]) {
-                    case 0b000: return RVInstr::LB;
-                    case 0b001: return RVInstr::LH;
-                    case 0b010: return RVInstr::LW;
-                    case 0b100: return RVInstr::LBU;
-                    case 0b101: return RVInstr::LHU;
-                    case 0b110: return RVInstr::LWU;
-                    case 0b011: return RVInstr::LD;
-                    default: break;
-                }
-                break;
-            }
-
-            case RVISA::Opcode::STORE: {
-                // Store instructions
-                const auto fields = RVInstrParser::getParser()->decodeS32Instr(instrValue);
-                switch (fields[3]) {
-                    case 0b000: return RVInstr::SB;
-                    case 0b001: return RVInstr::SH;
-                    case 0b010: return RVInstr::SW;
-                    case 0b011: return RVInstr::SD;
-                    default: break;
-                }
-                break;
-            }
-
-            case RVISA::Opcode::BRANCH: {
-                // Branch instruction
-                const auto fields = RVInstrParser::getParser()->decodeB32Instr(instrValue);
-                switch (fields[4]) {
-                    case 0b000: return RVInstr::BEQ;
-                    case 0b001: return RVInstr::BNE;
-                    case 0b100: return RVInstr::BLT;
-                    case 0b101: return RVInstr::BGE;
-                    case 0b110: return RVInstr::BLTU;
-                    case 0b111: return RVInstr::BGEU;
-                    default: break;
-                }
-                break;
-            }
-
-
-            default:
-                break;
-            }
-
-            // Fallthrough - unknown instruction.
-            return RVInstr::NOP;
-        };
-
-        wr_reg_idx << [=] {
-          return (instr.uValue() >> 7) & 0b11111;
-        };
-
-        r1_reg_idx << [=] {
-          return (instr.uValue() >> 15) & 0b11111;
-        };
-
-        r2_reg_idx << [=] {
-          return (instr.uValue() >> 20) & 0b11111;
-        };
-
-    // clang-format on
+    opcode << [=] { return RVDecode::decode(instr.uValue(), m_hasM); };
+
+    wr_reg_idx << [=] { return RVInstrField::Rd::get(instr.uValue()); };
+    r1_reg_idx << [=] { return RVInstrField::Rs1::get(instr.uValue()); };
+    r2_reg_idx << [=] { return RVInstrField::Rs2::get(instr.uValue()); };
   }
 
   INPUTPORT(instr, c_RVInstrWidth);
@@ -227,8 +217,9 @@ public:
   OUTPUTPORT(r2_reg_idx, c_RVRegsBits);
 
 private:
-  void unknownInstruction() {}
-  std::shared_ptr<ISAInfoBase> m_isa;
+  // Cached, as the enabled extensions are not to be looked up on every
+  // propagation.
+  bool m_hasM = false;
 };
 
 } // namespace core
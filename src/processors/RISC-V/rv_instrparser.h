@@ -7,6 +7,21 @@
 
 namespace Ripes {
 
+/**
+ * @brief The InstrField struct
+ * Compile-time extractor of the @p Width bits wide field starting at bit @p Lsb
+ * of a 32-bit instruction word.
+ */
+template <unsigned Lsb, unsigned Width>
+struct InstrField {
+  static_assert(Width > 0 && Lsb + Width <= 32,
+                "Field exceeds the instruction word");
+  static constexpr uint32_t mask = (1ull << Width) - 1;
+  static constexpr uint32_t get(uint32_t instr) {
+    return (instr >> Lsb) & mask;
+  }
+};
+
 template <typename T>
 using decode_functor = std::function<std::vector<T>(T)>;
 
@@ -0,0 +1,737 @@
+#pragma once
+
+#include <array>
+#include <climits>
+#include <limits>
+#include <vector>
+
+#include "VSRTL/core/vsrtl_addressspace.h"
+
+#include "../../interface/ripesprocessor.h"
+#include "../riscv.h"
+#include "../rv_uncompress.h"
+
+namespace Ripes {
+
+/**
+ * @brief The RVISS class
+ * A functional instruction-set simulator, executing one instruction per cycle.
+ * As opposed to the VSRTL processor models, the ISS does not model any
+ * datapath; instructions are predecoded into a direct-mapped decode cache and
+ * executed by a dispatch loop over a flat register array. The ISS is intended
+ * for long-running programs, where the structure of the processor is of no
+ * interest, but the memory access stream (caches) and the system call
+ * environment are.
+ *
+ * The memory accesses reported through dataMemAccess()/instrMemAccess() are
+ * those of the instruction which is executed in the following cycle, in line
+ * with the single-cycle VSRTL processor. The ISS is not reversible.
+ */
+template <typename XLEN_T>
+class RVISS : public RipesProcessor {
+  static_assert(std::is_same<uint32_t, XLEN_T>::value ||
+                    std::is_same<uint64_t, XLEN_T>::value,
+                "Only supports 32- and 64-bit variants");
+  static constexpr unsigned XLEN = sizeof(XLEN_T) * CHAR_BIT;
+  using SXLEN_T = typename std::make_signed<XLEN_T>::type;
+
+public:
+  RVISS(const QStringList &extensions) {
+    m_features = Features::hasICacheInterface | Features::hasDCacheInterface;
+    m_enabledISA = std::make_shared<ISAInfo<XLenToRVISA<XLEN>()>>(extensions);
+    m_hasM = m_enabledISA->extensionEnabled("M");
+    m_hasC = m_enabledISA->extensionEnabled("C");
+    m_decodeCache.resize(s_decodeCacheSize);
+  }
+
+  // Ripes interface compliance
+  const ProcessorStructure &structure() const override { return m_structure; }
+  unsigned int getPcForStage(StageIndex) const override { return m_pc; }
+  AInt nextFetchedAddress() const override {
+    const DecodedInstr &instr = decode(m_pc);
+    const XLEN_T rs1 = m_regs[instr.rs1];
+    const XLEN_T rs2 = m_regs[instr.rs2];
+    switch (instr.op) {
+    case RVInstr::JAL:
+      return static_cast<XLEN_T>(m_pc + instr.imm);
+    case RVInstr::JALR:
+      return static_cast<XLEN_T>((rs1 + instr.imm) & ~XLEN_T(1));
+    case RVInstr::BEQ:
+    case RVInstr::BNE:
+    case RVInstr::BLT:
+    case RVInstr::BGE:
+    case RVInstr::BLTU:
+    case RVInstr::BGEU:
+      if (branchTaken(instr.op, rs1, rs2)) {
+        return static_cast<XLEN_T>(m_pc + instr.imm);
+      }
+      break;
+    default:
+      break;
+    }
+    return static_cast<XLEN_T>(m_pc + instr.size);
+  }
+  QString stageName(StageIndex) const override { return "•"; }
+  StageInfo stageInfo(StageIndex) const override {
+    return StageInfo(
+        {m_pc, decode(m_pc).executable, StageInfo::State::None});
+  }
+  void setProgramCounter(AInt address) override { m_pc = address; }
+  void setPCInitialValue(AInt address) override { m_pcInitialValue = address; }
+  vsrtl::core::AddressSpaceMM &getMemory() override { return *m_memory; }
+  VInt getRegister(RegisterFileType rfid, unsigned i) const override {
+    return rfid == RegisterFileType::GPR ? m_regs.at(i) : 0;
+  }
+  void setRegister(RegisterFileType rfid, unsigned i, VInt v) override {
+    if (rfid == RegisterFileType::GPR && i != 0) {
+      m_regs.at(i) = static_cast<XLEN_T>(v);
+    }
+  }
+  void finalize(FinalizeReason fr) override {
+    if (fr == FinalizeReason::exitSyscall) {
+      // Finalization is requested while executing the exit system call, which
+      // thereby is the final instruction to be executed.
+      m_finished = true;
+    }
+  }
+  bool finished() const override {
+    return m_finished || !decode(m_pc).executable;
+  }
+  const std::vector<StageIndex> breakpointTriggeringStages() const override {
+    return {{0, 0}};
+  }
+  StageIndex dataMemAccessStage() const override { return {0, 0}; }
+
+  MemoryAccess dataMemAccess() const override {
+    const DecodedInstr &instr = decode(m_pc);
+    MemoryAccess access;
+    access.bytes = memoryBytes(instr.op);
+    if (access.bytes != 0) {
+      access.type =
+          isStore(instr.op) ? MemoryAccess::Write : MemoryAccess::Read;
+      access.address = static_cast<XLEN_T>(m_regs[instr.rs1] + instr.imm);
+    }
+    return access;
+  }
+  MemoryAccess instrMemAccess() const override {
+    MemoryAccess access;
+    access.type = MemoryAccess::Read;
+    access.address = m_pc;
+    access.bytes = decode(m_pc).size;
+    return access;
+  }
+
+  void resetProcessor() override {
+    if (m_memory == &m_ownMemory) {
+      m_memory->reset();
+    }
+    m_regs.fill(0);
+    m_pc = m_pcInitialValue;
+    m_cycleCount = 0;
+    m_instructionsRetired = 0;
+    m_finished = false;
+    invalidateDecodeCache();
+    if (m_emitsSignals) {
+      processorWasReset.Emit();
+    }
+  }
+
+  long long getInstructionsRetired() const override {
+    return m_instructionsRetired;
+  }
+  long long getCycleCount() const override { return m_cycleCount; }
+
+  static ProcessorISAInfo supportsISA() {
+    return ProcessorISAInfo{
+        std::make_shared<ISAInfo<XLenToRVISA<XLEN>()>>(QStringList()),
+        {"M", "C"},
+        {"M"}};
+  }
+  const ISAInfoBase *implementsISA() const override {
+    return m_enabledISA.get();
+  }
+  const std::set<RegisterFileType> registerFiles() const override {
+    return {RegisterFileType::GPR};
+  }
+
+  /**
+   * @brief shareMemory
+   * Executes on @p memory instead of the memory of the simulator itself, ie.
+   * the memory of another processor model to which architectural state is
+   * transferred. A shared memory is not reset alongside the processor.
+   */
+  void shareMemory(vsrtl::core::AddressSpaceMM &memory) {
+    m_memory = &memory;
+    invalidateDecodeCache();
+  }
+
+protected:
+  void clockProcessor() override {
+    const DecodedInstr &instr = decode(m_pc);
+    const XLEN_T rs1 = m_regs[instr.rs1];
+    const XLEN_T rs2 = m_regs[instr.rs2];
+    const XLEN_T imm = instr.imm;
+    XLEN_T &rd = m_regs[instr.rd];
+    XLEN_T nextPc = m_pc + instr.size;
+
+    switch (instr.op) {
+    // RV32I
+    case RVInstr::LUI:
+      rd = imm;
+      break;
+    case RVInstr::AUIPC:
+      rd = m_pc + imm;
+      break;
+    case RVInstr::JAL:
+      rd = nextPc;
+      nextPc = m_pc + imm;
+      break;
+    case RVInstr::JALR: {
+      const XLEN_T target = (rs1 + imm) & ~XLEN_T(1);
+      rd = nextPc;
+      nextPc = target;
+      break;
+    }
+    case RVInstr::BEQ:
+    case RVInstr::BNE:
+    case RVInstr::BLT:
+    case RVInstr::BGE:
+    case RVInstr::BLTU:
+    case RVInstr::BGEU:
+      if (branchTaken(instr.op, rs1, rs2)) {
+        nextPc = m_pc + imm;
+      }
+      break;
+    case RVInstr::LB:
+      rd = sext<8>(load(rs1 + imm, 1));
+      break;
+    case RVInstr::LH:
+      rd = sext<16>(load(rs1 + imm, 2));
+      break;
+    case RVInstr::LW:
+      rd = sext<32>(load(rs1 + imm, 4));
+      break;
+    case RVInstr::LBU:
+      rd = load(rs1 + imm, 1) & 0xFF;
+      break;
+    case RVInstr::LHU:
+      rd = load(rs1 + imm, 2) & 0xFFFF;
+      break;
+    case RVInstr::SB:
+      store(rs1 + imm, rs2, 1);
+      break;
+    case RVInstr::SH:
+      store(rs1 + imm, rs2, 2);
+      break;
+    case RVInstr::SW:
+      store(rs1 + imm, rs2, 4);
+      break;
+    case RVInstr::ADDI:
+      rd = rs1 + imm;
+      break;
+    case RVInstr::SLTI:
+      rd = static_cast<SXLEN_T>(rs1) < static_cast<SXLEN_T>(imm);
+      break;
+    case RVInstr::SLTIU:
+      rd = rs1 < imm;
+      break;
+    case RVInstr::XORI:
+      rd = rs1 ^ imm;
+      break;
+    case RVInstr::ORI:
+      rd = rs1 | imm;
+      break;
+    case RVInstr::ANDI:
+      rd = rs1 & imm;
+      break;
+    case RVInstr::SLLI:
+      rd = rs1 << (imm & (XLEN - 1));
+      break;
+    case RVInstr::SRLI:
+      rd = rs1 >> (imm & (XLEN - 1));
+      break;
+    case RVInstr::SRAI:
+      rd = static_cast<SXLEN_T>(rs1) >> (imm & (XLEN - 1));
+      break;
+    case RVInstr::ADD:
+      rd = rs1 + rs2;
+      break;
+    case RVInstr::SUB:
+      rd = rs1 - rs2;
+      break;
+    case RVInstr::SLL:
+      rd = rs1 << (rs2 & (XLEN - 1));
+      break;
+    case RVInstr::SLT:
+      rd = static_cast<SXLEN_T>(rs1) < static_cast<SXLEN_T>(rs2);
+      break;
+    case RVInstr::SLTU:
+      rd = rs1 < rs2;
+      break;
+    case RVInstr::XOR:
+      rd = rs1 ^ rs2;
+      break;
+    case RVInstr::SRL:
+      rd = rs1 >> (rs2 & (XLEN - 1));
+      break;
+    case RVInstr::SRA:
+      rd = static_cast<SXLEN_T>(rs1) >> (rs2 & (XLEN - 1));
+      break;
+    case RVInstr::OR:
+      rd = rs1 | rs2;
+      break;
+    case RVInstr::AND:
+      rd = rs1 & rs2;
+      break;
+    case RVInstr::ECALL:
+      // The system call may modify both registers and memory (including
+      // instruction memory).
+      trapHandler();
+      invalidateDecodeCache();
+      break;
+
+    // RV32M
+    case RVInstr::MUL:
+      rd = rs1 * rs2;
+      break;
+    case RVInstr::MULH:
+      rd = mulhu(rs1, rs2) - (static_cast<SXLEN_T>(rs1) < 0 ? rs2 : 0) -
+           (static_cast<SXLEN_T>(rs2) < 0 ? rs1 : 0);
+      break;
+    case RVInstr::MULHSU:
+      rd = mulhu(rs1, rs2) - (static_cast<SXLEN_T>(rs1) < 0 ? rs2 : 0);
+      break;
+    case RVInstr::MULHU:
+      rd = mulhu(rs1, rs2);
+      break;
+    case RVInstr::DIV:
+      rd = div(rs1, rs2);
+      break;
+    case RVInstr::DIVU:
+      rd = rs2 == 0 ? ~XLEN_T(0) : rs1 / rs2;
+      break;
+    case RVInstr::REM:
+      rd = rem(rs1, rs2);
+      break;
+    case RVInstr::REMU:
+      rd = rs2 == 0 ? rs1 : rs1 % rs2;
+      break;
+
+    // RV64I
+    case RVInstr::ADDIW:
+      rd = sext<32>(rs1 + imm);
+      break;
+    case RVInstr::SLLIW:
+      rd = sext<32>(static_cast<uint32_t>(rs1) << (imm & 0x1F));
+      break;
+    case RVInstr::SRLIW:
+      rd = sext<32>(static_cast<uint32_t>(rs1) >> (imm & 0x1F));
+      break;
+    case RVInstr::SRAIW:
+      rd = sext<32>(static_cast<int32_t>(rs1) >> (imm & 0x1F));
+      break;
+    case RVInstr::ADDW:
+      rd = sext<32>(rs1 + rs2);
+      break;
+    case RVInstr::SUBW:
+      rd = sext<32>(rs1 - rs2);
+      break;
+    case RVInstr::SLLW:
+      rd = sext<32>(static_cast<uint32_t>(rs1) << (rs2 & 0x1F));
+      break;
+    case RVInstr::SRLW:
+      rd = sext<32>(static_cast<uint32_t>(rs1) >> (rs2 & 0x1F));
+      break;
+    case RVInstr::SRAW:
+      rd = sext<32>(static_cast<int32_t>(rs1) >> (rs2 & 0x1F));
+      break;
+    case RVInstr::LWU:
+      rd = load(rs1 + imm, 4) & 0xFFFFFFFF;
+      break;
+    case RVInstr::LD:
+      rd = load(rs1 + imm, 8);
+      break;
+    case RVInstr::SD:
+      store(rs1 + imm, rs2, 8);
+      break;
+
+    // RV64M
+    case RVInstr::MULW:
+      rd = sext<32>(rs1 * rs2);
+      break;
+    case RVInstr::DIVW:
+      rd = sext<32>(div<uint32_t>(rs1, rs2));
+      break;
+    case RVInstr::DIVUW:
+      rd = sext<32>(static_cast<uint32_t>(rs2) == 0
+                        ? ~uint32_t(0)
+                        : static_cast<uint32_t>(rs1) /
+                              static_cast<uint32_t>(rs2));
+      break;
+    case RVInstr::REMW:
+      rd = sext<32>(rem<uint32_t>(rs1, rs2));
+      break;
+    case RVInstr::REMUW:
+      rd = sext<32>(static_cast<uint32_t>(rs2) == 0
+                        ? static_cast<uint32_t>(rs1)
+                        : static_cast<uint32_t>(rs1) %
+                              static_cast<uint32_t>(rs2));
+      break;
+
+    default:
+      // Unknown instructions are executed as NOPs, as in the VSRTL models.
+      break;
+    }
+
+    m_regs[0] = 0;
+    m_pc = nextPc;
+    m_cycleCount++;
+    m_instructionsRetired++;
+    if (m_emitsSignals) {
+      processorWasClocked.Emit();
+    }
+  }
+
+private:
+  /**
+   * @brief The DecodedInstr struct
+   * A predecoded instruction. Compressed instructions are expanded during
+   * predecoding, and immediates are sign-extended to XLEN.
+   */
+  struct DecodedInstr {
+    AInt pc = 0;
+    // Decode cache generation which the entry is valid for (0 = invalid).
+    uint32_t generation = 0;
+    unsigned op = RVInstr::NOP;
+    uint8_t rd = 0;
+    uint8_t rs1 = 0;
+    uint8_t rs2 = 0;
+    // Size of the instruction in bytes.
+    uint8_t size = 4;
+    // Whether the instruction is within the executable address range.
+    bool executable = false;
+    XLEN_T imm = 0;
+  };
+
+  static constexpr unsigned s_decodeCacheSize = 1 << 15;
+
+  const DecodedInstr &decode(AInt pc) const {
+    DecodedInstr &entry = m_decodeCache[(pc >> 1) & (s_decodeCacheSize - 1)];
+    if (entry.pc != pc || entry.generation != m_generation) {
+      predecode(entry, pc);
+    }
+    return entry;
+  }
+
+  void predecode(DecodedInstr &entry, AInt pc) const {
+    uint32_t instr = m_memory->readMemConst(pc, 4);
+    entry = DecodedInstr();
+    entry.pc = pc;
+    entry.generation = m_generation;
+    entry.executable = isExecutableAddress && isExecutableAddress(pc);
+    if (m_hasC && (instr & 0b11) != 0b11 && instr != 0) {
+      entry.size = 2;
+      instr = vsrtl::core::uncompressRVC(instr & 0xFFFF, XLenToRVISA<XLEN>());
+    }
+
+    entry.rd = (instr >> 7) & 0x1F;
+    entry.rs1 = (instr >> 15) & 0x1F;
+    entry.rs2 = (instr >> 20) & 0x1F;
+    const unsigned funct3 = (instr >> 12) & 0b111;
+    const unsigned funct7 = instr >> 25;
+    const bool rv64 = XLEN == 64;
+
+    // Sign-extended immediates of each instruction format
+    const int32_t immI = static_cast<int32_t>(instr) >> 20;
+    const int32_t immS = ((static_cast<int32_t>(instr) >> 25) << 5) |
+                         ((instr >> 7) & 0x1F);
+    const int32_t immB = ((static_cast<int32_t>(instr) >> 31) << 12) |
+                         ((instr & 0x80) << 4) | ((instr >> 20) & 0x7E0) |
+                         ((instr >> 7) & 0x1E);
+    const int32_t immU = static_cast<int32_t>(instr & 0xFFFFF000);
+    const int32_t immJ = ((static_cast<int32_t>(instr) >> 31) << 20) |
+                         (instr & 0xFF000) | ((instr >> 9) & 0x800) |
+                         ((instr >> 20) & 0x7FE);
+
+    int32_t imm = 0;
+    unsigned op = RVInstr::NOP;
+    switch (instr & 0x7F) {
+    case RVISA::Opcode::LUI:
+      op = RVInstr::LUI;
+      imm = immU;
+      break;
+    case RVISA::Opcode::AUIPC:
+      op = RVInstr::AUIPC;
+      imm = immU;
+      break;
+    case RVISA::Opcode::JAL:
+      op = RVInstr::JAL;
+      imm = immJ;
+      break;
+    case RVISA::Opcode::JALR:
+      op = RVInstr::JALR;
+      imm = immI;
+      break;
+    case RVISA::Opcode::ECALL:
+      // Other SYSTEM instructions (ebreak, CSR accesses) are not supported,
+      // and as such are not executed, as any other unsupported encoding.
+      if (funct3 == 0 && immI == 0 && entry.rd == 0 && entry.rs1 == 0) {
+        op = RVInstr::ECALL;
+      }
+      break;
+    case RVISA::Opcode::BRANCH: {
+      static constexpr unsigned ops[] = {
+          RVInstr::BEQ, RVInstr::BNE, RVInstr::NOP,  RVInstr::NOP,
+          RVInstr::BLT, RVInstr::BGE, RVInstr::BLTU, RVInstr::BGEU};
+      op = ops[funct3];
+      imm = immB;
+      break;
+    }
+    case RVISA::Opcode::LOAD: {
+      static constexpr unsigned ops[] = {
+          RVInstr::LB,  RVInstr::LH,  RVInstr::LW,  RVInstr::LD,
+          RVInstr::LBU, RVInstr::LHU, RVInstr::LWU, RVInstr::NOP};
+      op = ops[funct3];
+      if (!rv64 && (op == RVInstr::LD || op == RVInstr::LWU)) {
+        op = RVInstr::NOP;
+      }
+      imm = immI;
+      break;
+    }
+    case RVISA::Opcode::STORE: {
+      static constexpr unsigned ops[] = {
+          RVInstr::SB,  RVInstr::SH,  RVInstr::SW,  RVInstr::SD,
+          RVInstr::NOP, RVInstr::NOP, RVInstr::NOP, RVInstr::NOP};
+      op = ops[funct3];
+      if (!rv64 && op == RVInstr::SD) {
+        op = RVInstr::NOP;
+      }
+      imm = immS;
+      break;
+    }
+    case RVISA::Opcode::OPIMM: {
+      static constexpr unsigned ops[] = {
+          RVInstr::ADDI, RVInstr::SLLI, RVInstr::SLTI, RVInstr::SLTIU,
+          RVInstr::XORI, RVInstr::SRLI, RVInstr::ORI,  RVInstr::ANDI};
+      op = ops[funct3];
+      if (funct3 == 0b101 && (instr >> 26) == 0b010000) {
+        op = RVInstr::SRAI;
+      }
+      imm = immI;
+      break;
+    }
+    case RVISA::Opcode::OPIMM32: {
+      if (!rv64) {
+        break;
+      }
+      switch (funct3) {
+      case 0b000:
+        op = RVInstr::ADDIW;
+        break;
+      case 0b001:
+        op = RVInstr::SLLIW;
+        break;
+      case 0b101:
+        op = (instr >> 26) == 0b010000 ? RVInstr::SRAIW : RVInstr::SRLIW;
+        break;
+      default:
+        break;
+      }
+      imm = immI;
+      break;
+    }
+    case RVISA::Opcode::OP: {
+      if (funct7 == 0b0000001) {
+        static constexpr unsigned ops[] = {
+            RVInstr::MUL, RVInstr::MULH, RVInstr::MULHSU, RVInstr::MULHU,
+            RVInstr::DIV, RVInstr::DIVU, RVInstr::REM,    RVInstr::REMU};
+        if (m_hasM) {
+          op = ops[funct3];
+        }
+      } else {
+        static constexpr unsigned ops[] = {
+            RVInstr::ADD, RVInstr::SLL, RVInstr::SLT, RVInstr::SLTU,
+            RVInstr::XOR, RVInstr::SRL, RVInstr::OR,  RVInstr::AND};
+        op = ops[funct3];
+        if (funct7 == 0b0100000) {
+          op = funct3 == 0b000   ? RVInstr::SUB
+               : funct3 == 0b101 ? RVInstr::SRA
+                                 : RVInstr::NOP;
+        }
+      }
+      break;
+    }
+    case RVISA::Opcode::OP32: {
+      if (!rv64) {
+        break;
+      }
+      if (funct7 == 0b0000001) {
+        static constexpr unsigned ops[] = {
+            RVInstr::MULW, RVInstr::NOP,   RVInstr::NOP,  RVInstr::NOP,
+            RVInstr::DIVW, RVInstr::DIVUW, RVInstr::REMW, RVInstr::REMUW};
+        if (m_hasM) {
+          op = ops[funct3];
+        }
+      } else {
+        switch (funct3) {
+        case 0b000:
+          op = funct7 == 0b0100000 ? RVInstr::SUBW : RVInstr::ADDW;
+          break;
+        case 0b001:
+          op = RVInstr::SLLW;
+          break;
+        case 0b101:
+          op = funct7 == 0b0100000 ? RVInstr::SRAW : RVInstr::SRLW;
+          break;
+        default:
+          break;
+        }
+      }
+      break;
+    }
+    default:
+      break;
+    }
+
+    entry.op = op;
+    entry.imm = static_cast<XLEN_T>(static_cast<SXLEN_T>(imm));
+  }
+
+  /**
+   * @brief invalidateDecodeCache
+   * Invalidates all predecoded instructions, ie. when memory may have been
+   * modified from outside of the processor.
+   */
+  void invalidateDecodeCache() { m_generation++; }
+
+  XLEN_T load(XLEN_T address, unsigned bytes) {
+    return static_cast<XLEN_T>(m_memory->readMem(address, bytes));
+  }
+
+  void store(XLEN_T address, XLEN_T value, unsigned bytes) {
+    m_memory->writeMem(address, value, bytes);
+    // Invalidate any predecoded instruction overlapping the written bytes
+    // (instructions are at least 2-byte aligned, and at most 4 bytes wide).
+    for (AInt pc = (address - 2) & ~AInt(1); pc < AInt(address) + bytes;
+         pc += 2) {
+      DecodedInstr &entry = m_decodeCache[(pc >> 1) & (s_decodeCacheSize - 1)];
+      if (entry.pc == pc) {
+        entry.generation = 0;
+      }
+    }
+  }
+
+  template <unsigned bits, typename T>
+  static XLEN_T sext(T value) {
+    using S = typename std::conditional<
+        bits == 8, int8_t,
+        typename std::conditional<bits == 16, int16_t, int32_t>::type>::type;
+    return static_cast<XLEN_T>(static_cast<SXLEN_T>(static_cast<S>(value)));
+  }
+
+  static bool branchTaken(unsigned op, XLEN_T rs1, XLEN_T rs2) {
+    switch (op) {
+    case RVInstr::BEQ:
+      return rs1 == rs2;
+    case RVInstr::BNE:
+      return rs1 != rs2;
+    case RVInstr::BLT:
+      return static_cast<SXLEN_T>(rs1) < static_cast<SXLEN_T>(rs2);
+    case RVInstr::BGE:
+      return static_cast<SXLEN_T>(rs1) >= static_cast<SXLEN_T>(rs2);
+    case RVInstr::BLTU:
+      return rs1 < rs2;
+    case RVInstr::BGEU:
+      return rs1 >= rs2;
+    default:
+      return false;
+    }
+  }
+
+  /// Returns the upper XLEN bits of the unsigned product of @p a and @p b.
+  static XLEN_T mulhu(XLEN_T a, XLEN_T b) {
+    if constexpr (XLEN == 32) {
+      return (static_cast<uint64_t>(a) * b) >> 32;
+    } else {
+      const uint64_t aLo = a & 0xFFFFFFFF, aHi = a >> 32;
+      const uint64_t bLo = b & 0xFFFFFFFF, bHi = b >> 32;
+      const uint64_t lolo = aLo * bLo, lohi = aLo * bHi;
+      const uint64_t hilo = aHi * bLo, hihi = aHi * bHi;
+      const uint64_t mid =
+          (lolo >> 32) + (lohi & 0xFFFFFFFF) + (hilo & 0xFFFFFFFF);
+      return hihi + (lohi >> 32) + (hilo >> 32) + (mid >> 32);
+    }
+  }
+
+  /// Signed division of @p a and @p b, as defined by the M extension.
+  template <typename T = XLEN_T>
+  static T div(T a, T b) {
+    using S = typename std::make_signed<T>::type;
+    if (b == 0) {
+      return ~T(0);
+    } else if (static_cast<S>(a) == std::numeric_limits<S>::min() &&
+               static_cast<S>(b) == -1) {
+      return a;
+    }
+    return static_cast<T>(static_cast<S>(a) / static_cast<S>(b));
+  }
+
+  /// Signed remainder of @p a and @p b, as defined by the M extension.
+  template <typename T = XLEN_T>
+  static T rem(T a, T b) {
+    using S = typename std::make_signed<T>::type;
+    if (b == 0) {
+      return a;
+    } else if (static_cast<S>(a) == std::numeric_limits<S>::min() &&
+               static_cast<S>(b) == -1) {
+      return 0;
+    }
+    return static_cast<T>(static_cast<S>(a) % static_cast<S>(b));
+  }
+
+  static unsigned memoryBytes(unsigned op) {
+    switch (op) {
+    case RVInstr::LB:
+    case RVInstr::LBU:
+    case RVInstr::SB:
+      return 1;
+    case RVInstr::LH:
+    case RVInstr::LHU:
+    case RVInstr::SH:
+      return 2;
+    case RVInstr::LW:
+    case RVInstr::LWU:
+    case RVInstr::SW:
+      return 4;
+    case RVInstr::LD:
+    case RVInstr::SD:
+      return 8;
+    default:
+      return 0;
+    }
+  }
+
+  static bool isStore(unsigned op) {
+    return op == RVInstr::SB || op == RVInstr::SH || op == RVInstr::SW ||
+           op == RVInstr::SD;
+  }
+
+  vsrtl::core::AddressSpaceMM m_ownMemory;
+  vsrtl::core::AddressSpaceMM *m_memory = &m_ownMemory;
+  std::array<XLEN_T, c_RVRegs> m_regs{};
+  XLEN_T m_pc = 0;
+  XLEN_T m_pcInitialValue = 0;
+  long long m_cycleCount = 0;
+  long long m_instructionsRetired = 0;
+  bool m_finished = false;
+
+  mutable std::vector<DecodedInstr> m_decodeCache;
+  uint32_t m_generation = 1;
+
+  bool m_hasM = false;
+  bool m_hasC = false;
+  std::shared_ptr<ISAInfoBase> m_enabledISA;
+  ProcessorStructure m_structure = {{0, 1}};
+};
+
+} // namespace Ripes
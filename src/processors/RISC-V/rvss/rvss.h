@@ -194,6 +194,7 @@ public:
   const std::vector<StageIndex> breakpointTriggeringStages() const override {
     return {{0, 0}};
   }
+  StageIndex dataMemAccessStage() const override { return {0, 0}; }
 
   MemoryAccess dataMemAccess() const override {
     return memToAccessInfo(data_mem);
@@ -5,6 +5,7 @@
 #include "Signals/Signal.h"
 #include "VSRTL/core/vsrtl_design.h"
 #include <map>
+#include <optional>
 
 #include "../../isa/isainfo.h"
 #include "../../ripes_types.h"
@@ -212,6 +213,13 @@ public:
    */
   virtual const std::vector<StageIndex> breakpointTriggeringStages() const = 0;
 
+  /**
+   * @brief dataMemAccessStage
+   * @returns the stage holding the instruction which performs the access
+   * reported by dataMemAccess().
+   */
+  virtual StageIndex dataMemAccessStage() const = 0;
+
   /**
    * @brief getMemory
    * @return reference to the address space utilized by the implementing
@@ -228,6 +236,19 @@ public:
   virtual MemoryAccess dataMemAccess() const = 0;
   virtual MemoryAccess instrMemAccess() const = 0;
 
+  /**
+   * @brief registerWriteValue
+   * @returns the value which the instruction in stage @p stageIndex writes to
+   * its destination register when retiring in the next clock cycle, if known.
+   * Processors which may retire multiple instructions writing the same register
+   * within a cycle should implement this; otherwise, the value is read from the
+   * register file after the cycle.
+   */
+  virtual std::optional<VInt> registerWriteValue(StageIndex stageIndex) const {
+    Q_UNUSED(stageIndex);
+    return std::nullopt;
+  }
+
   /**
    * @brief getRegister
    * @param rfid: register file identifier
@@ -304,6 +325,25 @@ public:
    */
   virtual long long getCycleCount() const = 0;
 
+  /**
+   * @brief getMemoryStallCycles
+   * @returns the number of cycles which the processor has been stalled by the
+   * memory system, as reported by the memoryStallCycles callback (0 if no
+   * memory timing model is attached).
+   */
+  long long getMemoryStallCycles() const {
+    return memoryStallCycles ? memoryStallCycles() : 0;
+  }
+
+  /**
+   * @brief getTotalCycleCount
+   * @returns the number of cycles which has been executed, including any cycles
+   * stalled on the memory system.
+   */
+  long long getTotalCycleCount() const {
+    return getCycleCount() + getMemoryStallCycles();
+  }
+
   /** ======================= Signals and callbacks ======================= */
   /**
    * @brief clocked, reversed & reset signals
@@ -330,6 +370,17 @@ public:
    */
   std::function<void(void)> trapHandler;
 
+  /**
+   * @brief memoryStallCycles
+   * Optional callback through which a memory timing model (ie. a cache
+   * hierarchy with access latencies) reports the total number of cycles that
+   * the processor has been stalled on memory accesses. The processor models
+   * themselves assume single-cycle memories; stall cycles are accounted for on
+   * top of the cycle count of the processor model. The owner of the timing
+   * model must reset the callback before the model is destroyed.
+   */
+  std::function<long long(void)> memoryStallCycles;
+
   /** ======================== FEATURE: Reversible ======================== */
   // Enabled by setting m_features.isReversible = true
 
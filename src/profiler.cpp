@@ -0,0 +1,409 @@
+#include "profiler.h"
+
+#include "cachesim/cachesim.h"
+#include "processorhandler.h"
+#include "processors/RISC-V/rv_uncompress.h"
+#include "simulationcontext.h"
+
+#include <QTextStream>
+
+#include <algorithm>
+
+namespace Ripes {
+
+// Calls beyond this depth are not tracked as separate stack frames, bounding
+// the size of the call tree under deep recursion.
+static constexpr unsigned s_maxCallDepth = 256;
+// Function of the root of the call tree, being the empty stack.
+static constexpr unsigned s_noFunction = ~0u;
+
+Profiler::Profiler(QObject *parent)
+    : QObject(parent), m_context(SimulationContext::current()) {
+  m_cycleObserverID =
+      ProcessorHandler::addCycleObserver([=] { processorWasClocked(); });
+  connect(ProcessorHandler::get(), &ProcessorHandler::processorReset, this,
+          &Profiler::reset);
+  reset();
+}
+
+Profiler::~Profiler() {
+  SimulationContext::Scope scope(m_context);
+  ProcessorHandler::removeCycleObserver(m_cycleObserverID);
+}
+
+void Profiler::setCaches(std::shared_ptr<const CacheSim> icache,
+                         std::shared_ptr<const CacheSim> dcache) {
+  SimulationContext::Scope scope(m_context);
+  m_icache = std::move(icache);
+  m_dcache = std::move(dcache);
+  m_icacheMisses = m_icache ? m_icache->getMisses() : 0;
+  m_dcacheMisses = m_dcache ? m_dcache->getMisses() : 0;
+
+  // Cycle observers are notified in the order in which they were added.
+  ProcessorHandler::removeCycleObserver(m_cycleObserverID);
+  m_cycleObserverID =
+      ProcessorHandler::addCycleObserver([=] { processorWasClocked(); });
+}
+
+QString Profiler::counterName(Counter counter) {
+  switch (counter) {
+  case Cycles:
+    return "cycles";
+  case Retired:
+    return "retired";
+  case Stalls:
+    return "stalls";
+  case Flushes:
+    return "flushes";
+  case ICacheMisses:
+    return "icache misses";
+  case DCacheMisses:
+    return "dcache misses";
+  case NumCounters:
+    break;
+  }
+  Q_UNREACHABLE();
+  return QString();
+}
+
+void Profiler::reset() {
+  const auto *isa = ProcessorHandler::currentISA();
+
+  // Instructions are 2-byte aligned with the compressed extension.
+  const bool compressed = isa->extensionEnabled("C");
+  const unsigned alignment = compressed ? 2 : isa->instrBytes();
+  m_shift = 0;
+  while ((1u << m_shift) < alignment)
+    ++m_shift;
+
+  auto program = ProcessorHandler::getProgram();
+  const auto *text = program ? program->getSection(TEXT_SECTION_NAME) : nullptr;
+  const size_t count = text ? text->data.size() >> m_shift : 0;
+  m_textAddress = text ? text->address : 0;
+  m_textEnd = m_textAddress + (count << m_shift);
+  for (auto &counter : m_counters)
+    counter.assign(count, 0);
+
+  // Functions of the text section, by the symbols of the program. Any
+  // instructions prior to the first symbol are attributed to function 0.
+  m_functionNames = {"[unknown]"};
+  m_functionAddresses = {m_textAddress};
+  if (program) {
+    for (const auto &[address, symbol] : program->symbols) {
+      if (address < m_textAddress || address >= m_textEnd ||
+          symbol.is(Symbol::Constant) || symbol.isLocal())
+        continue;
+      m_functionNames.push_back(symbol.v);
+      m_functionAddresses.push_back(address);
+    }
+  }
+
+  m_control.assign(count, Control::None);
+  m_functionOf.assign(count, 0);
+  const auto *data =
+      text ? reinterpret_cast<const uint8_t *>(text->data.data()) : nullptr;
+  unsigned function = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const AInt address = m_textAddress + (i << m_shift);
+    while (function + 1 < m_functionAddresses.size() &&
+           m_functionAddresses[function + 1] <= address)
+      ++function;
+    m_functionOf[i] = function;
+
+    // Calls and returns are classified up front, such that retired
+    // instructions need not be decoded.
+    const size_t offset = i << m_shift;
+    uint32_t instr = data[offset] | (data[offset + 1] << 8);
+    if ((instr & 0b11) == 0b11) {
+      if (offset + 4 > static_cast<size_t>(text->data.size()))
+        continue;
+      instr |= (data[offset + 2] << 16) | (uint32_t(data[offset + 3]) << 24);
+    } else if (compressed) {
+      instr =
+          vsrtl::core::RVCExpansionTable::get(isa->isaID()).expand(instr);
+    } else {
+      continue;
+    }
+
+    const unsigned opcode = instr & 0x7F;
+    const unsigned rd = (instr >> 7) & 0x1F;
+    const unsigned rs1 = (instr >> 15) & 0x1F;
+    // ra and t0 are the link registers of the calling convention.
+    auto isLink = [](unsigned reg) { return reg == 1 || reg == 5; };
+    if (opcode == 0b1101111 && isLink(rd)) // JAL
+      m_control[i] = Control::Call;
+    else if (opcode == 0b1100111 && isLink(rd)) // JALR
+      m_control[i] = Control::Call;
+    else if (opcode == 0b1100111 && rd == 0 && isLink(rs1))
+      m_control[i] = Control::Return;
+  }
+
+  m_callNodes.clear();
+  CallNode root;
+  root.function = s_noFunction;
+  m_callNodes.push_back(root);
+  m_callNode = 0;
+  m_untrackedCalls = 0;
+  m_pendingControl = Control::None;
+
+  m_icacheMisses = m_icache ? m_icache->getMisses() : 0;
+  m_dcacheMisses = m_dcache ? m_dcache->getMisses() : 0;
+  m_tracker.reset();
+}
+
+long Profiler::index(AInt pc) const {
+  if (pc < m_textAddress || pc >= m_textEnd)
+    return -1;
+  const AInt offset = pc - m_textAddress;
+  if (offset & ((AInt(1) << m_shift) - 1))
+    return -1;
+  return static_cast<long>(offset >> m_shift);
+}
+
+unsigned Profiler::callee(unsigned node, unsigned function) {
+  auto &children = m_callNodes[node].children;
+  auto it = children.find(function);
+  if (it != children.end())
+    return it->second;
+
+  const unsigned child = m_callNodes.size();
+  children[function] = child;
+  CallNode callNode;
+  callNode.parent = node;
+  callNode.function = function;
+  callNode.depth = m_callNodes[node].depth + 1;
+  m_callNodes.push_back(std::move(callNode));
+  return child;
+}
+
+void Profiler::retire(AInt pc) {
+  const long idx = index(pc);
+  if (idx < 0) {
+    m_pendingControl = Control::None;
+    return;
+  }
+  m_counters[Retired][idx]++;
+
+  // The call stack changes once the instruction following a call or return
+  // retires.
+  const unsigned function = m_functionOf[idx];
+  if (m_pendingControl == Control::Call) {
+    if (m_callNodes[m_callNode].depth >= s_maxCallDepth)
+      m_untrackedCalls++;
+    else
+      m_callNode = callee(m_callNode, function);
+  } else if (m_pendingControl == Control::Return) {
+    if (m_untrackedCalls > 0)
+      m_untrackedCalls--;
+    else
+      m_callNode = m_callNodes[m_callNode].parent;
+  }
+  // Control transfers to another function other than through a call (ie. tail
+  // calls), replace the innermost stack frame.
+  if (m_untrackedCalls == 0 && m_callNodes[m_callNode].function != function)
+    m_callNode = callee(m_callNodes[m_callNode].parent, function);
+  m_pendingControl = m_control[idx];
+}
+
+void Profiler::processorWasClocked() {
+  const auto *processor = ProcessorHandler::getProcessor();
+
+  // The instructions in flight during the cycle, as tracked prior to it, are
+  // ordered by age.
+  const auto &inFlight = m_tracker.instructions();
+  const long oldest = inFlight.empty() ? -1 : index(inFlight.front().pc);
+
+  // Cycles which are reversed are not observed.
+  const bool observed = m_tracker.update();
+  if (observed) {
+    if (oldest >= 0)
+      m_counters[Cycles][oldest]++;
+    for (const auto &instr : m_tracker.retired())
+      retire(instr.pc);
+
+    for (const auto &stage : m_tracker.stages()) {
+      const StageInfo info = processor->stageInfo(stage);
+      const long idx = index(info.pc);
+      if (idx < 0)
+        continue;
+      if (info.state == StageInfo::State::Flushed)
+        m_counters[Flushes][idx]++;
+      else if (info.stage_valid && info.state == StageInfo::State::Stalled)
+        m_counters[Stalls][idx]++;
+    }
+    m_callNodes[m_callNode].cycles++;
+  }
+
+  // The caches were accessed by this cycle prior to the profiler observing it;
+  // see setCaches(). A decrease of the miss count is due to a cache reset.
+  if (m_icache) {
+    const unsigned misses = m_icache->getMisses();
+    const unsigned delta =
+        misses >= m_icacheMisses ? misses - m_icacheMisses : misses;
+    const long idx = index(processor->instrMemAccess().address);
+    if (observed && delta != 0 && idx >= 0)
+      m_counters[ICacheMisses][idx] += delta;
+    m_icacheMisses = misses;
+  }
+  if (m_dcache) {
+    const unsigned misses = m_dcache->getMisses();
+    const unsigned delta =
+        misses >= m_dcacheMisses ? misses - m_dcacheMisses : misses;
+    if (observed && delta != 0) {
+      const long idx =
+          index(processor->stageInfo(processor->dataMemAccessStage()).pc);
+      if (idx >= 0)
+        m_counters[DCacheMisses][idx] += delta;
+    }
+    m_dcacheMisses = misses;
+  }
+}
+
+QString Profiler::functionOffset(AInt pc) const {
+  const long idx = index(pc);
+  if (idx < 0)
+    return QString();
+  const unsigned function = m_functionOf[idx];
+  const AInt offset = pc - m_functionAddresses[function];
+  QString name = m_functionNames[function];
+  if (offset != 0)
+    name += "+0x" + QString::number(offset, 16);
+  return name;
+}
+
+static void sortByCycles(std::vector<Profiler::Entry> &entries) {
+  std::sort(entries.begin(), entries.end(), [](const auto &lhs, const auto &rhs) {
+    if (lhs.counts[Profiler::Cycles] != rhs.counts[Profiler::Cycles])
+      return lhs.counts[Profiler::Cycles] > rhs.counts[Profiler::Cycles];
+    return lhs.address < rhs.address;
+  });
+}
+
+std::vector<Profiler::Entry> Profiler::instructions() const {
+  std::vector<Entry> entries;
+  const size_t count = m_counters[Cycles].size();
+  for (size_t i = 0; i < count; ++i) {
+    Entry entry;
+    bool used = false;
+    for (unsigned c = 0; c < NumCounters; ++c) {
+      entry.counts[c] = m_counters[c][i];
+      used |= entry.counts[c] != 0;
+    }
+    if (!used)
+      continue;
+    entry.address = m_textAddress + (i << m_shift);
+    entry.name = functionOffset(entry.address);
+    entries.push_back(entry);
+  }
+  sortByCycles(entries);
+  return entries;
+}
+
+std::vector<Profiler::Entry> Profiler::functions() const {
+  std::vector<Entry> entries(m_functionNames.size());
+  for (unsigned f = 0; f < m_functionNames.size(); ++f) {
+    entries[f].address = m_functionAddresses[f];
+    entries[f].name = m_functionNames[f];
+  }
+  const size_t count = m_counters[Cycles].size();
+  for (size_t i = 0; i < count; ++i)
+    for (unsigned c = 0; c < NumCounters; ++c)
+      entries[m_functionOf[i]].counts[c] += m_counters[c][i];
+
+  entries.erase(std::remove_if(entries.begin(), entries.end(),
+                               [](const Entry &entry) {
+                                 return std::all_of(
+                                     entry.counts.begin(), entry.counts.end(),
+                                     [](uint64_t v) { return v == 0; });
+                               }),
+                entries.end());
+  sortByCycles(entries);
+  return entries;
+}
+
+QString Profiler::foldedStacks() const {
+  QString folded;
+  QTextStream stream(&folded);
+  for (unsigned node = 1; node < m_callNodes.size(); ++node) {
+    if (m_callNodes[node].cycles == 0)
+      continue;
+    QStringList stack;
+    for (unsigned n = node; n != 0; n = m_callNodes[n].parent)
+      stack.prepend(m_functionNames[m_callNodes[n].function]);
+    stream << stack.join(';') << " " << m_callNodes[node].cycles << "\n";
+  }
+  stream.flush();
+  return folded;
+}
+
+QString Profiler::toString() const {
+  QString outStr;
+  QTextStream out(&outStr);
+  uint64_t totalCycles = 0;
+  for (const uint64_t cycles : m_counters[Cycles])
+    totalCycles += cycles;
+
+  auto header = [&](const QString &name) {
+    out << QString("%").rightJustified(8);
+    for (unsigned c = 0; c < NumCounters; ++c)
+      out << counterName(static_cast<Counter>(c)).rightJustified(15);
+    out << "  " << name << "\n";
+  };
+  auto row = [&](const Entry &entry) {
+    const double share =
+        totalCycles == 0 ? 0.0
+                         : 100.0 * entry.counts[Cycles] / totalCycles;
+    out << QString::number(share, 'f', 2).rightJustified(8);
+    for (const uint64_t value : entry.counts)
+      out << QString::number(value).rightJustified(15);
+  };
+
+  out << "Functions:\n";
+  header("function");
+  for (const auto &entry : functions()) {
+    row(entry);
+    out << "  " << entry.name << "\n";
+  }
+
+  out << "\nInstructions:\n";
+  header("address");
+  for (const auto &entry : instructions()) {
+    row(entry);
+    out << "  0x" << QString::number(entry.address, 16) << " <" << entry.name
+        << ">  " << ProcessorHandler::disassembleInstr(entry.address) << "\n";
+  }
+  out.flush();
+  return outStr;
+}
+
+QVariant Profiler::toVariant() const {
+  auto entryMap = [](const Entry &entry) {
+    QVariantMap map;
+    map["address"] = "0x" + QString::number(entry.address, 16);
+    for (unsigned c = 0; c < NumCounters; ++c)
+      map[counterName(static_cast<Counter>(c))] =
+          static_cast<qulonglong>(entry.counts[c]);
+    return map;
+  };
+
+  QVariantList functionList;
+  for (const auto &entry : functions()) {
+    QVariantMap map = entryMap(entry);
+    map["function"] = entry.name;
+    functionList << map;
+  }
+  QVariantList instructionList;
+  for (const auto &entry : instructions()) {
+    QVariantMap map = entryMap(entry);
+    map["function"] = entry.name;
+    map["instruction"] = ProcessorHandler::disassembleInstr(entry.address);
+    instructionList << map;
+  }
+
+  QVariantMap profile;
+  profile["functions"] = functionList;
+  profile["instructions"] = instructionList;
+  return profile;
+}
+
+} // namespace Ripes
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "pipelinetracker.h"
+
+#include <QObject>
+#include <QVariant>
+
+#include <array>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace Ripes {
+
+class CacheSim;
+class SimulationContext;
+
+/**
+ * @brief The Profiler class
+ * Attributes the execution of the processor of the simulation context which is
+ * current upon construction to the instructions of the text section of the
+ * loaded program. Counters are kept in flat arrays, with an entry for each
+ * instruction address, such that each cycle is accounted for by a few array
+ * increments.
+ *
+ * Instructions are followed through the pipeline by a PipelineTracker, as are
+ * the commits of a CommitObserver. Each cycle is attributed to the oldest
+ * instruction in flight during the cycle. Stall and flush cycles are attributed to the
+ * instruction of each stalled or flushed stage. Instruction cache misses are
+ * attributed to the fetched instruction, and data cache misses to the
+ * instruction in the stage which accesses the data memory.
+ *
+ * Function calls and returns are tracked through the retired instructions, by
+ * the RISC-V calling convention (jal/jalr linking through ra or t0, and jalr
+ * through ra or t0 without linking), such that cycles are also attributed to
+ * the call stack of each cycle. At report time, counters are rolled up per
+ * function, through the symbols of the program.
+ */
+class Profiler : public QObject {
+  Q_OBJECT
+public:
+  enum Counter {
+    Cycles,
+    Retired,
+    Stalls,
+    Flushes,
+    ICacheMisses,
+    DCacheMisses,
+    NumCounters
+  };
+  using Counts = std::array<uint64_t, NumCounters>;
+
+  struct Entry {
+    // Start address of the function, or address of the instruction.
+    AInt address = 0;
+    // Name of the function, or function+offset of the instruction.
+    QString name;
+    Counts counts{};
+  };
+
+  Profiler(QObject *parent = nullptr);
+  ~Profiler() override;
+
+  /**
+   * @brief setCaches
+   * Attributes the misses of @p icache and @p dcache, being the L1 caches fed
+   * with the accesses of the processor. Either may be nullptr. The profiler
+   * is re-registered as a cycle observer, such that it observes each cycle
+   * after the caches were accessed.
+   */
+  void setCaches(std::shared_ptr<const CacheSim> icache,
+                 std::shared_ptr<const CacheSim> dcache);
+
+  /// Returns the instructions with any non-zero counter, sorted by cycles.
+  std::vector<Entry> instructions() const;
+
+  /// Returns the counters rolled up per function, sorted by cycles.
+  std::vector<Entry> functions() const;
+
+  /// Returns the cycles of each observed call stack, as folded stacks: a line
+  /// of ';'-separated function names, outermost first, followed by a count.
+  QString foldedStacks() const;
+
+  /// Returns the flat and per-function profiles as a table.
+  QString toString() const;
+
+  /// Returns the flat and per-function profiles as a variant map, for JSON
+  /// export.
+  QVariant toVariant() const;
+
+  static QString counterName(Counter counter);
+
+public slots:
+  void processorWasClocked();
+  void reset();
+
+private:
+  enum class Control : uint8_t { None, Call, Return };
+
+  /**
+   * @brief The CallNode struct
+   * A node of the tree of observed call stacks; the root (node 0) is the empty
+   * stack.
+   */
+  struct CallNode {
+    unsigned parent = 0;
+    // Index into m_functionNames.
+    unsigned function = 0;
+    unsigned depth = 0;
+    uint64_t cycles = 0;
+    std::map<unsigned, unsigned> children;
+  };
+
+  /// Returns the index of the instruction at @p pc, or -1 if not in the text
+  /// section.
+  long index(AInt pc) const;
+  void retire(AInt pc);
+  unsigned callee(unsigned node, unsigned function);
+  QString functionOffset(AInt pc) const;
+
+  // Counters of each instruction of the text section.
+  std::array<std::vector<uint64_t>, NumCounters> m_counters;
+  AInt m_textAddress = 0;
+  AInt m_textEnd = 0;
+  // log2 of the instruction alignment; 2-byte aligned with compressed
+  // instructions.
+  unsigned m_shift = 2;
+  // Control flow kind and function (index into m_functionNames) of each
+  // instruction.
+  std::vector<Control> m_control;
+  std::vector<unsigned> m_functionOf;
+  std::vector<QString> m_functionNames;
+  std::vector<AInt> m_functionAddresses;
+
+  PipelineTracker m_tracker;
+
+  std::vector<CallNode> m_callNodes;
+  unsigned m_callNode = 0;
+  // Calls beyond the maximum tracked depth, which are not yet returned from.
+  unsigned m_untrackedCalls = 0;
+  Control m_pendingControl = Control::None;
+
+  std::shared_ptr<const CacheSim> m_icache;
+  std::shared_ptr<const CacheSim> m_dcache;
+  unsigned m_icacheMisses = 0;
+  unsigned m_dcacheMisses = 0;
+
+  unsigned m_cycleObserverID;
+  // The simulation context of the processor which is profiled.
+  SimulationContext &m_context;
+};
+
+} // namespace Ripes
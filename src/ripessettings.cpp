@@ -49,7 +49,10 @@ const std::map<QString, QVariant> s_defaultSettings = {
                       ReplPolicy::LRU},
           CachePreset{"32-entry 4-word 2-way set associative", 2, 4, 1,
                       WritePolicy::WriteBack, WriteAllocPolicy::WriteAllocate,
-                      ReplPolicy::LRU}})},
+                      ReplPolicy::LRU},
+          CachePreset{"128-entry 4-word 8-way set associative (PLRU)", 2, 4,
+                      3, WritePolicy::WriteBack,
+                      WriteAllocPolicy::WriteAllocate, ReplPolicy::PLRU}})},
 
     // Program state preserving settings
     {RIPES_GLOBALSIGNAL_QUIT, 0},
@@ -0,0 +1,67 @@
+#include "simulationcontext.h"
+
+#include "io/iomanager.h"
+#include "processorhandler.h"
+#include "ripessettings.h"
+#include "syscall/systemio.h"
+
+namespace Ripes {
+
+thread_local SimulationContext *SimulationContext::s_current = nullptr;
+
+SimulationContext::SimulationContext() : SimulationContext(false) {}
+
+SimulationContext::SimulationContext(bool isApplication)
+    : m_isApplication(isApplication) {
+  // The members are constructed with this context bound, such that any static
+  // accessor used during their construction resolves to this context.
+  Scope scope(*this);
+  m_systemIO = std::unique_ptr<SystemIO>(new SystemIO());
+  m_processorHandler =
+      std::unique_ptr<ProcessorHandler>(new ProcessorHandler(*this));
+
+  // The settings are only read by the application context, which is
+  // constructed and used on the main thread. Other contexts may be constructed
+  // on any thread, and use the default settings.
+  const auto peripheralsStart = [](const QVariant &value) {
+    return static_cast<AInt>(static_cast<unsigned>(value.toInt()));
+  };
+  if (!m_isApplication) {
+    m_ioManager = std::unique_ptr<IOManager>(new IOManager(
+        false, peripheralsStart(
+                   s_defaultSettings.at(RIPES_SETTING_PERIPHERALS_START))));
+    return;
+  }
+  m_ioManager = std::unique_ptr<IOManager>(new IOManager(
+      true, peripheralsStart(
+                RipesSettings::value(RIPES_SETTING_PERIPHERALS_START))));
+  QObject::connect(RipesSettings::getObserver(RIPES_SETTING_PERIPHERALS_START),
+                   &SettingObserver::modified, m_ioManager.get(),
+                   [=, ioManager = m_ioManager.get()](const QVariant &value) {
+                     ioManager->setPeripheralsStart(peripheralsStart(value));
+                   });
+}
+
+SimulationContext::~SimulationContext() {
+  Scope scope(*this);
+  m_processorHandler->_stopRun();
+  m_ioManager.reset();
+  m_processorHandler.reset();
+  m_systemIO.reset();
+}
+
+SimulationContext &SimulationContext::application() {
+  // Never destroyed, as the processor handler must outlive the application
+  // objects which refer to it.
+  static auto *context = new SimulationContext(true);
+  return *context;
+}
+
+void SimulationContext::run() {
+  Scope scope(*this);
+  ProcessorHandler::runBlocking();
+}
+
+void SimulationContext::stop() { m_processorHandler->setStopRunFlag(); }
+
+} // namespace Ripes
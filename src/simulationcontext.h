@@ -0,0 +1,92 @@
+#pragma once
+
+#include <memory>
+
+namespace Ripes {
+
+class IOManager;
+class ProcessorHandler;
+class SystemIO;
+
+/**
+ * @brief The SimulationContext class
+ * Owns the complete state of a single simulation: the processor, its program
+ * and system call manager (through a ProcessorHandler), the system call I/O
+ * state (SystemIO) and the memory-mapped peripherals (IOManager).
+ *
+ * The static accessors of ProcessorHandler, SystemIO and IOManager resolve to
+ * the context which is current for the calling thread. This is the application
+ * context, unless another context has been bound to the thread through a
+ * SimulationContext::Scope. Any number of contexts may thereby be simulated
+ * concurrently, given that each context is constructed, used and destroyed
+ * within a single thread.
+ *
+ * Contexts other than the application context neither read nor write the
+ * application settings, do not take part in global reset requests and do not
+ * keep a reverse-execution history.
+ */
+class SimulationContext {
+public:
+  SimulationContext();
+  ~SimulationContext();
+  SimulationContext(const SimulationContext &) = delete;
+  SimulationContext &operator=(const SimulationContext &) = delete;
+
+  /// Returns the context which is current for the calling thread.
+  static SimulationContext &current() {
+    return s_current ? *s_current : application();
+  }
+
+  /// Returns the application context; the context used by the GUI and by the
+  /// CLI when running a single program.
+  static SimulationContext &application();
+
+  bool isApplicationContext() const { return m_isApplication; }
+
+  ProcessorHandler &processorHandler() { return *m_processorHandler; }
+  SystemIO &systemIO() { return *m_systemIO; }
+  IOManager &ioManager() { return *m_ioManager; }
+
+  /**
+   * @brief run
+   * Runs the processor of this context in the calling thread, returning once
+   * the processor has finished, hit a breakpoint or stop() has been called.
+   */
+  void run();
+
+  /// Requests a run() of this context to stop. May be called from any thread.
+  void stop();
+
+  /**
+   * @brief The Scope class
+   * Binds a context as the current context of the calling thread for the
+   * lifetime of the scope. Scopes may be nested.
+   */
+  class Scope {
+  public:
+    explicit Scope(SimulationContext &context) : m_previous(s_current) {
+      s_current = &context;
+    }
+    ~Scope() { s_current = m_previous; }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    SimulationContext *m_previous;
+  };
+
+private:
+  explicit SimulationContext(bool isApplication);
+
+  static thread_local SimulationContext *s_current;
+
+  const bool m_isApplication;
+  // Explicitly destroyed by ~SimulationContext: the peripherals unregister
+  // from the processor memory before the processor handler is destroyed, and
+  // SystemIO outlives the syscalls of the processor handler.
+  std::unique_ptr<SystemIO> m_systemIO;
+  std::unique_ptr<ProcessorHandler> m_processorHandler;
+  std::unique_ptr<IOManager> m_ioManager;
+};
+
+} // namespace Ripes
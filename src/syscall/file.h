@@ -1,5 +1,8 @@
 #pragma once
 
+#include <QtEndian>
+
+#include <array>
 #include <type_traits>
 
 #include "processorhandler.h"
@@ -21,14 +24,7 @@ public:
   void execute() {
     const AInt arg0 = BaseSyscall::getArg(RegisterFileType::GPR, 0);
     const AInt arg1 = BaseSyscall::getArg(RegisterFileType::GPR, 1);
-    QByteArray string;
-    char byte;
-    unsigned int address = arg0;
-    do {
-      byte = static_cast<char>(
-          ProcessorHandler::getMemory().readMemConst(address++, 1) & 0xFF);
-      string.append(byte);
-    } while (byte != '\0');
+    const QByteArray string = ProcessorHandler::readMemString(arg0);
 
     int ret = SystemIO::openFile(QString::fromUtf8(string), arg1);
 
@@ -43,10 +39,11 @@ class CloseSyscall : public BaseSyscall {
 public:
   CloseSyscall()
       : BaseSyscall("Close", "Close a file",
-                    {{0, "the file descriptor to close"}}) {}
+                    {{0, "the file descriptor to close"}},
+                    {{0, "0 on success, or -1 if an error occurred"}}) {}
   void execute() {
     const VInt arg0 = BaseSyscall::getArg(RegisterFileType::GPR, 0);
-    SystemIO::closeFile(arg0);
+    BaseSyscall::setRet(RegisterFileType::GPR, 0, SystemIO::closeFile(arg0));
   }
 };
 
@@ -82,26 +79,27 @@ public:
                      {1, "address of the buffer"},
                      {2, "maximum number of bytes to read"}},
                     {{0, "number of read bytes or -1 if an error occurred"}}) {}
+  bool isInteractive() const override {
+    // Reading from stdin waits for input from the console, unless input is
+    // already buffered (ie. streamed from a file).
+    return BaseSyscall::getArg(RegisterFileType::GPR, 0) == SystemIO::STDIN &&
+           !SystemIO::stdInReady();
+  }
   void execute() {
     const int fd = BaseSyscall::getArg(RegisterFileType::GPR, 0);
-    int byteAddress = BaseSyscall::getArg(
+    const AInt byteAddress = BaseSyscall::getArg(
         RegisterFileType::GPR, 1); // destination of characters read from file
     const int length = BaseSyscall::getArg(RegisterFileType::GPR, 2);
-    QByteArray buffer;
 
-    int retLength = SystemIO::readFromFile(fd, buffer, length);
+    // The bytes read are copied into memory as they are read; for a file which
+    // is mapped into memory, directly from the mapping.
+    AInt address = byteAddress;
+    const int retLength = SystemIO::readFromFile(
+        fd, length, [&](const char *data, qint64 size) {
+          ProcessorHandler::writeMemRange(address, data, size);
+          address += size;
+        });
     BaseSyscall::setRet(RegisterFileType::GPR, 0, retLength);
-
-    if (retLength != -1) {
-      // copy bytes from returned buffer into memory
-      const char *dataptr =
-          buffer.constData(); // QString::data contains a possible null
-                              // termination '\0' character (present if reading
-                              // from stdin and not from a file)
-      while (retLength-- > 0) {
-        ProcessorHandler::writeMem(byteAddress++, *dataptr++, sizeof(char));
-      }
-    }
   }
 };
 
@@ -117,7 +115,7 @@ public:
                      {2, "number of bytes to write"}},
                     {{0, "the number of bytes written"}}) {}
   void execute() {
-    const int byteAddress = BaseSyscall::getArg(
+    const AInt byteAddress = BaseSyscall::getArg(
         RegisterFileType::GPR, 1); // source of characters to write to file
     const int reqLength =
         BaseSyscall::getArg(RegisterFileType::GPR, 2); // user-requested length
@@ -125,14 +123,8 @@ public:
       BaseSyscall::setRet(RegisterFileType::GPR, 0, -1);
       return;
     }
-    int index = 0;
-    QString myBuffer;
-
-    do {
-      myBuffer.append(static_cast<char>(
-          ProcessorHandler::getMemory().readMemConst(byteAddress + index++, 1) &
-          0xFF));
-    } while (index < reqLength);
+    const QByteArray myBuffer =
+        ProcessorHandler::readMemRange(byteAddress, reqLength);
 
     const int retValue = SystemIO::writeToFile(
         BaseSyscall::getArg(RegisterFileType::GPR, 0), myBuffer, reqLength);
@@ -153,9 +145,8 @@ public:
              {1, "the length of the buffer"}},
             {{0, "-1 if the path is longer than the buffer"}}) {}
   void execute() {
-    const int byteAddress = BaseSyscall::getArg(
+    const AInt byteAddress = BaseSyscall::getArg(
         RegisterFileType::GPR, 0); // destination of characters read from file
-    int index = 0;
     const int bufferSize = BaseSyscall::getArg(RegisterFileType::GPR, 1);
 
     const QString pwd = QDir::currentPath();
@@ -168,10 +159,9 @@ public:
     }
 
     // copy bytes from returned buffer into memory
-    while (index < pwd.length()) {
-      ProcessorHandler::writeMem(byteAddress, pwd.at(index++).toLatin1(),
-                                 sizeof(char));
-    }
+    const QByteArray path = pwd.toLatin1();
+    ProcessorHandler::writeMemRange(byteAddress, path.constData(),
+                                    path.size());
   }
 };
 
@@ -188,11 +178,31 @@ public:
             {{0, " the file descriptor "}, {1, " pointer to a struct stat "}},
             {{0, "returns -1 if an error occurred"}}) {}
   void execute() {
-    /// @todo: Figure out whether we want to handle fstat. For now, most
-    /// syscall's seems to execute fine with just null-values in the fstat
-    /// return struct - this is ofcourse not a valid mode of execution, but for
-    /// the current state of development, it'll have to do.
+    const int fd = BaseSyscall::getArg(RegisterFileType::GPR, 0);
+    const AInt statAddress = BaseSyscall::getArg(RegisterFileType::GPR, 1);
+    SystemIO::FileStat stat;
+    if (!SystemIO::fileStat(fd, stat)) {
+      BaseSyscall::setRet(RegisterFileType::GPR, 0, -1);
+      return;
+    }
+
+    // The struct is written in the layout of the kernel_stat struct of newlib
+    // for RISC-V (libgloss/riscv/kernel_stat.h). Fields up until the
+    // timestamps are written; fields other than the mode, size, block size and
+    // block count are zero.
+    std::array<char, 72> buffer{};
+    const uint32_t mode = stat.isCharDevice ? s_ifchr | 0620 : s_ifreg | 0644;
+    qToLittleEndian<uint32_t>(mode, buffer.data() + 16);
+    qToLittleEndian<int64_t>(stat.size, buffer.data() + 48);
+    qToLittleEndian<int32_t>(stat.blockSize, buffer.data() + 56);
+    qToLittleEndian<int64_t>((stat.size + 511) / 512, buffer.data() + 64);
+    ProcessorHandler::writeMemRange(statAddress, buffer.data(), buffer.size());
     BaseSyscall::setRet(RegisterFileType::GPR, 0, 0);
   }
+
+private:
+  // File type bits of st_mode.
+  static constexpr uint32_t s_ifchr = 0020000;
+  static constexpr uint32_t s_ifreg = 0100000;
 };
 } // namespace Ripes
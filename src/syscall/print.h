@@ -49,15 +49,8 @@ public:
                     {{0, "address of the string"}}) {}
   void execute() {
     const VInt arg0 = BaseSyscall::getArg(RegisterFileType::GPR, 0);
-    QByteArray string;
-    char byte;
-    AInt address = arg0;
-    do {
-      byte = static_cast<char>(
-          ProcessorHandler::getMemory().readMemConst(address++, 1) & 0xFF);
-      string.append(byte);
-    } while (byte != '\0');
-    SystemIO::printString(QString::fromUtf8(string));
+    const QByteArray string = ProcessorHandler::readMemString(arg0);
+    SystemIO::printBytes(string);
   }
 };
 
@@ -72,7 +65,7 @@ public:
             {{0, "character to print (only lowest byte is considered)"}}) {}
   void execute() {
     const VInt arg0 = BaseSyscall::getArg(RegisterFileType::GPR, 0);
-    SystemIO::printString(QChar(static_cast<char>(arg0)));
+    SystemIO::printBytes(QByteArray(1, static_cast<char>(arg0)));
   }
 };
 
@@ -2,6 +2,8 @@
 
 #include "processorhandler.h"
 
+#include <QElapsedTimer>
+
 namespace Ripes {
 
 bool SyscallManager::execute(SyscallID id) {
@@ -20,19 +22,36 @@ bool SyscallManager::execute(SyscallID id) {
   } else {
     const auto &syscall = m_syscalls.at(id);
     const QString &syscallName = syscall->name();
-    postToGUIThread([=] {
-      // We don't have a good way of making non-permanent status timers
-      // pseudo-permanent until explicitly cleared... The best way to do so is
-      // to just have a very large timeout.
-      SyscallStatusManager::setStatusTimed(
-          "Handling system call: " + syscallName + " (" + QString::number(id) +
-              ")",
-          99999999);
-    });
+    // Only interactive system calls may take long enough for the status to be
+    // of use. Posting it for every other system call would otherwise dominate
+    // their execution time.
+    const bool interactive = syscall->isInteractive();
+    if (interactive) {
+      postToGUIThread([=] {
+        // We don't have a good way of making non-permanent status timers
+        // pseudo-permanent until explicitly cleared... The best way to do so
+        // is to just have a very large timeout.
+        SyscallStatusManager::setStatusTimed(
+            "Handling system call: " + syscallName + " (" +
+                QString::number(id) + ")",
+            99999999);
+      });
+    }
+    QElapsedTimer timer;
+    timer.start();
     syscall->execute();
-    postToGUIThread([=] { SyscallStatusManager::clearStatus(); });
+    auto &statistics = m_statistics[id];
+    statistics.count++;
+    statistics.nanoseconds += timer.nsecsElapsed();
+    if (interactive)
+      postToGUIThread([=] { SyscallStatusManager::clearStatus(); });
     return true;
   }
 }
 
+bool SyscallManager::isInteractive(SyscallID id) const {
+  const auto it = m_syscalls.find(id);
+  return it != m_syscalls.end() && it->second->isInteractive();
+}
+
 } // namespace Ripes
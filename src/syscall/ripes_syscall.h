@@ -44,6 +44,15 @@ public:
 
   virtual void execute() = 0;
 
+  /**
+   * @brief isInteractive
+   * Returns true if the system call, as per its current arguments, waits for
+   * user interaction (ie. input from the console). Interactive system calls
+   * are executed outside of the simulation thread, whereas all other system
+   * calls are executed directly within it.
+   */
+  virtual bool isInteractive() const { return false; }
+
   /**
    * @brief getArg
    * ABI specific specialization of returning an argument register value.
@@ -83,13 +92,37 @@ public:
    */
   bool execute(SyscallID id);
 
+  /**
+   * @brief isInteractive
+   * Returns true if the syscall identified by @p id is interactive, as per the
+   * current arguments; see Syscall::isInteractive().
+   */
+  bool isInteractive(SyscallID id) const;
+
   const std::map<SyscallID, std::unique_ptr<Syscall>> &getSyscalls() const {
     return m_syscalls;
   }
 
+  /// The number of executions of a system call, and the total wall time spent
+  /// executing it.
+  struct Statistics {
+    uint64_t count = 0;
+    uint64_t nanoseconds = 0;
+  };
+
+  /// Returns the statistics of each system call which was executed since the
+  /// last call to resetStatistics().
+  const std::map<SyscallID, Statistics> &statistics() const {
+    return m_statistics;
+  }
+  void resetStatistics() { m_statistics.clear(); }
+
 protected:
   SyscallManager() {}
   std::map<SyscallID, std::unique_ptr<Syscall>> m_syscalls;
+
+private:
+  std::map<SyscallID, Statistics> m_statistics;
 };
 
 template <class T>
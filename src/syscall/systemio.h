@@ -8,12 +8,18 @@
 #include <QObject>
 #include <QTemporaryFile>
 #include <QTextStream>
+#include <QThread>
 #include <QWaitCondition>
 
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <memory>
 #include <stdexcept>
 #include <sys/stat.h>
 
 #include "STLExtras.h"
+#include "utilities/spmcring.h"
 #include "statusmanager.h"
 
 namespace Ripes {
@@ -46,39 +52,49 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 (MIT license, http://www.opensource.org/licenses/mit-license.html)
 */
 
+class SimulationContext;
+
 /**
  * @brief The SystemIO class
  * Provides standard i/o services needed to simulate the RISCV syscall
  * routines.
  * This class is largely based on the SystemIO.java class of RARS.
+ * Each SimulationContext owns a SystemIO; the static functions of this class
+ * act upon the SystemIO of the current context.
  */
 
 class SystemIO : public QObject {
   Q_OBJECT
 public:
-  static SystemIO &get() {
-    static SystemIO sio;
-    return sio;
-  }
+  /// Returns the SystemIO of the current simulation context.
+  static SystemIO &get();
+
+  // Standard I/O Channels
+  enum STDIO { STDIN = 0, STDOUT = 1, STDERR = 2, STDIO_END };
+
+  // Number of unread bytes of stdin beyond which feedStdIn() blocks
+  static constexpr qsizetype STDIN_BUFFER_SIZE = 1 << 20;
 
 private:
   // String used for description of file error
-  static QString s_fileErrorString; // = ("File operation OK");
+  QString m_fileErrorString; // = ("File operation OK");
 
   // Flag used for aborting waiting for I/O
-  static bool s_abortSyscall;
+  std::atomic<bool> m_abortSyscall = false;
 
-  // Standard I/O Channels
-  enum STDIO { STDIN = 0, STDOUT = 1, STDERR = 2, STDIO_END };
+  // Set while the current run is being stopped; cleared when a run starts.
+  std::atomic<bool> m_runStopping = false;
 
-  // Buffer size for syscalls for file I/O
-  static constexpr int SYSCALL_BUFSIZE = 128;
-  // Maximum number of files that can be open
+  // Default size of the write buffer of each file opened through the file
+  // syscalls
+  static constexpr int SYSCALL_BUFSIZE = 1 << 16;
+  // Default maximum number of files that can be open
   static constexpr int SYSCALL_MAXFILES = 32;
 
   static constexpr int O_RDONLY = 0x00000000;
   static constexpr int O_WRONLY = 0x00000001;
   static constexpr int O_RDWR = 0x00000002;
+  static constexpr int O_ACCMODE = 0x00000003;
   static constexpr int O_APPEND = 0x00000008;
   static constexpr int O_CREAT = 0x00000200; // 512
   static constexpr int O_TRUNC = 0x00000400; // 1024
@@ -89,36 +105,102 @@ private:
   // descriptor."
 
   struct FileIOData {
+    /**
+     * @brief The HostFile struct
+     * The host file of a file descriptor. Files opened read-only are mapped
+     * into memory, and read directly from the mapping. Writes are buffered up
+     * to bufferSize bytes, and the buffer is flushed before any other operation
+     * on the file, such that reads, seeks and sizes observe the written data.
+     */
+    struct HostFile {
+      explicit HostFile(const QString &filename) : file(filename) {}
+      QFile file;
+      // Mapping of a read-only file; nullptr if not mapped.
+      const char *map = nullptr;
+      qint64 mapSize = 0;
+      // The position within the mapping, if mapped.
+      qint64 mapPos = 0;
+      QByteArray writeBuffer;
+    };
+
     // The filenames in use. Null if file descriptor i is not in use.
-    static std::map<int, QString> fileNames;
+    std::map<int, QString> fileNames;
     // The flags of this file, 0=READ, 1=WRITE. Invalid if this file descriptor
     // is not in use.
-    static std::map<int, unsigned> fileFlags;
-    // The streams in use, associated with the filenames
-    static std::map<int, QTextStream> streams;
-    // The file pointers in use
-    static std::map<int, QFile> files;
-    // QByteArray to use as a stdin buffer
-    static QByteArray s_stdinBuffer;
+    std::map<int, unsigned> fileFlags;
+    // The host files in use, associated with the filenames
+    std::map<int, HostFile> files;
+    // QByteArray to use as a stdin buffer, of which the bytes before
+    // stdinOffset have been read.
+    QByteArray stdinBuffer;
+    qsizetype stdinOffset = 0;
+    // Set once the source of stdin is exhausted; reads from stdin return 0
+    // bytes once the buffer is drained.
+    bool stdinEOF = false;
+
+    // Maximum number of open files, including the standard i/o channels.
+    int maxFiles = SYSCALL_MAXFILES;
+    // Size of the write buffer of each file.
+    int bufferSize = SYSCALL_BUFSIZE;
 
     /**
-     * @brief s_stdioMutex
+     * @brief stdioMutex
      * Used for implementing the waitCondition between the producer/consumer
      * scenario where ecall handling is blocking while waiting for the
      * stdinBuffer to be non-empty.
      */
-    static QMutex s_stdioMutex;
-    static QWaitCondition s_stdinBufferEmpty;
+    QMutex stdioMutex;
+    QWaitCondition stdinBufferEmpty;
+    // Signalled when stdin is read from, for a producer which is blocked on
+    // a full stdin buffer.
+    QWaitCondition stdinBufferFull;
+
+    qsizetype stdinAvailable() const {
+      return stdinBuffer.size() - stdinOffset;
+    }
 
-    // Reset all file information. Closes any open files and resets the arrays
-    static void resetFiles() {
-      for (int i = 0; i < SYSCALL_MAXFILES; ++i) {
-        close(i);
+    // Takes up to n unread bytes from the stdin buffer. Must be called with
+    // stdioMutex held.
+    QByteArray takeStdin(qsizetype n) {
+      n = std::min(n, stdinAvailable());
+      QByteArray data = stdinBuffer.mid(stdinOffset, n);
+      stdinOffset += n;
+      // Compact the buffer once the read bytes dominate it, such that each
+      // byte is moved an amortized constant number of times.
+      if (stdinOffset > stdinBuffer.size() / 2) {
+        stdinBuffer.remove(0, stdinOffset);
+        stdinOffset = 0;
       }
+      stdinBufferFull.wakeAll();
+      return data;
+    }
+
+    // Set to a description of the error of the last failing file operation.
+    QString &fileErrorString;
+
+    explicit FileIOData(QString &fileErrorString)
+        : fileErrorString(fileErrorString) {}
+    ~FileIOData() {
+      // Files which are left open by the program retain their written data.
+      // No program is left to observe a failure, which is thus reported on
+      // stderr.
+      for (auto &[fd, hostFile] : files) {
+        if (!flush(hostFile))
+          std::cerr << "ERROR: " << fileErrorString.toStdString() << std::endl;
+      }
+    }
+
+    // Reset all file information. Closes any open files and resets the arrays
+    void resetFiles() {
+      std::vector<int> open;
+      for (const auto &[fd, file] : files)
+        open.push_back(fd);
+      for (int fd : open)
+        close(fd);
       setupStdio();
     }
 
-    static void setupStdio() {
+    void setupStdio() {
       fileNames[STDIN] = "STDIN";
       fileNames[STDOUT] = "STDOUT";
       fileNames[STDERR] = "STDERR";
@@ -126,67 +208,159 @@ private:
       fileFlags[STDOUT] = SystemIO::O_WRONLY;
       fileFlags[STDERR] = SystemIO::O_WRONLY;
 
-      if (streams.count(STDIN) == 0) {
-        // stdin stream has not yet been created
-        streams.emplace(STDIN, &s_stdinBuffer);
-      } else {
-        // Clear stdin stream and reset stream
-        s_stdinBuffer.clear();
-        auto success = streams[STDIN].seek(0);
-        Q_ASSERT(success);
-      }
+      // stdin is read directly from stdinBuffer.
+      QMutexLocker locker(&stdioMutex);
+      stdinBuffer.clear();
+      stdinOffset = 0;
+      stdinEOF = false;
+      stdinBufferFull.wakeAll();
 
       // stdout/stderr will be handled via. signal/slots internally in the
       // application streams.emplace(STDOUT, stdout); streams.emplace(STDERR,
       // stderr);
     }
 
-    // Open a file stream assigned to the given file descriptor
-    static void openFilestream(int fd, const QString &filename) {
-      files.emplace(fd, filename);
+    // Open the host file assigned to the given file descriptor
+    void openFilestream(int fd, const QString &filename) {
+      auto &hostFile = files.try_emplace(fd, filename).first->second;
+      auto &file = hostFile.file;
 
+      // Translate from stdlib file flags to Qt flags. A file which is opened
+      // for writing is not truncated unless requested, which in Qt requires it
+      // to also be opened for reading.
       const auto flags = fileFlags[fd];
-      const auto qtOpenFlags = // Translate from stdlib file flags to Qt flags
-          (flags & O_RDONLY ? QIODevice::ReadOnly : QIODevice::NotOpen) |
-          (flags & O_WRONLY ? QIODevice::WriteOnly : QIODevice::NotOpen) |
-          (flags & O_RDWR ? QIODevice::ReadWrite : QIODevice::NotOpen) |
-          (flags & O_TRUNC ? QIODevice::Truncate : QIODevice::Append) |
-          (flags & O_EXCL ? QIODevice::NewOnly : QIODevice::NotOpen);
-
-      // Try to open file with the given flags
-      files[fd].open(qtOpenFlags);
-
-      if (!files[fd].exists() && flags & O_CREAT) {
+      const unsigned access = flags & O_ACCMODE;
+      QIODevice::OpenMode qtOpenFlags =
+          access == O_RDONLY ? QIODevice::ReadOnly : QIODevice::ReadWrite;
+      if (access != O_RDONLY && (flags & O_APPEND))
+        qtOpenFlags |= QIODevice::Append;
+      if (access != O_RDONLY && (flags & O_TRUNC))
+        qtOpenFlags |= QIODevice::Truncate;
+      if (flags & O_EXCL)
+        qtOpenFlags |= QIODevice::NewOnly;
+      if (!(flags & O_CREAT))
+        qtOpenFlags |= QIODevice::ExistingOnly;
+
+      // Try to open file with the given flags. Reads and writes are buffered
+      // by HostFile rather than by QFile.
+      const bool existed = file.exists();
+      if (!file.open(qtOpenFlags | QIODevice::Unbuffered)) {
         files.erase(fd);
-        throw std::runtime_error("Could not create file");
+        if (!existed && !(flags & O_CREAT))
+          throw std::runtime_error("File not found");
+        if (!existed)
+          throw std::runtime_error("Could not create file");
+        throw std::runtime_error("File could not be opened");
       }
 
-      if (!files[fd].exists()) {
-        files.erase(fd);
-        throw std::runtime_error("File not found");
+      if (access == O_RDONLY && file.size() > 0) {
+        // A file which is mapped is read without any intermediate copies; if
+        // mapping fails, the file is read through QFile.
+        if (uchar *map = file.map(0, file.size())) {
+          hostFile.map = reinterpret_cast<const char *>(map);
+          hostFile.mapSize = file.size();
+        }
       }
+    }
 
-      if (!files[fd].isOpen()) {
-        files.erase(fd);
-        throw std::runtime_error("File could not be opened");
+    // Writes any buffered data of the file to the host file. Returns false, and
+    // sets fileErrorString, if the data could not be written.
+    bool flush(HostFile &hostFile) {
+      if (hostFile.writeBuffer.isEmpty())
+        return true;
+      const qint64 written = hostFile.file.write(hostFile.writeBuffer);
+      const bool ok = written == hostFile.writeBuffer.size();
+      hostFile.writeBuffer.clear();
+      if (!ok)
+        fileErrorString = "Could not write to file " +
+                          hostFile.file.fileName() + ": " +
+                          hostFile.file.errorString();
+      return ok;
+    }
+
+    // Returns the position within the file, or -1 on error.
+    qint64 pos(int fd) {
+      auto &hostFile = files.at(fd);
+      if (!flush(hostFile))
+        return -1;
+      return hostFile.map ? hostFile.mapPos : hostFile.file.pos();
+    }
+
+    // Returns the size of the file, or -1 on error.
+    qint64 size(int fd) {
+      auto &hostFile = files.at(fd);
+      if (!flush(hostFile))
+        return -1;
+      return hostFile.map ? hostFile.mapSize : hostFile.file.size();
+    }
+
+    bool seek(int fd, qint64 position) {
+      auto &hostFile = files.at(fd);
+      if (!flush(hostFile))
+        return false;
+      if (hostFile.map) {
+        hostFile.mapPos = position;
+        return true;
+      }
+      return hostFile.file.seek(position);
+    }
+
+    // Reads up to length bytes from the file, which are passed to sink as one
+    // or more (pointer, size) spans. Returns the number of bytes read, or -1
+    // on error.
+    template <typename Sink>
+    qint64 read(int fd, qint64 length, Sink &&sink) {
+      auto &hostFile = files.at(fd);
+      if (!flush(hostFile))
+        return -1;
+      if (hostFile.map) {
+        const qint64 n = std::clamp<qint64>(
+            hostFile.mapSize - hostFile.mapPos, 0, length);
+        if (n > 0)
+          sink(hostFile.map + hostFile.mapPos, n);
+        hostFile.mapPos += n;
+        return n;
       }
 
-      streams.emplace(fd, &files[fd]);
+      QByteArray chunk(std::min<qint64>(length, bufferSize), Qt::Uninitialized);
+      qint64 total = 0;
+      while (total < length) {
+        const qint64 n = hostFile.file.read(
+            chunk.data(), std::min<qint64>(length - total, chunk.size()));
+        if (n < 0)
+          return total > 0 ? total : -1;
+        if (n == 0)
+          break;
+        sink(chunk.constData(), n);
+        total += n;
+      }
+      return total;
     }
 
-    // Retrieve a stream for use
-    static QTextStream &getStreamInUse(int fd) { return streams[fd]; }
+    // Writes length bytes of data to the file, through its write buffer.
+    // Returns the number of bytes written, or -1 on error.
+    qint64 write(int fd, const char *data, qint64 length) {
+      auto &hostFile = files.at(fd);
+      if (hostFile.writeBuffer.size() + length > bufferSize) {
+        if (!flush(hostFile))
+          return -1;
+        if (length >= bufferSize)
+          return hostFile.file.write(data, length);
+      }
+      hostFile.writeBuffer.append(data, length);
+      return length;
+    }
 
     // Determine whether a given filename is already in use.
-    static bool filenameInUse(const QString &requestedFilename) {
+    bool filenameInUse(const QString &requestedFilename) {
       return llvm::any_of(fileNames, [&](auto fn) {
         return !fn.second.isEmpty() && fn.second == requestedFilename;
       });
     }
 
     // Determine whether a given fd is already in use with the given flag.
-    static bool fdInUse(int fd, int flag) {
-      if (fd < 0 || fd >= SYSCALL_MAXFILES) {
+    bool fdInUse(int fd, int flag) {
+      if (fd < 0 || fd >= maxFiles) {
         return false;
       } else if (fileNames[fd].isEmpty()) {
         return false;
@@ -198,62 +372,79 @@ private:
       return false;
     }
 
+    // Determine whether a given fd is open for reading, or for writing.
+    bool fdReadable(int fd) {
+      return fdInUse(fd, 0) && (fileFlags[fd] & O_ACCMODE) != O_WRONLY;
+    }
+    bool fdWritable(int fd) {
+      return fdInUse(fd, 0) && (fileFlags[fd] & O_ACCMODE) != O_RDONLY;
+    }
+
     // Close the file with file descriptor fd. No errors are recoverable -- if
-    // the user's made an error in the call, it will come back to him.
-    static void close(int fd) {
+    // the user's made an error in the call, it will come back to them. The
+    // file is closed even if its buffered data could not be written, in which
+    // case -1 is returned.
+    int close(int fd) {
       // Can't close STDIN, STDOUT, STDERR, or invalid fd
-      if (fd < STDIO_END || fd >= SYSCALL_MAXFILES)
-        return;
-
-      fileFlags[fd] = -1;
-      files[fd].close();
-      streams.erase(fd);
+      if (fd < STDIO_END || !files.count(fd))
+        return 0;
+
+      auto &hostFile = files.at(fd);
+      const bool flushed = flush(hostFile);
+      if (hostFile.map)
+        hostFile.file.unmap(
+            reinterpret_cast<uchar *>(const_cast<char *>(hostFile.map)));
+      hostFile.file.close();
       files.erase(fd);
+      fileFlags.erase(fd);
       fileNames.erase(fd);
+      return flushed ? 0 : -1;
     }
 
     // Attempt to open a new file with the given flag, using the lowest
     // available file descriptor. Check that filename is not in use, flag is
     // reasonable, and there is an available file descriptor. Return: file
-    // descriptor in 0...(SYSCALL_MAXFILES-1), or -1 if error
-    static int nowOpening(const QString &filename, int flag) {
+    // descriptor in 0...(maxFiles-1), or -1 if error
+    int nowOpening(const QString &filename, int flag) {
       int i = 0;
       if (filenameInUse(filename)) {
-        s_fileErrorString = "File name " + filename + " is already open.";
+        fileErrorString = "File name " + filename + " is already open.";
         return -1;
       }
 
-      while (!fileNames[i].isEmpty() && i < SYSCALL_MAXFILES) {
+      while (i < maxFiles && !fileNames[i].isEmpty()) {
         i++;
       } // Attempt to find available file descriptor
 
-      if (i >= SYSCALL_MAXFILES) // no available file descriptors
+      if (i >= maxFiles) // no available file descriptors
       {
-        s_fileErrorString = "File name " + filename +
-                            " exceeds maximum open file limit of " +
-                            QString::number(SYSCALL_MAXFILES);
+        fileErrorString = "File name " + filename +
+                          " exceeds maximum open file limit of " +
+                          QString::number(maxFiles);
         return -1;
       }
 
       // Must be OK -- put filename in table
       fileNames[i] = filename; // our table has its own copy of filename
       fileFlags[i] = flag;
-      s_fileErrorString = "File operation OK";
+      fileErrorString = "File operation OK";
       return i;
     }
   };
 
+  FileIOData m_files{m_fileErrorString};
+
 public:
   /**
    * Open a file for either reading or writing.
    *
    * @param filename string containing filename
    * @param  flags    0 for read, 1 for write
-   * @return file descriptor in the range 0 to SYSCALL_MAXFILES-1, or -1 if
-   * error
+   * @return file descriptor in the range 0 to the maximum number of open
+   * files - 1, or -1 if error
    */
   static int openFile(QString filename, int flags) {
-    SystemIO::get(); // Ensure that SystemIO is constructed
+    auto &files = get().m_files;
     // Internally, a "file descriptor" is an index into a table
     // of the filename, flag, and the File???putStream associated with
     // that file descriptor.
@@ -262,16 +453,19 @@ public:
     int fdToUse;
 
     // Check internal plausibility of opening this file
-    fdToUse = FileIOData::nowOpening(filename, flags);
+    fdToUse = files.nowOpening(filename, flags);
     retValue = fdToUse; // return value is the fd
     if (fdToUse < 0) {
       return -1;
     } // fileErrorString would have been set
 
     try {
-      FileIOData::openFilestream(fdToUse, filename);
-    } catch (int) {
-      s_fileErrorString = "File " + filename + " could not be opened.";
+      files.openFilestream(fdToUse, filename);
+    } catch (const std::runtime_error &e) {
+      files.fileErrorString =
+          "File " + filename + " could not be opened: " + e.what();
+      files.fileNames.erase(fdToUse);
+      files.fileFlags.erase(fdToUse);
       retValue = -1;
     }
 
@@ -288,31 +482,33 @@ public:
    * @return -1 on error
    */
   static int seek(int fd, int offset, int base) {
-    SystemIO::get();                 // Ensure that SystemIO is constructed
-    if (!FileIOData::fdInUse(fd, 0)) // Check the existence of the "read" fd
+    auto &files = get().m_files;
+    if (!files.fdInUse(fd, 0)) // Check the existence of the "read" fd
     {
-      s_fileErrorString =
+      files.fileErrorString =
           "File descriptor " + QString::number(fd) + " is not open for reading";
       return -1;
     }
-    if (fd < 0 || fd >= SYSCALL_MAXFILES)
+    if (!files.files.count(fd))
       return -1;
-    auto &stream = FileIOData::getStreamInUse(fd);
 
+    qint64 position = offset;
     if (base == SEEK_SET) {
-      offset += 0;
-    } else if (base == SEEK_CUR) {
-      offset += stream.pos();
-    } else if (base == SEEK_END) {
-      offset += FileIOData::files[fd].size();
+      position += 0;
+    } else if (base == SEEK_CUR || base == SEEK_END) {
+      // fileErrorString is set if the position or size cannot be determined.
+      const qint64 reference =
+          base == SEEK_CUR ? files.pos(fd) : files.size(fd);
+      if (reference < 0)
+        return -1;
+      position += reference;
     } else {
       return -1;
     }
-    if (offset < 0) {
+    if (position < 0 || !files.seek(fd, position)) {
       return -1;
     }
-    stream.seek(offset);
-    return offset;
+    return position;
   }
 
   /**
@@ -324,68 +520,68 @@ public:
    * @return number of bytes read, 0 on EOF, or -1 on error
    */
   static int readFromFile(int fd, QByteArray &myBuffer, int lengthRequested) {
-    s_abortSyscall = false; // Reset any stale abort requests
-    SystemIO::get();        // Ensure that SystemIO is constructed
+    myBuffer.clear();
+    return readFromFile(fd, lengthRequested, [&](const char *data, qint64 n) {
+      myBuffer.append(data, n);
+    });
+  }
+
+  /**
+   * Read bytes from file, as readFromFile() above, passing the bytes read to
+   * @p sink as one or more (const char *, qint64) spans rather than collecting
+   * them in a buffer. Spans of files which are mapped into memory point
+   * directly into the mapping.
+   */
+  template <typename Sink>
+  static int readFromFile(int fd, int lengthRequested, Sink &&sink) {
+    auto &sio = get();
+    auto &files = sio.m_files;
+    sio.m_abortSyscall = false; // Reset any stale abort requests
     /////////////// DPS 8-Jan-2013
     /////////////////////////////////////////////////////
     /// Read from STDIN file descriptor while using IDE - get input from
     /// Messages pane.
-    if (!FileIOData::fdInUse(fd,
-                             O_RDONLY)) // Check the existence of the "read" fd
+    if (!files.fdReadable(fd)) // Check the existence of the "read" fd
     {
-      s_fileErrorString =
+      files.fileErrorString =
           "File descriptor " + QString::number(fd) + " is not open for reading";
       return -1;
     }
-    // retrieve FileInputStream from storage
-    auto &InputStream = FileIOData::getStreamInUse(fd);
-
     if (fd == STDIN) {
-      // systemIO might be called from non-gui thread, so be threadsafe in
-      // interacting with the ui.
-      postToGUIThread([=] {
-        SystemIOStatusManager::setStatusTimed("Waiting for user input...",
-                                              99999999);
-      });
-      while (myBuffer.size() < lengthRequested) {
-        // Lock the stdio objects and try to read from stdio. If no data is
-        // present, wait until so.
-        FileIOData::s_stdioMutex.lock();
-        if (s_abortSyscall) {
-          FileIOData::s_stdioMutex.unlock();
-          s_abortSyscall = false;
-          postToGUIThread([=] { SystemIOStatusManager::clearStatus(); });
-          return -1;
+      // Lock the stdio objects and read whatever is present in the stdin
+      // buffer, up to lengthRequested bytes. If no data is present, wait until
+      // so, or until the end of stdin, in which case 0 bytes are read.
+      QMutexLocker locker(&files.stdioMutex);
+      if (files.stdinAvailable() == 0 && !files.stdinEOF) {
+        // systemIO might be called from non-gui thread, so be threadsafe in
+        // interacting with the ui.
+        postToGUIThread([=] {
+          SystemIOStatusManager::setStatusTimed("Waiting for user input...",
+                                                99999999);
+        });
+        while (files.stdinAvailable() == 0 && !files.stdinEOF) {
+          if (sio.m_abortSyscall) {
+            sio.m_abortSyscall = false;
+            postToGUIThread([=] { SystemIOStatusManager::clearStatus(); });
+            return -1;
+          }
+          /** We spin on a wait condition with a timeout. The timeout is
+           * required to ensure that we may observe any abort flags (ie. if
+           * execution is stopped while waiting for IO */
+          files.stdinBufferEmpty.wait(&files.stdioMutex, 100);
         }
-        auto readData = InputStream.read(lengthRequested).toUtf8();
-        myBuffer.append(readData);
-        lengthRequested -= readData.length();
-
-        /** We spin on a wait condition with a timeout. The timeout is required
-         * to ensure that we may observe any abort flags (ie. if execution is
-         * stopped while waiting for IO */
-        FileIOData::s_stdinBufferEmpty.wait(&FileIOData::s_stdioMutex, 100);
-        FileIOData::s_stdioMutex.unlock();
-        if (myBuffer.endsWith('\n'))
-          break;
-      }
-    } else {
-      // Reads up to lengthRequested bytes of data from this Input stream into
-      // an array of bytes.
-      myBuffer = InputStream.read(lengthRequested).toUtf8();
-    }
-
-    if (myBuffer.size() == 0) {
-      if (fd == STDIN) {
-        Q_ASSERT(false); // EOF should never be possible for STDIN
-      } else {
-        // End of file - write EOF file character into buffer
-        myBuffer.append(sizeof(int), EOF);
+        postToGUIThread([=] { SystemIOStatusManager::clearStatus(); });
       }
+      const QByteArray data = files.takeStdin(lengthRequested);
+      locker.unlock();
+      if (!data.isEmpty())
+        sink(data.constData(), data.size());
+      return data.size();
     }
 
-    postToGUIThread([=] { SystemIOStatusManager::clearStatus(); });
-    return myBuffer.size();
+    // Reads up to lengthRequested bytes of data from the host file; 0 bytes
+    // are read at the end of the file.
+    return files.read(fd, lengthRequested, sink);
 
   } // end readFromFile
 
@@ -398,26 +594,24 @@ public:
    * @return number of bytes written, or -1 on error
    */
 
-  static int writeToFile(int fd, const QString &myBuffer, int lengthRequested) {
-    SystemIO::get(); // Ensure that SystemIO is constructed
+  static int writeToFile(int fd, const QByteArray &myBuffer,
+                         int lengthRequested) {
+    auto &sio = get();
+    auto &files = sio.m_files;
     if (fd == STDOUT || fd == STDERR) {
-      emit get().doPrint(myBuffer);
+      sio.writeOutput(myBuffer);
       return myBuffer.size();
     }
 
-    if (!FileIOData::fdInUse(
-            fd, O_WRONLY | O_RDWR)) // Check the existence of the "write" fd
+    if (!files.fdWritable(fd)) // Check the existence of the "write" fd
     {
-      s_fileErrorString =
+      files.fileErrorString =
           "File descriptor " + QString::number(fd) + " is not open for writing";
       return -1;
     }
-    // retrieve FileOutputStream from storage
-    auto &outputStream = FileIOData::getStreamInUse(fd);
 
-    outputStream << myBuffer;
-    outputStream.flush();
-    return lengthRequested;
+    return files.write(fd, myBuffer.constData(),
+                       std::min<qint64>(myBuffer.size(), lengthRequested));
 
   } // end writeToFile
 
@@ -425,15 +619,210 @@ public:
    * Close the file with specified file descriptor
    *
    * @param fd the file descriptor of an open file
+   * @return 0 on success, or -1 if the buffered data of the file could not be
+   * written
    */
-  static void closeFile(int fd) { FileIOData::close(fd); }
+  static int closeFile(int fd) { return get().m_files.close(fd); }
+
+  /// The status of an open file, as reported by the fstat syscall.
+  struct FileStat {
+    // Whether the file is a character device (the standard i/o channels),
+    // rather than a regular file.
+    bool isCharDevice;
+    qint64 size;
+    // The preferred block size for writing to the file.
+    int blockSize;
+  };
 
-  static void printString(const QString &string) { emit get().doPrint(string); }
-  static void reset() { FileIOData::resetFiles(); }
-  static void abortSyscall() { s_abortSyscall = true; }
+  /**
+   * @brief fileStat
+   * Retrieves the status of the file with file descriptor @p fd into
+   * @p stat. Returns false if @p fd is not open, or if its size cannot be
+   * determined.
+   */
+  static bool fileStat(int fd, FileStat &stat) {
+    auto &files = get().m_files;
+    if (!files.fdInUse(fd, 0)) {
+      files.fileErrorString =
+          "File descriptor " + QString::number(fd) + " is not open";
+      return false;
+    }
+    if (fd < STDIO_END) {
+      stat = {true, 0, 0};
+      return true;
+    }
+    stat = {false, files.size(fd), files.bufferSize};
+    return stat.size >= 0;
+  }
+
+  /**
+   * @brief setFileLimits
+   * Sets the maximum number of open files (including the standard i/o
+   * channels), and the size of the write buffer of each file opened through
+   * the file syscalls. Applies to files opened hereafter.
+   */
+  static void setFileLimits(int maxFiles, int bufferSize) {
+    auto &files = get().m_files;
+    files.maxFiles = std::max<int>(maxFiles, STDIO_END);
+    files.bufferSize = std::max(bufferSize, 1);
+  }
+
+  /// A file opened through the file syscalls, as captured by openFiles().
+  struct OpenFile {
+    int fd;
+    QString name;
+    unsigned flags;
+    qint64 position;
+  };
+
+  /**
+   * @brief openFiles
+   * Returns the files which are currently open, excluding the standard i/o
+   * channels.
+   */
+  static std::vector<OpenFile> openFiles() {
+    auto &files = get().m_files;
+    std::vector<OpenFile> open;
+    for (const auto &[fd, name] : files.fileNames) {
+      if (fd < STDIO_END || name.isEmpty() || !files.files.count(fd))
+        continue;
+      open.push_back({fd, name, files.fileFlags.at(fd), files.pos(fd)});
+    }
+    return open;
+  }
+
+  /**
+   * @brief restoreFile
+   * Reopens @p file under its original file descriptor and seeks to its
+   * captured position. The file is neither created nor truncated. Returns an
+   * error string on failure.
+   */
+  static QString restoreFile(const OpenFile &file) {
+    auto &files = get().m_files;
+    if (file.fd < STDIO_END || file.fd >= files.maxFiles ||
+        !files.fileNames[file.fd].isEmpty()) {
+      return "File descriptor " + QString::number(file.fd) +
+             " is not available.";
+    }
+
+    files.fileNames[file.fd] = file.name;
+    files.fileFlags[file.fd] = file.flags & ~(O_CREAT | O_TRUNC | O_EXCL);
+    try {
+      files.openFilestream(file.fd, file.name);
+    } catch (const std::runtime_error &e) {
+      files.fileNames.erase(file.fd);
+      return "File " + file.name + " could not be reopened: " + e.what();
+    }
+    if (!files.seek(file.fd, file.position))
+      return "File " + file.name + " could not be repositioned.";
+    return QString();
+  }
+
+  /**
+   * @brief feedStdIn
+   * Pushes @p size bytes of @p data onto the stdin buffer, blocking while
+   * STDIN_BUFFER_SIZE or more bytes are unread, such that stdin may be
+   * streamed from an arbitrarily large source. Returns false if stdin has been
+   * closed, in which case @p data is discarded.
+   */
+  bool feedStdIn(const char *data, qsizetype size) {
+    QMutexLocker locker(&m_files.stdioMutex);
+    while (m_files.stdinAvailable() >= STDIN_BUFFER_SIZE && !m_files.stdinEOF)
+      m_files.stdinBufferFull.wait(&m_files.stdioMutex);
+    if (m_files.stdinEOF)
+      return false;
+    m_files.stdinBuffer.append(data, size);
+    m_files.stdinBufferEmpty.wakeAll();
+    return true;
+  }
+
+  /**
+   * @brief closeStdIn
+   * Marks the end of stdin; reads from stdin return 0 bytes once the buffer is
+   * drained. Any blocked feedStdIn() call returns.
+   */
+  void closeStdIn() {
+    QMutexLocker locker(&m_files.stdioMutex);
+    m_files.stdinEOF = true;
+    m_files.stdinBufferEmpty.wakeAll();
+    m_files.stdinBufferFull.wakeAll();
+  }
+
+  /// Returns whether a read from stdin would return without waiting for
+  /// input.
+  static bool stdInReady() {
+    auto &files = get().m_files;
+    QMutexLocker locker(&files.stdioMutex);
+    return files.stdinAvailable() > 0 || files.stdinEOF;
+  }
+
+  static void printString(const QString &string) {
+    get().writeOutput(string.toUtf8());
+  }
+  static void printBytes(const QByteArray &bytes) { get().writeOutput(bytes); }
+  static void reset() { get().m_files.resetFiles(); }
+  static void abortSyscall() { get().m_abortSyscall = true; }
+
+  /**
+   * @brief setRunStopping
+   * Signals whether the current run is being stopped, in which case the
+   * consumer of the output may be waiting for the run to finish (see
+   * writeOutput). Cleared when a run starts, and set when it is stopped.
+   */
+  void setRunStopping(bool stopping) { m_runStopping = stopping; }
+
+  /**
+   * @brief enableOutputBuffer
+   * Appends the output to stdout/stderr to a byte ring rather than emitting
+   * doPrint for each write, such that the simulation thread is not throttled
+   * by the event loop of the receiver. The output must be drained by a single
+   * consumer (consumer 0 of the returned ring) in @p consumerThread; either
+   * through flushOutput(), or by acquiring from the ring directly. If already
+   * enabled, the existing ring is returned.
+   */
+  std::shared_ptr<SPMCRing<char>>
+  enableOutputBuffer(QThread *consumerThread = nullptr) {
+    if (!m_output) {
+      m_output = std::make_shared<SPMCRing<char>>(OUTPUT_BUFFER_SIZE_LOG2, 1);
+      m_outputConsumer = consumerThread;
+    }
+    return m_output;
+  }
+
+  /**
+   * @brief disableOutputBuffer
+   * Closes the output ring, such that its consumer drains the remaining
+   * output. Subsequent output is emitted through doPrint. Must not be called
+   * while output is written.
+   */
+  void disableOutputBuffer() {
+    if (!m_output)
+      return;
+    m_output->close();
+    m_output.reset();
+    m_outputConsumer = nullptr;
+  }
+
+  /**
+   * @brief flushOutput
+   * Consumer: emits the output buffered so far through doPrint, in a single
+   * signal. Has no effect unless called from the consumer thread.
+   */
+  void flushOutput() {
+    if (!m_output || QThread::currentThread() != m_outputConsumer)
+      return;
+    QByteArray bytes;
+    const char *data;
+    while (const size_t n = m_output->tryAcquire(0, data)) {
+      bytes.append(data, n);
+      m_output->release(0, n);
+    }
+    if (!bytes.isEmpty())
+      emit doPrint(bytes);
+  }
 
 signals:
-  void doPrint(const QString &);
+  void doPrint(const QByteArray &);
 
 public slots:
   /**
@@ -441,14 +830,53 @@ public slots:
    * Pushes @p data onto the stdin buffer object
    */
   void putStdInData(const QByteArray &data) {
-    FileIOData::s_stdioMutex.lock();
-    FileIOData::s_stdinBuffer.append(data);
-    FileIOData::s_stdinBufferEmpty.wakeAll();
-    FileIOData::s_stdioMutex.unlock();
+    m_files.stdioMutex.lock();
+    m_files.stdinBuffer.append(data);
+    m_files.stdinBufferEmpty.wakeAll();
+    m_files.stdioMutex.unlock();
   }
 
 private:
-  SystemIO() { reset(); }
+  /**
+   * @brief writeOutput
+   * Writes @p bytes to the console; either through the output ring (if
+   * enabled) or by emitting doPrint.
+   */
+  void writeOutput(const QByteArray &bytes) {
+    if (!m_output) {
+      emit doPrint(bytes);
+      return;
+    }
+    if (QThread::currentThread() == m_outputConsumer) {
+      // The consumer cannot drain the ring while it is blocked in pushing to
+      // it (ie. when the processor is clocked from the GUI thread). Flush the
+      // buffered output first, to retain the order of the output.
+      flushOutput();
+      emit doPrint(bytes);
+      return;
+    }
+    // Once the run is being stopped, the consumer may be waiting for the run
+    // to finish, and only drains the ring in the meantime (see
+    // ProcessorHandler::_stopRun). The output is then emitted directly once the
+    // ring has been drained, such that it follows the buffered output.
+    size_t pushed = 0;
+    if (!m_runStopping)
+      pushed = m_output->push(bytes.constData(), bytes.size(),
+                              [this] { return m_runStopping.load(); });
+    if (pushed < static_cast<size_t>(bytes.size())) {
+      m_output->waitDrained();
+      emit doPrint(bytes.mid(pushed));
+    }
+  }
+
+  // 1 MiB of output is buffered before the simulation thread blocks on the
+  // consumer, unless the run is being stopped.
+  static constexpr unsigned OUTPUT_BUFFER_SIZE_LOG2 = 20;
+  std::shared_ptr<SPMCRing<char>> m_output;
+  QThread *m_outputConsumer = nullptr;
+
+  SystemIO() { m_files.resetFiles(); }
+  friend class SimulationContext;
 };
 
 } // namespace Ripes
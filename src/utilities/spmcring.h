@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace Ripes {
+
+/**
+ * @brief The SPMCRing class
+ * Bounded, lock-free single-producer/multi-consumer ring buffer. Every consumer
+ * observes every element pushed by the producer (broadcast), and progresses at
+ * its own pace. The producer blocks while the slowest consumer is a full ring
+ * behind.
+ *
+ * Elements are consumed in place: acquire() exposes a contiguous span of
+ * unconsumed elements, which remain valid until released through release().
+ */
+template <typename T>
+class SPMCRing {
+public:
+  SPMCRing(unsigned sizeLog2, unsigned consumers)
+      : m_mask((uint64_t(1) << sizeLog2) - 1), m_slots(m_mask + 1),
+        m_tails(consumers) {}
+
+  uint64_t capacity() const { return m_mask + 1; }
+
+  /**
+   * @brief push
+   * Producer: appends @p n elements to the ring, blocking while the ring is
+   * full.
+   */
+  void push(const T *items, size_t n) {
+    push(items, n, [] { return false; });
+  }
+
+  /**
+   * @brief push
+   * Producer: as push(), but stops blocking on a full ring once @p abort
+   * returns true. Returns the number of elements appended.
+   */
+  template <typename Abort>
+  size_t push(const T *items, size_t n, Abort &&abort) {
+    uint64_t head = m_head.load(std::memory_order_relaxed);
+    unsigned spins = 0;
+    size_t pushed = 0;
+    while (n > 0) {
+      uint64_t free = capacity() - (head - m_minTail);
+      if (free == 0) {
+        m_minTail = minTail();
+        free = capacity() - (head - m_minTail);
+        if (free == 0) {
+          if (abort())
+            break;
+          backoff(spins);
+          continue;
+        }
+      }
+      const size_t count = std::min<uint64_t>(n, free);
+      for (size_t i = 0; i < count; ++i) {
+        m_slots[(head + i) & m_mask] = items[i];
+      }
+      head += count;
+      items += count;
+      n -= count;
+      pushed += count;
+      m_head.store(head, std::memory_order_release);
+      spins = 0;
+    }
+    return pushed;
+  }
+
+  /**
+   * @brief waitDrained
+   * Producer: blocks until all consumers have released every pushed element.
+   */
+  void waitDrained() {
+    const uint64_t head = m_head.load(std::memory_order_relaxed);
+    unsigned spins = 0;
+    while ((m_minTail = minTail()) != head) {
+      backoff(spins);
+    }
+  }
+
+  /**
+   * @brief close
+   * Producer: signals that no more elements will be pushed. Consumers drain the
+   * remaining elements, after which acquire() returns 0.
+   */
+  void close() { m_closed.store(true, std::memory_order_release); }
+
+  /**
+   * @brief acquire
+   * Consumer: blocks until elements are available to @p consumer, and sets
+   * @p items to point to the oldest unconsumed element. Returns the number of
+   * contiguous elements available, or 0 if the ring is closed and drained.
+   */
+  size_t acquire(unsigned consumer, const T *&items) {
+    const uint64_t tail = m_tails[consumer].pos.load(std::memory_order_relaxed);
+    uint64_t head;
+    unsigned spins = 0;
+    while ((head = m_head.load(std::memory_order_acquire)) == tail) {
+      if (m_closed.load(std::memory_order_acquire)) {
+        // The head must be reloaded; elements may have been pushed in between
+        // loading the head and observing the ring as closed.
+        head = m_head.load(std::memory_order_acquire);
+        if (head == tail) {
+          return 0;
+        }
+        break;
+      }
+      backoff(spins);
+    }
+    const uint64_t offset = tail & m_mask;
+    items = &m_slots[offset];
+    return std::min(head - tail, capacity() - offset);
+  }
+
+  /**
+   * @brief tryAcquire
+   * Consumer: as acquire(), but returns 0 rather than blocking if no elements
+   * are available to @p consumer.
+   */
+  size_t tryAcquire(unsigned consumer, const T *&items) {
+    const uint64_t tail = m_tails[consumer].pos.load(std::memory_order_relaxed);
+    const uint64_t head = m_head.load(std::memory_order_acquire);
+    if (head == tail) {
+      return 0;
+    }
+    const uint64_t offset = tail & m_mask;
+    items = &m_slots[offset];
+    return std::min(head - tail, capacity() - offset);
+  }
+
+  /**
+   * @brief release
+   * Consumer: marks the @p n oldest acquired elements of @p consumer as
+   * consumed.
+   */
+  void release(unsigned consumer, size_t n) {
+    auto &pos = m_tails[consumer].pos;
+    pos.store(pos.load(std::memory_order_relaxed) + n,
+              std::memory_order_release);
+  }
+
+private:
+  // Each cursor resides on a separate cache line to avoid false sharing
+  // between the producer and consumers.
+  struct alignas(64) Cursor {
+    std::atomic<uint64_t> pos{0};
+  };
+
+  uint64_t minTail() const {
+    uint64_t tail = m_head.load(std::memory_order_relaxed);
+    for (const auto &cursor : m_tails) {
+      tail = std::min(tail, cursor.pos.load(std::memory_order_acquire));
+    }
+    return tail;
+  }
+
+  /// Spins briefly before yielding the CPU to avoid starving a slow producer
+  /// (ie. a processor model) of CPU time.
+  static void backoff(unsigned &spins) {
+    if (++spins < 64) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  }
+
+  const uint64_t m_mask;
+  std::vector<T> m_slots;
+  alignas(64) std::atomic<uint64_t> m_head{0};
+  std::vector<Cursor> m_tails;
+  std::atomic<bool> m_closed{false};
+
+  // Producer-local cache of the slowest consumer position.
+  uint64_t m_minTail = 0;
+};
+
+} // namespace Ripes
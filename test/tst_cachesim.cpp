@@ -0,0 +1,385 @@
+#include <QtTest/QTest>
+
+#include <memory>
+#include <random>
+#include <thread>
+
+#include "cachesim/cacheaccesslog.h"
+#include "cachesim/cachehierarchy.h"
+#include "cachesim/cachereplacement.h"
+#include "utilities/spmcring.h"
+
+using namespace Ripes;
+
+// This test ensures that the cache replacement engines select the expected
+// victims, that all replacement state updates can be reverted, that the access
+// ring buffer of cache sweeps delivers every access to every consumer, that
+// the compact cache access log reproduces the recorded access statistics, and
+// that multi-level cache hierarchies honor their inclusion policies.
+
+class tst_cachesim : public QObject {
+  Q_OBJECT
+
+private slots:
+  void tst_lru();
+  void tst_replacementUndo();
+  void tst_spmcRing();
+  void tst_accessLog();
+  void tst_hierarchy();
+};
+
+void tst_cachesim::tst_lru() {
+  // Compare the O(1) LRU engine against a reference model of per-way ages.
+  constexpr unsigned lines = 4;
+  for (unsigned ways : {1, 2, 8, 64}) {
+    LRUEngine engine;
+    engine.reset(lines, ways);
+    std::vector<std::vector<int>> ages(lines, std::vector<int>(ways, -1));
+    std::vector<unsigned> validWays(lines, 0);
+    std::mt19937 gen(ways);
+
+    for (unsigned i = 0; i < 10000; ++i) {
+      const unsigned line = gen() % lines;
+      const bool fill = validWays[line] == 0 || gen() % 3 == 0;
+      unsigned way;
+      if (fill) {
+        if (validWays[line] < ways) {
+          way = validWays[line]++;
+        } else {
+          way = engine.victim(line);
+          const auto oldest =
+              std::max_element(ages[line].begin(), ages[line].end());
+          QCOMPARE(way, static_cast<unsigned>(oldest - ages[line].begin()));
+        }
+      } else {
+        way = gen() % validWays[line];
+      }
+
+      for (auto &age : ages[line]) {
+        if (age >= 0) {
+          age++;
+        }
+      }
+      ages[line][way] = 0;
+      engine.touch(line, way, fill);
+
+      for (unsigned w = 0; w < validWays[line]; ++w) {
+        int rank = 0;
+        for (unsigned o = 0; o < validWays[line]; ++o) {
+          rank += ages[line][o] < ages[line][w] ? 1 : 0;
+        }
+        QCOMPARE(engine.rank(line, w), static_cast<unsigned>(rank));
+      }
+    }
+  }
+}
+
+void tst_cachesim::tst_replacementUndo() {
+  // Perform a sequence of accesses, and verify that reverting the accesses in
+  // LIFO order restores the victim selection of each line at every step.
+  constexpr unsigned lines = 4;
+  for (unsigned ways : {1, 2, 4, 16, 128}) {
+    std::vector<std::unique_ptr<ReplacementEngine>> engines;
+    engines.push_back(std::make_unique<LRUEngine>());
+    engines.push_back(std::make_unique<PLRUEngine>());
+    engines.push_back(std::make_unique<FIFOEngine>());
+    engines.push_back(std::make_unique<NRUEngine>());
+
+    for (auto &engine : engines) {
+      struct Access {
+        unsigned line, way;
+        bool fill;
+        ReplacementEngine::UndoToken token;
+      };
+      engine->reset(lines, ways);
+      std::vector<unsigned> validWays(lines, 0);
+      std::vector<Access> accesses;
+      std::vector<std::vector<unsigned>> states;
+      std::mt19937 gen(ways);
+
+      auto state = [&] {
+        std::vector<unsigned> s;
+        for (unsigned line = 0; line < lines; ++line) {
+          s.push_back(engine->victim(line));
+          for (unsigned way = 0; way < ways; ++way) {
+            s.push_back(engine->rank(line, way));
+          }
+        }
+        return s;
+      };
+
+      for (unsigned i = 0; i < 5000; ++i) {
+        const unsigned line = gen() % lines;
+        const bool fill = validWays[line] == 0 || gen() % 3 == 0;
+        unsigned way;
+        if (fill) {
+          way = validWays[line] < ways ? validWays[line]++
+                                       : engine->victim(line);
+        } else {
+          way = gen() % validWays[line];
+        }
+        states.push_back(state());
+        accesses.push_back({line, way, fill, engine->touch(line, way, fill)});
+      }
+
+      while (!accesses.empty()) {
+        const auto &access = accesses.back();
+        engine->revert(access.line, access.way, access.fill, access.token);
+        QVERIFY(state() == states.back());
+        accesses.pop_back();
+        states.pop_back();
+      }
+    }
+  }
+}
+
+void tst_cachesim::tst_spmcRing() {
+  // Push a sequence through a small ring with several consumers, each of which
+  // must observe the entire sequence, in order.
+  constexpr unsigned consumers = 4;
+  constexpr uint64_t count = 100000;
+  SPMCRing<uint64_t> ring(6, consumers);
+  std::vector<uint64_t> sums(consumers, 0);
+  std::vector<int> inOrder(consumers, 1);
+
+  std::vector<std::thread> threads;
+  for (unsigned c = 0; c < consumers; ++c) {
+    threads.emplace_back([&, c] {
+      uint64_t expected = 0;
+      const uint64_t *items;
+      while (size_t n = ring.acquire(c, items)) {
+        for (size_t i = 0; i < n; ++i) {
+          inOrder[c] &= items[i] == expected++;
+          sums[c] += items[i];
+        }
+        ring.release(c, n);
+      }
+    });
+  }
+
+  std::vector<uint64_t> batch;
+  for (uint64_t v = 0; v < count;) {
+    batch.clear();
+    for (unsigned i = 0; i < v % 100 && v < count; ++i) {
+      batch.push_back(v++);
+    }
+    if (batch.empty()) {
+      batch.push_back(v++);
+    }
+    ring.push(batch.data(), batch.size());
+  }
+  ring.waitDrained();
+  ring.close();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  for (unsigned c = 0; c < consumers; ++c) {
+    QVERIFY(inOrder[c]);
+    QCOMPARE(sums[c], count * (count - 1) / 2);
+  }
+
+  // tryAcquire does not block on an empty ring, and exposes contiguous spans
+  // up to the end of the ring.
+  SPMCRing<char> bytes(3, 1);
+  const char *data;
+  QCOMPARE(bytes.tryAcquire(0, data), size_t(0));
+  bytes.push("abcde", 5);
+  QCOMPARE(bytes.tryAcquire(0, data), size_t(5));
+  bytes.release(0, 5);
+  bytes.push("fghij", 5);
+  QCOMPARE(bytes.tryAcquire(0, data), size_t(3));
+  QCOMPARE(QByteArray(data, 3), QByteArray("fgh"));
+  bytes.release(0, 3);
+  QCOMPARE(bytes.tryAcquire(0, data), size_t(2));
+  QCOMPARE(QByteArray(data, 2), QByteArray("ij"));
+  bytes.release(0, 2);
+  QCOMPARE(bytes.tryAcquire(0, data), size_t(0));
+
+  // An aborted push returns rather than blocking on a full ring.
+  QCOMPARE(bytes.push("klmnopqrstu", 11, [] { return true; }), size_t(8));
+  QCOMPARE(bytes.tryAcquire(0, data), size_t(6));
+  QCOMPARE(QByteArray(data, 6), QByteArray("klmnop"));
+}
+
+void tst_cachesim::tst_accessLog() {
+  // Record a random sequence of accesses (including undos, and cycle gaps which
+  // exceed the inline delta encoding), and compare every read of the log
+  // against a reference list of cumulative statistics.
+  CacheAccessLog log;
+  std::vector<CacheAccessLog::Entry> reference;
+  std::mt19937 gen(0);
+
+  auto verifyReadAfter = [&](uint64_t cycle) {
+    auto it = std::upper_bound(
+        reference.begin(), reference.end(), cycle,
+        [](uint64_t c, const auto &e) { return c < e.cycle; });
+    CacheAccessLog::Entry entry;
+    auto reader = log.readAfter(cycle);
+    for (; it != reference.end(); ++it) {
+      QVERIFY(reader.next(entry));
+      QCOMPARE(entry.cycle, it->cycle);
+      QCOMPARE(entry.type, it->type);
+      QCOMPARE(entry.isHit, it->isHit);
+      QCOMPARE(entry.isWriteback, it->isWriteback);
+      QCOMPARE(entry.counters.hits, it->counters.hits);
+      QCOMPARE(entry.counters.misses, it->counters.misses);
+      QCOMPARE(entry.counters.reads, it->counters.reads);
+      QCOMPARE(entry.counters.writes, it->counters.writes);
+      QCOMPARE(entry.counters.writebacks, it->counters.writebacks);
+    }
+    QVERIFY(!reader.next(entry));
+  };
+
+  uint64_t cycle = 0;
+  for (unsigned i = 0; i < 50000; ++i) {
+    if (!reference.empty() && gen() % 4 == 0) {
+      log.pop();
+      reference.pop_back();
+      cycle = reference.empty() ? 0 : reference.back().cycle;
+    } else {
+      cycle += gen() % 8 == 0 ? gen() % 1000 : gen() % 3;
+      CacheAccessLog::Entry entry;
+      entry.cycle = cycle;
+      entry.type = gen() % 2 ? MemoryAccess::Read : MemoryAccess::Write;
+      entry.isHit = gen() % 2;
+      entry.isWriteback = !entry.isHit && gen() % 2;
+      entry.counters = reference.empty() ? CacheAccessLog::Counters()
+                                         : reference.back().counters;
+      entry.counters.hits += entry.isHit;
+      entry.counters.misses += !entry.isHit;
+      entry.counters.reads += entry.type == MemoryAccess::Read;
+      entry.counters.writes += entry.type == MemoryAccess::Write;
+      entry.counters.writebacks += entry.isWriteback;
+      log.push(entry.cycle, entry.type, entry.isHit, entry.isWriteback);
+      reference.push_back(entry);
+    }
+
+    QCOMPARE(log.size(), reference.size());
+    if (!reference.empty()) {
+      QCOMPARE(log.lastCycle(), reference.back().cycle);
+      QCOMPARE(log.counters().hits, reference.back().counters.hits);
+      QCOMPARE(log.counters().writebacks, reference.back().counters.writebacks);
+    }
+    if (i % 5000 == 0 && !reference.empty()) {
+      verifyReadAfter(reference[gen() % reference.size()].cycle);
+    }
+  }
+  verifyReadAfter(0);
+  verifyReadAfter(cycle / 2);
+}
+
+static bool isCached(const CacheSim &cache, AInt address) {
+  const unsigned lineIdx = cache.getLineIdx(address);
+  for (int wayIdx = 0; wayIdx < cache.getWays(); ++wayIdx) {
+    const auto way = cache.getWay(lineIdx, wayIdx);
+    if (way.valid && way.tag == cache.getTag(address)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void tst_cachesim::tst_hierarchy() {
+  // Single-line caches of single-word blocks, such that any two addresses
+  // conflict.
+  auto level = [](int ways, InclusionPolicy inclusion) {
+    CacheHierarchy::LevelConfig config;
+    config.preset = CachePreset{"", 0, 0, ways, WritePolicy::WriteBack,
+                                WriteAllocPolicy::WriteAllocate,
+                                ReplPolicy::LRU};
+    config.inclusion = inclusion;
+    return config;
+  };
+  constexpr AInt a = 0x1000;
+  constexpr AInt b = 0x2000;
+
+  for (InclusionPolicy inclusion :
+       {InclusionPolicy::NINE, InclusionPolicy::Inclusive}) {
+    // A 2-way L1 backed by a 1-way L2. Evicting 'a' from the L2 invalidates it
+    // in the L1 iff. the L2 is inclusive.
+    CacheHierarchy::Config config;
+    config.levels[CacheHierarchy::L1D] = level(1, InclusionPolicy::NINE);
+    config.levels[CacheHierarchy::L2] = level(0, inclusion);
+    CacheHierarchy hierarchy(config, 4);
+    const CacheSim &l1 = *hierarchy.cache(CacheHierarchy::L1D);
+    const CacheSim &l2 = *hierarchy.cache(CacheHierarchy::L2);
+
+    hierarchy.access({a, MemoryAccess::Write, false});
+    hierarchy.access({b, MemoryAccess::Read, false});
+    QVERIFY(isCached(l2, b) && !isCached(l2, a));
+    QVERIFY(isCached(l1, b));
+    QCOMPARE(isCached(l1, a), inclusion == InclusionPolicy::NINE);
+    // The dirty block invalidated in the L1 is written back to memory.
+    QCOMPARE(l2.getWritebacks(), inclusion == InclusionPolicy::NINE ? 0u : 1u);
+  }
+
+  {
+    // A 1-way L1 backed by an exclusive 2-way L2, which only holds the blocks
+    // evicted from the L1.
+    CacheHierarchy::Config config;
+    config.memoryLatency = 100;
+    config.levels[CacheHierarchy::L1D] = level(0, InclusionPolicy::NINE);
+    config.levels[CacheHierarchy::L2] = level(1, InclusionPolicy::Exclusive);
+    CacheHierarchy hierarchy(config, 4);
+    const CacheSim &l1 = *hierarchy.cache(CacheHierarchy::L1D);
+    const CacheSim &l2 = *hierarchy.cache(CacheHierarchy::L2);
+
+    hierarchy.access({a, MemoryAccess::Read, false});
+    QVERIFY(isCached(l1, a) && !isCached(l2, a));
+    hierarchy.access({b, MemoryAccess::Read, false});
+    QVERIFY(isCached(l1, b) && !isCached(l2, b));
+    QVERIFY(isCached(l2, a));
+    hierarchy.access({a, MemoryAccess::Read, false});
+    QVERIFY(isCached(l1, a) && !isCached(l2, a));
+    QVERIFY(isCached(l2, b));
+    QCOMPARE(l2.getHits(), 1u);
+    QCOMPARE(l2.getMisses(), 2u);
+
+    // 3 L1 accesses, 3 L2 accesses and 2 memory accesses, beyond the single
+    // cycle of each of the 3 accesses of the processor.
+    QCOMPARE(hierarchy.estimatedStallCycles(), uint64_t(3 + 3 + 2 * 100 - 3));
+  }
+
+  {
+    // A 1-way L1 backed by a 2-way L2. Only the accesses of the processor and
+    // the block fetches of their misses are charged, not writebacks.
+    constexpr AInt c = 0x3000;
+    CacheHierarchy::Config config;
+    config.memoryLatency = 100;
+    config.levels[CacheHierarchy::L1D] = level(0, InclusionPolicy::NINE);
+    config.levels[CacheHierarchy::L1D]->latency = 2;
+    config.levels[CacheHierarchy::L2] = level(1, InclusionPolicy::NINE);
+    config.levels[CacheHierarchy::L2]->latency = 10;
+    CacheHierarchy hierarchy(config, 4);
+    const CacheSim &l2 = *hierarchy.cache(CacheHierarchy::L2);
+
+    // L1 miss, L2 miss.
+    hierarchy.access({a, MemoryAccess::Write, false});
+    QCOMPARE(hierarchy.estimatedStallCycles(), uint64_t(2 + 10 + 100 - 1));
+    // L1 miss, L2 miss, and a writeback of 'a' which hits in the L2.
+    hierarchy.access({b, MemoryAccess::Read, false});
+    QCOMPARE(hierarchy.estimatedStallCycles(),
+             uint64_t(2 * (2 + 10 + 100 - 1)));
+    // L1 miss, L2 hit.
+    hierarchy.access({a, MemoryAccess::Read, false});
+    // L1 hit.
+    hierarchy.access({a, MemoryAccess::Read, false});
+    // L1 miss, L2 miss, evicting 'b' from the L2.
+    hierarchy.access({c, MemoryAccess::Write, false});
+    // L1 miss, L2 miss, writing the dirty 'a' back to memory, and a writeback
+    // of 'c' which hits in the L2.
+    hierarchy.access({b, MemoryAccess::Read, false});
+    QCOMPARE(l2.getHits(), 3u);
+    QCOMPARE(l2.getMisses(), 4u);
+    QCOMPARE(l2.getWritebacks(), 1u);
+
+    // 6 L1 accesses, 5 L2 block fetches and 4 memory block fetches, beyond the
+    // single cycle of each of the 6 accesses of the processor.
+    QCOMPARE(hierarchy.estimatedStallCycles(),
+             uint64_t(6 * 2 + 5 * 10 + 4 * 100 - 6));
+  }
+}
+
+QTEST_MAIN(tst_cachesim)
+#include "tst_cachesim.moc"
@@ -1,304 +1,151 @@
 #include <QDir>
-#include <QProcess>
-#include <QResource>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QStringList>
+#include <QTemporaryDir>
 #include <QtTest/QTest>
 
-#include <optional>
-
-#include "processorhandler.h"
+#include "cli/cosimrunner.h"
 #include "processorregistry.h"
 
-#include "edittab.h"
-#include "isa/rvisainfo_common.h"
-#include "programloader.h"
-#include "ripessettings.h"
-
 /**
  * Ripes co-simulation
- * For a given test program, executes a reference model (RVSS) to generate a
- * trace of register modifications. Then, the target processor is simulated, and
- * its register trace is compared to the reference trace. From this, we can
- * detect whether (and where) register state divergence occurs, which indicates
- * an error in a processor implementation
+ * For a given test program, simulates the target processor model in lockstep
+ * with a reference model (RVSS), through the co-simulation mode of the CLI.
+ * The architectural effects of each instruction retired by the target model
+ * are compared to those of the reference model, such that a divergence
+ * indicates an error in the processor implementation.
  */
 
 using namespace Ripes;
-using namespace vsrtl::core;
-struct RegisterChange {
-  unsigned index;
-  VInt newValue;
-};
-
-// Maximum cycle count
-static constexpr unsigned s_maxCycles = 1000000;
-using Registers = std::map<int, VInt>;
-struct TraceEntry {
-  Registers regs;
-  unsigned long cycle;
-  AInt pc;
-};
-
-using Trace = std::vector<TraceEntry>;
 
 // Reference model
-// All tests will be compared against the trace generated by this processor
+// All tests are compared against the instructions retired by this processor
 // model.
 static constexpr ProcessorID s_referenceModel = ProcessorID::RV32_SS;
 
+// Upper bound on the duration of a co-simulation, in milliseconds.
+static constexpr int s_timeout = 60000;
+
+// A loop of dependent instructions, loads, stores and branches. No two
+// adjacent instructions write the same register, as the dual-issue processor
+// commits such pairs within the same cycle.
+static const QString s_dependentProgram = R"(
+    li a0, 0
+    li a1, 10
+    li a2, 1
+    lui a3, 0x10000
+loop:
+    add a0, a0, a2
+    slli a4, a0, 1
+    sub a2, a4, a2
+    andi a5, a0, 3
+    beqz a5, skip
+    sw a2, 0(a3)
+    lw a6, 0(a3)
+    add a0, a0, a6
+    addi a3, a3, 4
+skip:
+    bltu a2, a1, small
+    srli a2, a2, 3
+small:
+    addi a1, a1, -1
+    bnez a1, loop
+    li a7, 10
+    ecall
+)";
+
 // Test selection
 // s_testFiles denotes all of the test files that will be included in the
-// cosimulation run for each processor.
+// co-simulation run for each processor, in addition to s_dependentProgram.
 const QString s_testdir = RISCV32_TEST_DIR;
-const std::vector<LoadFileParams> s_testFiles = {
-    LoadFileParams{QString(s_testdir + QDir::separator() +
-                           "../../examples/assembly/complexMul.s"),
-                   SourceType::Assembly, 0, 0},
-    LoadFileParams{QString(s_testdir + QDir::separator() +
-                           "../../examples/assembly/factorial.s"),
-                   SourceType::Assembly, 0, 0},
-    LoadFileParams{QString(s_testdir + QDir::separator() +
-                           "../../examples/ELF/RanPi-RV32"),
-                   SourceType::ExternalELF, 0, 0}};
+const QStringList s_testFiles = {
+    s_testdir + QDir::separator() + "../../examples/assembly/complexMul.s",
+    s_testdir + QDir::separator() + "../../examples/assembly/factorial.s"};
 
 class tst_Cosimulate : public QObject {
   Q_OBJECT
 
-public:
-  explicit tst_Cosimulate() {}
-
 private:
-  void cosimulate(const ProcessorID &id, const QStringList &extensions);
-  const Trace &generateReferenceTrace(const QStringList &extensions);
-  void trapHandler();
-  void executeSimulator(Trace &outTrace, const Trace *refTrace = nullptr);
-  Registers dumpRegs();
-  QString generateErrorReport(const RegisterChange &change,
-                              const TraceEntry &lhs,
-                              const TraceEntry &rhs) const;
-  void loadCurrentTest();
-
-  bool m_stop = false;
-  QString m_err;
-  LoadFileParams m_currentTest;
-  ProgramLoader *m_loader;
+  /// Co-simulates the assembly program at @p path on processor @p id against
+  /// the reference model, and returns the JSON report of the co-simulation.
+  QJsonObject cosimulate(const ProcessorID &id, const QString &path);
+  void cosimulateAll(const ProcessorID &id);
 
-  std::map<QString, Trace> m_referenceTraces;
+  QTemporaryDir m_dir;
+  QString m_dependentProgramPath;
 
 private slots:
+  void initTestCase();
+
   /**
    * PROCESSOR MODELS TO TEST
    * Each of the following functions shall indicate a processor model to
    * co-simulate.
    */
-  void testRV6SDual() { cosimulate(ProcessorID::RV32_6S_DUAL, {"M"}); }
-  void testRV5S() { cosimulate(ProcessorID::RV32_5S, {"M"}); }
-  void testRV5SNoFW() { cosimulate(ProcessorID::RV32_5S_NO_FW, {"M"}); }
-};
-
-void tst_Cosimulate::trapHandler() {
-  unsigned status = ProcessorHandler::get()->getProcessor()->getRegister(
-      RegisterFileType::GPR,
-      ProcessorHandler::get()->getProcessor()->implementsISA()->syscallReg());
-
-  /// @todo: Generalize this by having ISA report exit syscall codes
-  if (status == RVABI::SysCall::Exit || status == RVABI::SysCall::Exit2) {
-    m_stop = true;
-  }
-}
-
-Registers tst_Cosimulate::dumpRegs() {
-  Registers regs;
-  for (unsigned i = 0; i < ProcessorHandler::get()->currentISA()->regCnt();
-       i++) {
-    regs[i] = ProcessorHandler::get()->getProcessor()->getRegister(
-        RegisterFileType::GPR, i);
-  }
-  return regs;
-}
-
-std::optional<std::vector<int>> regNeq(const Registers &lhs,
-                                       const Registers &rhs) {
-  std::vector<int> uneqIdxes;
-  for (const auto &it : lhs) {
-    if (it.second != rhs.at(it.first)) {
-      uneqIdxes.push_back(it.first);
-    }
-  }
-
-  if (uneqIdxes.size() > 0) {
-    return {uneqIdxes};
-  } else {
-    return std::nullopt;
-  }
-}
-
-std::vector<RegisterChange> registerChange(const Registers &before,
-                                           const Registers &after) {
-  std::vector<RegisterChange> change;
-  for (unsigned i = 0; i < ProcessorHandler::get()->currentISA()->regCnt();
-       i++) {
-    if (before.at(i) != after.at(i)) {
-      change.push_back({i, after.at(i)});
-    }
-  }
-  return change;
-}
-
-QString tst_Cosimulate::generateErrorReport(const RegisterChange &change,
-                                            const TraceEntry &lhs,
-                                            const TraceEntry &rhs) const {
-  QString err;
-  err += "\nRegister change discrepancy detected while executing test: " +
-         m_currentTest.filepath;
-  err += "\nUnexpected change was: x" + QString::number(change.index) +
-         " -> 0x" + QString::number(change.newValue, 16) + "\n";
-  err += "\nTest processor state: \t\tPC: 0x" + QString::number(lhs.pc, 16) +
-         "\t Cycle #: " + QString::number(lhs.cycle);
-  err += "\nReference processor state: \tPC: 0x" + QString::number(rhs.pc, 16) +
-         "\t Cycle #: " + QString::number(rhs.cycle);
-  err += "\n";
+  void testRV6SDual() { cosimulateAll(ProcessorID::RV32_6S_DUAL); }
+  void testRV5S() { cosimulateAll(ProcessorID::RV32_5S); }
+  void testRV5SNoFW() { cosimulateAll(ProcessorID::RV32_5S_NO_FW); }
+  void testISS() { cosimulateAll(ProcessorID::RV32_ISS); }
 
-  std::vector<int> idxes = regNeq(lhs.regs, rhs.regs).value();
-  for (const auto idx : idxes) {
-    err += "Difference in register x" + QString::number(idx) + ":";
-    err += "\t expected: 0x" + QString::number(rhs.regs.at(idx), 16) +
-           "\tactual: 0x" + QString::number(lhs.regs.at(idx), 16) + "\n";
-  }
+  void testDivergence();
+};
 
-  return err;
+void tst_Cosimulate::initTestCase() {
+  QVERIFY(m_dir.isValid());
+  m_dependentProgramPath = m_dir.filePath("dependent.s");
+  QFile file(m_dependentProgramPath);
+  QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+  file.write(s_dependentProgram.toUtf8());
 }
 
-/**
- * @brief tst_Cosimulate::executeSimulator
- * Runs the currently loaded simulator on the currently loaded program,
- * generating a register trace while doing so. If @p refTrace is provided, the
- * generated trace is compared to the reference trace and the test fails if a
- * discrepancy is detected.
- */
-void tst_Cosimulate::executeSimulator(Trace &trace, const Trace *refTrace) {
-  m_loader->loadTest(m_currentTest);
-
-  // Override the ProcessorHandler's ECALL handling. In doing so, we can hook
-  // into when the EXIT syscall was executed, to verify whether the correct test
-  // value was reached.
-  ProcessorHandler::get()->getProcessorNonConst()->trapHandler = [=] {
-    trapHandler();
-  };
-
-  m_stop = false;
-  m_err = QString();
-  bool maxCyclesReached = false;
-  unsigned cycles = 0;
-  trace.push_back(TraceEntry{
-      dumpRegs(), cycles,
-      ProcessorHandler::get()->getProcessor()->getPcForStage({0, 0})});
-
-  decltype(refTrace->begin()) cmpRegState;
-  if (refTrace) {
-    cmpRegState = refTrace->begin();
-    cmpRegState++; // skip initial state
-  }
-
-  Registers preRegs = dumpRegs();
-
-  do {
-    ProcessorHandler::get()->getProcessorNonConst()->clock();
-    cycles++;
-
-    Registers regs = dumpRegs();
-    auto regChange = registerChange(preRegs, regs);
-    // Detect change in current register state
-    if (regNeq(regs, trace.rbegin()->regs)) {
-      trace.push_back(TraceEntry{
-          dumpRegs(), cycles,
-          ProcessorHandler::get()->getProcessor()->getPcForStage({0, 0})});
-
-      // Check whether change corresponds to expected change in comparison
-      // trace. regChange might contain multiple register changes (for
-      // processors that can commit >1 instruction per cycle). So we try to
-      // locate each of the changes in the next expected register set
-      // (cmpRegStatePtr), until we have accounted for all register changes. If
-      // we incremented the expected register set, but did not find an
-      // accompanying register change, then we've reached a point of divergence.
-      if (refTrace != nullptr) {
-        while (regChange.size() > 0) {
-          bool foundChange = false;
-          for (auto changeIt = regChange.begin(); changeIt != regChange.end();
-               changeIt++) {
-            if (cmpRegState->regs.at(changeIt->index) == changeIt->newValue) {
-              regChange.erase(changeIt);
-              cmpRegState++;
-              foundChange = true;
-              break;
-            }
-          }
-          if (!foundChange) {
-            const QString err = generateErrorReport(
-                *regChange.begin(), *trace.rbegin(), *cmpRegState);
-            QFAIL(err.toStdString().c_str());
-          }
-        }
-      }
-    }
-    preRegs = regs;
-
-    maxCyclesReached = cycles >= s_maxCycles;
-    m_stop |=
-        maxCyclesReached || ProcessorHandler::get()->getProcessor()->finished();
-  } while (!m_stop);
-
-  if (maxCyclesReached) {
-    QFAIL("Maximum cycles reached");
-  }
+QJsonObject tst_Cosimulate::cosimulate(const ProcessorID &id,
+                                       const QString &path) {
+  CLIModeOptions options;
+  options.src = path;
+  options.srcType = SourceType::Assembly;
+  options.proc = id;
+  options.isaExtensions = QStringList{"M"};
+  options.cosim = true;
+  options.cosimReference = s_referenceModel;
+  options.timeout = s_timeout;
+  options.jsonOutput = true;
+  options.outputFile = m_dir.filePath("report.json");
+
+  CosimRunner(options).run();
+  QFile report(options.outputFile);
+  if (!report.open(QIODevice::ReadOnly))
+    return QJsonObject();
+  return QJsonDocument::fromJson(report.readAll()).object();
 }
 
-/**
- * @brief tst_Cosimulate::generateTrace
- * Executes program @p spProgram on the single-cycle processor model, to
- * generate a reference trace.
- */
-const Trace &
-tst_Cosimulate::generateReferenceTrace(const QStringList &extensions) {
-  auto refTrace = m_referenceTraces.find(m_currentTest.filepath);
-  if (refTrace == m_referenceTraces.end()) {
-    std::cout << "First time running test; generating reference trace..."
-              << std::endl;
-    ProcessorHandler::get()->selectProcessor(s_referenceModel, extensions);
-    Trace trace;
-    executeSimulator(trace);
-    m_referenceTraces[m_currentTest.filepath] = trace;
-    refTrace = m_referenceTraces.find(m_currentTest.filepath);
+void tst_Cosimulate::cosimulateAll(const ProcessorID &id) {
+  for (const auto &path : QStringList{m_dependentProgramPath} + s_testFiles) {
+    const QJsonObject report = cosimulate(id, path);
+    const QString status = report["status"].toString();
+    const QString err = "Co-simulation of '" + path + "' ended with status '" +
+                        status + "':\n" +
+                        QJsonDocument(report).toJson(QJsonDocument::Indented);
+    QVERIFY2(status == "match", err.toStdString().c_str());
+    QVERIFY(report["matching instructions"].toInteger() > 0);
   }
-  return refTrace->second;
 }
 
-/**
- * @brief tst_Cosimulate::cosimulate
- * Cosimulate a given processor with a reference model.
- * The cosimulation is quite inefficient, since we don't concurrently execute
- * two processors but rather generate a reference trace from a reference model,
- * and then execute a test model, generate a trace for this, and comprare this
- * trace with the reference trace. The reason for this is, that only a single
- * processor model can be instantiated at once in Ripes, due to the static
- * nature of the ProcessorHandler.
- */
-void tst_Cosimulate::cosimulate(const ProcessorID &id,
-                                const QStringList &extensions) {
-  m_loader = new ProgramLoader();
-  for (const auto &test : s_testFiles) {
-    m_currentTest = test;
-    std::cout << test.filepath.toStdString() << std::endl;
-    auto referenceTrace = generateReferenceTrace(extensions);
-    ProcessorHandler::get()->selectProcessor(id, extensions);
-    RipesSettings::getObserver(RIPES_GLOBALSIGNAL_REQRESET)->trigger();
-
-    Trace trace;
-    std::cout << "Cosimulating... " << std::flush;
-    executeSimulator(trace, &referenceTrace);
-    std::cout << "PASS!\n" << std::endl;
-  }
+void tst_Cosimulate::testDivergence() {
+  // Without forwarding nor hazard detection, the fifth instruction reads a2
+  // before the third instruction wrote it.
+  const QJsonObject report =
+      cosimulate(ProcessorID::RV32_5S_NO_FW_HZ, m_dependentProgramPath);
+  QCOMPARE(report["status"].toString(), QString("divergence"));
+  QCOMPARE(report["matching instructions"].toInteger(), qint64(4));
+  const QJsonObject divergence = report["divergence"].toObject();
+  QCOMPARE(divergence["reason"].toString(),
+           QString("The retired instructions differ."));
+  QVERIFY(divergence["reference"].toString().startsWith(
+      "core   0: 3 0x00000010 "));
+  QVERIFY(divergence["target"].toString().startsWith(
+      "core   0: 3 0x00000010 "));
 }
 
-QTEST_MAIN(tst_Cosimulate)
+QTEST_GUILESS_MAIN(tst_Cosimulate)
 #include "tst_cosimulate.moc"
@@ -1,14 +1,24 @@
 #include <QDir>
 #include <QProcess>
 #include <QStringList>
+#include <QTemporaryDir>
+#include <QTemporaryFile>
 #include <QtTest/QTest>
 
+#include "checkpoint.h"
 #include "processorhandler.h"
 #include "processorregistry.h"
 #include "ripessettings.h"
+#include "simulationcontext.h"
+#include "syscall/systemio.h"
 
 #include "assembler/rv32i_assembler.h"
 
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
 #if !defined(RISCV32_TEST_DIR) || !defined(RISCV64_TEST_DIR) ||                \
     !defined(RISCV32_C_TEST_DIR) || !defined(RISCV64_C_TEST_DIR)
 static_assert(false, "RISCV test directiories must be defined");
@@ -54,7 +64,11 @@ private:
   QString m_currentTest;
 
   void runTests(const ProcessorID &id, const QStringList &extensions,
-                const QStringList &testdirs);
+                const QStringList &testdirs, unsigned fastForward = 0,
+                bool viaCheckpoint = false);
+  static QString runTestInContext(const ProcessorID &id,
+                                  const QStringList &extensions,
+                                  const QString &testPath);
 
   void trapHandler();
 
@@ -80,6 +94,10 @@ private slots:
     runTests(ProcessorID::RV64_6S_DUAL, {"M", "C"},
              {RISCV64_TEST_DIR, RISCV64_C_TEST_DIR});
   }
+  void testRV64_ISS() {
+    runTests(ProcessorID::RV64_ISS, {"M", "C"},
+             {RISCV64_TEST_DIR, RISCV64_C_TEST_DIR});
+  }
 
   void testRV32_SingleCycle() {
     runTests(ProcessorID::RV32_SS, {"M", "C"},
@@ -97,6 +115,23 @@ private slots:
     runTests(ProcessorID::RV32_6S_DUAL, {"M", "C"},
              {RISCV32_TEST_DIR, RISCV32_C_TEST_DIR});
   }
+  void testRV32_ISS() {
+    runTests(ProcessorID::RV32_ISS, {"M", "C"},
+             {RISCV32_TEST_DIR, RISCV32_C_TEST_DIR});
+  }
+  void testRV32_5StagePipelineFastForward() {
+    runTests(ProcessorID::RV32_5S, {"M", "C"},
+             {RISCV32_TEST_DIR, RISCV32_C_TEST_DIR}, 16);
+  }
+  void testRV32_5StagePipelineCheckpoint() {
+    runTests(ProcessorID::RV32_5S, {"M", "C"},
+             {RISCV32_TEST_DIR, RISCV32_C_TEST_DIR}, 16, true);
+  }
+  void testRV32_ConcurrentContexts();
+  void testMemRange();
+  void testStdInStream();
+  void testOutputStream();
+  void testFileIO();
 };
 
 bool tst_RISCV::skipTest(const QString &test) {
@@ -180,7 +215,8 @@ QString tst_RISCV::executeSimulator() {
 }
 
 void tst_RISCV::runTests(const ProcessorID &id, const QStringList &extensions,
-                         const QStringList &testDirs) {
+                         const QStringList &testDirs, unsigned fastForward,
+                         bool viaCheckpoint) {
   for (auto testDir : testDirs) {
     const auto dir = QDir(testDir);
     const auto testFiles = dir.entryList({"*.s"});
@@ -217,6 +253,38 @@ void tst_RISCV::runTests(const ProcessorID &id, const QStringList &extensions,
       ProcessorHandler::get()->loadProgram(spProgram);
       RipesSettings::getObserver(RIPES_GLOBALSIGNAL_REQRESET)->trigger();
 
+      // When checkpointing, the fast-forward is split in two: the second
+      // checkpoint is taken from the restored first checkpoint, and must thereby
+      // carry over the pages of the first checkpoint.
+      const unsigned steps = fastForward != 0 && viaCheckpoint ? 2 : 1;
+      for (unsigned step = 0; fastForward != 0 && step < steps; ++step) {
+        const unsigned target =
+            step == 0 ? fastForward / steps : fastForward - fastForward / steps;
+        long long instructions;
+        Checkpoint checkpoint;
+        QString err = ProcessorHandler::fastForward(
+            {FastForwardTarget::Type::Instructions, target}, instructions,
+            viaCheckpoint ? &checkpoint : nullptr);
+        QVERIFY2(err.isEmpty(), err.toStdString().c_str());
+        QCOMPARE(instructions, static_cast<long long>(target));
+
+        if (viaCheckpoint) {
+          // Round-trip the checkpoint through a file, and restore it onto the
+          // reset processor.
+          QTemporaryFile file;
+          QVERIFY(file.open());
+          err = checkpoint.save(file.fileName());
+          QVERIFY2(err.isEmpty(), err.toStdString().c_str());
+          Checkpoint restored;
+          err = Checkpoint::load(file.fileName(), restored);
+          QVERIFY2(err.isEmpty(), err.toStdString().c_str());
+          QCOMPARE(restored.instructions, checkpoint.instructions);
+          RipesSettings::getObserver(RIPES_GLOBALSIGNAL_REQRESET)->trigger();
+          err = ProcessorHandler::restoreCheckpoint(restored);
+          QVERIFY2(err.isEmpty(), err.toStdString().c_str());
+        }
+      }
+
       const QString err = executeSimulator();
       if (!err.isNull()) {
         QFAIL(err.toStdString().c_str());
@@ -227,5 +295,213 @@ void tst_RISCV::runTests(const ProcessorID &id, const QStringList &extensions,
   }
 }
 
+QString tst_RISCV::runTestInContext(const ProcessorID &id,
+                                   const QStringList &extensions,
+                                   const QString &testPath) {
+  SimulationContext context;
+  SimulationContext::Scope scope(context);
+  ProcessorHandler::selectProcessor(id, extensions);
+
+  auto f = QFile(testPath);
+  if (!f.open(QIODevice::ReadOnly))
+    return "Test: '" + testPath + "' failed: Could not open test file";
+  const auto program =
+      ProcessorHandler::getAssembler()->assembleRaw(QString(f.readAll()));
+  if (program.errors.size() != 0)
+    return "Test: '" + testPath + "' failed: Could not assemble program";
+  ProcessorHandler::loadProgram(std::make_shared<Program>(program.program));
+
+  bool trapped = false;
+  auto *processor = ProcessorHandler::getProcessorNonConst();
+  processor->trapHandler = [&] { trapped = true; };
+  for (unsigned cycles = 0; !trapped && cycles < s_maxCycles; cycles++)
+    processor->clock();
+
+  if (!trapped ||
+      processor->getRegister(RegisterFileType::GPR, s_ecallreg) != s_success) {
+    return "Test: '" + testPath + "' failed\n\t test number: " +
+           QString::number(
+               processor->getRegister(RegisterFileType::GPR, s_statusreg));
+  }
+  return QString();
+}
+
+void tst_RISCV::testRV32_ConcurrentContexts() {
+  QStringList testPaths;
+  for (const QString testDir : {RISCV32_TEST_DIR, RISCV32_C_TEST_DIR}) {
+    for (const auto &test : QDir(testDir).entryList({"*.s"})) {
+      if (!skipTest(test))
+        testPaths << testDir + QDir::separator() + test;
+    }
+  }
+
+  // Each test is simulated within its own simulation context, with the tests
+  // being distributed across a number of threads.
+  std::vector<QString> errors(testPaths.size());
+  std::atomic<int> nextTest = 0;
+  std::vector<std::thread> workers;
+  const unsigned nWorkers = std::max(2u, std::thread::hardware_concurrency());
+  for (unsigned i = 0; i < nWorkers; i++) {
+    workers.emplace_back([&] {
+      for (int test = nextTest++; test < testPaths.size(); test = nextTest++)
+        errors[test] = runTestInContext(ProcessorID::RV32_5S, {"M", "C"},
+                                        testPaths[test]);
+    });
+  }
+  for (auto &worker : workers)
+    worker.join();
+
+  for (const auto &err : errors) {
+    if (!err.isNull())
+      QFAIL(err.toStdString().c_str());
+  }
+}
+
+void tst_RISCV::testMemRange() {
+  SimulationContext context;
+  SimulationContext::Scope scope(context);
+  ProcessorHandler::selectProcessor(ProcessorID::RV32_5S, {"M"});
+
+  // An unaligned range, spanning several words.
+  QByteArray data;
+  for (int i = 0; i < 37; i++)
+    data.append(static_cast<char>('a' + i % 26));
+  const AInt address = 0x10000003;
+  ProcessorHandler::writeMemRange(address, data.constData(), data.size());
+  QCOMPARE(ProcessorHandler::readMemRange(address, data.size()), data);
+  for (int i = 0; i < data.size(); i++)
+    QCOMPARE(ProcessorHandler::getMemory().readMemConst(address + i, 1) & 0xFF,
+             static_cast<VInt>(static_cast<uint8_t>(data.at(i))));
+
+  // The string ends at the first null terminator.
+  const char terminator = '\0';
+  ProcessorHandler::writeMemRange(address + 20, &terminator, 1);
+  QCOMPARE(ProcessorHandler::readMemString(address), data.left(20));
+}
+
+void tst_RISCV::testStdInStream() {
+  SimulationContext context;
+  SimulationContext::Scope scope(context);
+  auto &sio = SystemIO::get();
+
+  // Stream several times the stdin buffer size; the producer blocks on the
+  // bounded buffer until the input has been read.
+  constexpr int chunks = 3 * (SystemIO::STDIN_BUFFER_SIZE >> 12);
+  std::thread producer([&] {
+    QByteArray chunk(1 << 12, '\0');
+    for (int i = 0; i < chunks; i++) {
+      chunk.fill(static_cast<char>(i));
+      QVERIFY(sio.feedStdIn(chunk.constData(), chunk.size()));
+    }
+    sio.closeStdIn();
+  });
+
+  qsizetype total = 0;
+  bool inOrder = true;
+  for (;;) {
+    // Only read once input is available, such that the read does not wait
+    // (and post a status message, which requires an application).
+    while (!SystemIO::stdInReady())
+      std::this_thread::yield();
+    QByteArray buffer;
+    const int n = SystemIO::readFromFile(SystemIO::STDIN, buffer, 1000);
+    if (n == 0)
+      break;
+    for (int i = 0; i < n; i++)
+      inOrder &= buffer.at(i) == static_cast<char>((total + i) >> 12);
+    total += n;
+  }
+  producer.join();
+  QVERIFY(inOrder);
+  QCOMPARE(total, qsizetype(chunks) << 12);
+}
+
+void tst_RISCV::testOutputStream() {
+  SimulationContext context;
+  SimulationContext::Scope scope(context);
+  auto &sio = SystemIO::get();
+  // Resetting the processor aborts any pending syscall, which must not affect
+  // the output of a subsequent run.
+  ProcessorHandler::selectProcessor(ProcessorID::RV32_5S, {"M"});
+
+  // A slow consumer, such that the output ring fills up. Output which bypasses
+  // the ring is collected from the writing thread.
+  QByteArray buffered, direct;
+  std::thread consumer([&buffered, ring = sio.enableOutputBuffer()] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    const char *data;
+    while (const size_t n = ring->acquire(0, data)) {
+      buffered.append(data, n);
+      ring->release(0, n);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+  QObject::connect(&sio, &SystemIO::doPrint,
+                   [&](const QByteArray &bytes) { direct.append(bytes); });
+
+  // Write several times the ring size, stopping the run for the last third;
+  // the output then bypasses the ring, once the ring has been drained.
+  constexpr int chunks = 3 * 256;
+  QByteArray expected;
+  QByteArray chunk(1 << 12, '\0');
+  for (int i = 0; i < chunks; i++) {
+    if (i == 2 * chunks / 3)
+      sio.setRunStopping(true);
+    chunk.fill(static_cast<char>(i));
+    QCOMPARE(SystemIO::writeToFile(SystemIO::STDOUT, chunk, chunk.size()),
+             int(chunk.size()));
+    expected += chunk;
+  }
+  sio.disableOutputBuffer();
+  consumer.join();
+
+  QVERIFY(!direct.isEmpty());
+  QCOMPARE(buffered + direct, expected);
+}
+
+void tst_RISCV::testFileIO() {
+  SimulationContext context;
+  SimulationContext::Scope scope(context);
+  QTemporaryDir dir;
+  const QString path = dir.filePath("file.bin");
+
+  // Binary data, spanning several write buffers.
+  QByteArray data;
+  for (int i = 0; i < 200000; i++)
+    data.append(static_cast<char>(i * 7));
+
+  // O_WRONLY | O_CREAT | O_TRUNC
+  int fd = SystemIO::openFile(path, 0x601);
+  QVERIFY(fd >= SystemIO::STDIO_END);
+  for (int i = 0; i < data.size(); i += 1000)
+    QCOMPARE(SystemIO::writeToFile(fd, data.mid(i, 1000), 1000), 1000);
+
+  // Buffered writes are flushed before seeking; the write then overwrites.
+  QCOMPARE(SystemIO::seek(fd, 10, SEEK_SET), 10);
+  QCOMPARE(SystemIO::writeToFile(fd, "abc", 3), 3);
+  data.replace(10, 3, "abc");
+  SystemIO::FileStat stat;
+  QVERIFY(SystemIO::fileStat(fd, stat));
+  QVERIFY(!stat.isCharDevice);
+  QCOMPARE(stat.size, qint64(data.size()));
+  SystemIO::closeFile(fd);
+
+  // O_RDONLY; the file is read through a mapping.
+  fd = SystemIO::openFile(path, 0);
+  QVERIFY(fd >= SystemIO::STDIO_END);
+  QByteArray read, chunk;
+  while (SystemIO::readFromFile(fd, chunk, 4096) > 0)
+    read += chunk;
+  QCOMPARE(read, data);
+  QCOMPARE(SystemIO::seek(fd, -3, SEEK_END), int(data.size() - 3));
+  QCOMPARE(SystemIO::readFromFile(fd, chunk, 10), 3);
+  QCOMPARE(chunk, data.right(3));
+  QCOMPARE(SystemIO::writeToFile(fd, "abc", 3), -1);
+  SystemIO::closeFile(fd);
+
+  // Files are not created unless requested.
+  QCOMPARE(SystemIO::openFile(dir.filePath("missing"), 0), -1);
+}
+
 QTEST_APPLESS_MAIN(tst_RISCV)
 #include "tst_riscv.moc"
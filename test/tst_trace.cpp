@@ -0,0 +1,279 @@
+#include <QTemporaryDir>
+#include <QtTest/QTest>
+
+#include "committracewriter.h"
+#include "pipelinetracewriter.h"
+#include "processorhandler.h"
+#include "processorregistry.h"
+#include "profiler.h"
+#include "simulationcontext.h"
+
+#include <map>
+
+using namespace Ripes;
+
+// A loop of three iterations, followed by an exit system call.
+static const QString s_loopProgram = R"(
+    li a0, 3
+loop:
+    addi a0, a0, -1
+    bnez a0, loop
+    li a7, 10
+    ecall
+)";
+
+// The addresses of the instructions retired by s_loopProgram, in order.
+static const std::vector<AInt> s_loopRetired = {0x0, 0x4, 0x8, 0x4, 0x8,
+                                                0x4, 0x8, 0xc, 0x10};
+
+// A loop of dependent instructions, loads, stores and branches. The first two
+// instructions write the same register, and retire within the same cycle on a
+// dual-issue processor.
+static const QString s_kernelProgram = R"(
+    li t0, 1
+    li t0, 2
+    li t0, 3
+    li a0, 0
+    li a1, 5
+    li a5, 0
+    lui a2, 0x10000
+loop:
+    add a0, a0, a1
+    sw a0, 0(a2)
+    lw a3, 0(a2)
+    add a4, a3, a0
+    addi a2, a2, 4
+    addi a1, a1, -1
+    andi t1, a1, 1
+    beqz t1, even
+    xor a5, a5, a4
+    j next
+even:
+    sub a5, a5, a4
+next:
+    bnez a1, loop
+    mv a0, a5
+    li a7, 10
+    ecall
+)";
+
+// A loop calling a function, with the functions main, loop and inc.
+static const QString s_callProgram = R"(
+main:
+    li a0, 3
+    li s0, 0
+loop:
+    jal ra, inc
+    addi a0, a0, -1
+    bnez a0, loop
+    li a7, 10
+    ecall
+inc:
+    addi s0, s0, 1
+    ret
+)";
+
+// The number of times each instruction of s_callProgram retires, by address.
+static const std::map<AInt, uint64_t> s_callRetired = {
+    {0x0, 1},  {0x4, 1},  {0x8, 3},  {0xc, 3}, {0x10, 3},
+    {0x14, 1}, {0x18, 1}, {0x1c, 3}, {0x20, 3}};
+
+class tst_Trace : public QObject {
+  Q_OBJECT
+
+private:
+  /// Selects processor @p id in the current context, and loads @p program.
+  static QString loadProgram(ProcessorID id, const QString &program);
+  /// Runs @p program on processor @p id, writing its commit trace to @p trace.
+  /// Returns an error message on failure.
+  static QString commitTrace(ProcessorID id, const QString &program,
+                             CommitTraceWriter::Format format,
+                             QByteArray &trace);
+
+private slots:
+  void testKanata();
+  void testCommitTrace();
+  void testProfile();
+};
+
+QString tst_Trace::loadProgram(ProcessorID id, const QString &program) {
+  ProcessorHandler::selectProcessor(id, {"M"});
+  const auto result = ProcessorHandler::getAssembler()->assembleRaw(program);
+  if (result.errors.size() != 0)
+    return "Could not assemble program:\n" + result.errors.toString();
+  ProcessorHandler::loadProgram(std::make_shared<Program>(result.program));
+  return QString();
+}
+
+void tst_Trace::testKanata() {
+  QTemporaryDir dir;
+  const QString path = dir.filePath("trace.log");
+  SimulationContext context;
+  SimulationContext::Scope scope(context);
+  const QString err = loadProgram(ProcessorID::RV32_5S, s_loopProgram);
+  QVERIFY2(err.isEmpty(), err.toStdString().c_str());
+  {
+    PipelineTraceWriter writer;
+    QVERIFY(writer.open(path).isEmpty());
+    context.run();
+  }
+
+  QFile file(path);
+  QVERIFY(file.open(QIODevice::ReadOnly));
+  const QList<QByteArray> lines = file.readAll().split('\n');
+  QCOMPARE(lines.at(0), QByteArray("Kanata\t0004"));
+
+  struct Instruction {
+    AInt pc = 0;
+    QList<QByteArray> stages;
+    bool retired = false;
+    bool flushed = false;
+  };
+  std::map<uint64_t, Instruction> instructions;
+  std::vector<uint64_t> retireOrder;
+  for (const auto &line : lines) {
+    const QList<QByteArray> fields = line.split('\t');
+    if (fields.size() < 4)
+      continue;
+    const uint64_t id = fields.at(1).toULongLong();
+    if (fields.at(0) == "I") {
+      // Each fetch is an instruction of its own.
+      QVERIFY(instructions.count(id) == 0);
+      instructions[id] = Instruction();
+      continue;
+    }
+    QVERIFY(instructions.count(id) != 0);
+    auto &instr = instructions[id];
+    QVERIFY(!instr.retired && !instr.flushed);
+    if (fields.at(0) == "L") {
+      bool ok;
+      instr.pc = fields.at(3).split(':').at(0).toULongLong(&ok, 16);
+      QVERIFY(ok);
+    } else if (fields.at(0) == "S" && fields.at(2) == "0") {
+      instr.stages << fields.at(3);
+    } else if (fields.at(0) == "R") {
+      if (fields.at(3) == "1") {
+        instr.flushed = true;
+      } else {
+        instr.retired = true;
+        QCOMPARE(fields.at(2).toULongLong(),
+                 static_cast<qulonglong>(retireOrder.size()));
+        retireOrder.push_back(id);
+      }
+    }
+  }
+
+  // Every instruction leaves the pipeline. Retired instructions pass through
+  // all stages, and do so in fetch order.
+  unsigned flushed = 0;
+  for (const auto &[id, instr] : instructions) {
+    QVERIFY(instr.retired || instr.flushed);
+    if (instr.retired)
+      QCOMPARE(instr.stages,
+               QList<QByteArray>({"IF", "ID", "EX", "MEM", "WB"}));
+    else
+      flushed++;
+  }
+  // Instructions fetched after each taken branch are flushed.
+  QVERIFY(flushed >= 4);
+
+  QCOMPARE(retireOrder.size(), s_loopRetired.size());
+  for (unsigned i = 0; i < retireOrder.size(); i++) {
+    QCOMPARE(instructions[retireOrder[i]].pc, s_loopRetired[i]);
+    if (i != 0)
+      QVERIFY(retireOrder[i] > retireOrder[i - 1]);
+  }
+}
+
+QString tst_Trace::commitTrace(ProcessorID id, const QString &program,
+                               CommitTraceWriter::Format format,
+                               QByteArray &trace) {
+  QTemporaryDir dir;
+  const QString path = dir.filePath("commits");
+  SimulationContext context;
+  SimulationContext::Scope scope(context);
+  QString err = loadProgram(id, program);
+  if (!err.isEmpty())
+    return err;
+  {
+    CommitTraceWriter writer;
+    err = writer.open(path, format);
+    if (!err.isEmpty())
+      return err;
+    context.run();
+  }
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly))
+    return "Could not read the commit trace";
+  trace = file.readAll();
+  return QString();
+}
+
+void tst_Trace::testCommitTrace() {
+  for (const auto format :
+       {CommitTraceWriter::Format::Binary, CommitTraceWriter::Format::Spike}) {
+    QByteArray reference;
+    QString err = commitTrace(ProcessorID::RV32_SS, s_kernelProgram, format,
+                              reference);
+    QVERIFY2(err.isEmpty(), err.toStdString().c_str());
+
+    if (format == CommitTraceWriter::Format::Spike) {
+      const QList<QByteArray> lines = reference.split('\n');
+      QCOMPARE(lines.at(0), QByteArray("core   0: 3 0x00000000 (0x00100293) "
+                                       "x5  0x00000001"));
+      QCOMPARE(lines.at(1), QByteArray("core   0: 3 0x00000004 (0x00200293) "
+                                       "x5  0x00000002"));
+    }
+
+    // Pipelined models retire the same instructions, with the same effects.
+    for (const auto id : {ProcessorID::RV32_5S, ProcessorID::RV32_6S_DUAL}) {
+      QByteArray trace;
+      err = commitTrace(id, s_kernelProgram, format, trace);
+      QVERIFY2(err.isEmpty(), err.toStdString().c_str());
+      QCOMPARE(trace, reference);
+    }
+  }
+}
+
+void tst_Trace::testProfile() {
+  for (const auto id : {ProcessorID::RV32_SS, ProcessorID::RV32_5S}) {
+    SimulationContext context;
+    SimulationContext::Scope scope(context);
+    const QString err = loadProgram(id, s_callProgram);
+    QVERIFY2(err.isEmpty(), err.toStdString().c_str());
+    Profiler profiler;
+    context.run();
+
+    std::map<AInt, Profiler::Counts> counts;
+    uint64_t cycles = 0;
+    for (const auto &entry : profiler.instructions()) {
+      counts[entry.address] = entry.counts;
+      cycles += entry.counts[Profiler::Cycles];
+    }
+    for (const auto &[address, retired] : s_callRetired)
+      QCOMPARE(counts[address][Profiler::Retired], retired);
+    QCOMPARE(cycles, static_cast<uint64_t>(
+                         ProcessorHandler::getProcessor()->getCycleCount()));
+
+    std::map<QString, Profiler::Counts> functions;
+    for (const auto &entry : profiler.functions())
+      functions[entry.name] = entry.counts;
+    QCOMPARE(functions["main"][Profiler::Retired], uint64_t(2));
+    QCOMPARE(functions["loop"][Profiler::Retired], uint64_t(11));
+    QCOMPARE(functions["inc"][Profiler::Retired], uint64_t(6));
+
+    if (id != ProcessorID::RV32_SS)
+      continue;
+    // On the single-cycle processor, each instruction takes one cycle.
+    for (const auto &[address, retired] : s_callRetired)
+      QCOMPARE(counts[address][Profiler::Cycles], retired);
+    QCOMPARE(functions["main"][Profiler::Cycles], uint64_t(2));
+    QCOMPARE(functions["loop"][Profiler::Cycles], uint64_t(11));
+    QCOMPARE(functions["inc"][Profiler::Cycles], uint64_t(6));
+    QCOMPARE(profiler.foldedStacks(),
+             QString("main 2\nloop 11\nloop;inc 6\n"));
+  }
+}
+
+QTEST_APPLESS_MAIN(tst_Trace)
+#include "tst_trace.moc"